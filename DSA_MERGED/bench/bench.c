@@ -0,0 +1,571 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "autocomplete.h"
+#include "casefold.h"
+#include "cursor.h"
+#include "fulltext.h"
+#include "fuzzy.h"
+#include "movie.h"
+#include "parallel.h"
+#include "recommendation.h"
+#include "search.h"
+
+/*
+ * Loads a catalog, builds the title index and times every query entry point
+ * with queries drawn from the catalog itself. Prints one JSON object on
+ * stdout so runs can be stored and compared; progress goes to stderr.
+ */
+
+#define BENCH_SCHEMA 1
+#define BENCH_DEFAULT_QUERIES 1000
+#define BENCH_DEFAULT_SCAN_QUERIES 100
+#define BENCH_DEFAULT_SEED 42u
+#define BENCH_PARTIAL_LENGTH 5
+#define BENCH_PREFIX_MAX 4 /* autocomplete prefixes are 1..BENCH_PREFIX_MAX bytes */
+#define BENCH_COMPLETIONS 10
+#define BENCH_TYPOS_MAX 2 /* fuzzy queries are titles with 1..BENCH_TYPOS_MAX random edits */
+#define BENCH_PLOT_WORDS 3 /* plot queries are 1..BENCH_PLOT_WORDS words of a description */
+#define BENCH_PLOT_RESULTS 25
+#define BENCH_PAGE 25 /* first-page ops take this many matches from a cursor */
+#define BENCH_RECOMMENDATIONS 20 /* what the recommendation menu asks for */
+#define BENCH_APPENDS 20 /* --append adds its file this many times */
+
+typedef enum {
+    QUERY_TITLE,
+    QUERY_PREFIX,
+    QUERY_TYPO,
+    QUERY_PLOT,
+    QUERY_DIRECTOR,
+    QUERY_CAST,
+    QUERY_GENRE,
+    QUERY_YEAR,
+    QUERY_MOVIE,
+    QUERY_COMBINED /* a movie's first genre and the years around its release */
+} QueryKind;
+
+typedef struct {
+    const char *name;
+    QueryKind kind;
+    int partial; /* query with a slice of the value instead of all of it */
+    int scan;    /* cost grows with the catalog; run scan_queries times */
+    int page;    /* take the first BENCH_PAGE matches from a SearchCursor instead */
+    int threaded; /* recommendations on --threads workers */
+} BenchOp;
+
+static const BenchOp bench_ops[] = {
+    {"title_index_lookup", QUERY_TITLE, 0, 0, 0, 0},
+    {"title_index_partial_search", QUERY_TITLE, 1, 1, 0, 0},
+    {"title_autocomplete", QUERY_PREFIX, 0, 0, 0, 0},
+    {"title_fuzzy_search", QUERY_TYPO, 0, 0, 0, 0},
+    {"full_text_search", QUERY_PLOT, 0, 0, 0, 0},
+    {"search_by_director", QUERY_DIRECTOR, 0, 0, 0, 0},
+    {"search_by_director_partial", QUERY_DIRECTOR, 1, 1, 0, 0},
+    {"search_by_cast", QUERY_CAST, 0, 0, 0, 0},
+    {"search_by_cast_partial", QUERY_CAST, 1, 1, 0, 0},
+    {"search_by_genre", QUERY_GENRE, 0, 1, 0, 0},
+    {"search_by_genre_partial", QUERY_GENRE, 1, 1, 0, 0},
+    {"search_by_release_year", QUERY_YEAR, 0, 1, 0, 0},
+    {"search_by_release_year_range", QUERY_YEAR, 1, 1, 0, 0}, /* the decade from the year */
+    {"recommendation_generate", QUERY_MOVIE, 0, 1, 0, 0},
+    {"recommendation_generate_top", QUERY_MOVIE, 1, 1, 0, 0}, /* the best BENCH_RECOMMENDATIONS */
+    {"recommendation_generate_parallel", QUERY_MOVIE, 0, 1, 0, 1},
+    {"recommendation_generate_top_parallel", QUERY_MOVIE, 1, 1, 0, 1},
+    {"search_query_run", QUERY_COMBINED, 0, 1, 0, 0},
+    {"cursor_title_partial", QUERY_TITLE, 1, 0, 1, 0},
+    {"cursor_director_partial", QUERY_DIRECTOR, 1, 0, 1, 0},
+    {"cursor_cast_partial", QUERY_CAST, 1, 0, 1, 0},
+    {"cursor_genre_partial", QUERY_GENRE, 1, 0, 1, 0},
+    {"cursor_release_year_range", QUERY_YEAR, 1, 0, 1, 0},
+};
+
+#define BENCH_OP_COUNT (sizeof(bench_ops) / sizeof(bench_ops[0]))
+
+typedef struct {
+    size_t queries;
+    size_t scan_queries;
+    size_t threads;
+    uint64_t seed;
+    const char *path;
+    const char *append_path; /* appended after the ops to time movie_db_append_from_csv, or NULL */
+} BenchOptions;
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    /* xorshift64* */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545f4914f6cdd1dull;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; /* bytes there, kilobytes on Linux */
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples. */
+static double percentile(const double *sorted, size_t count, double p) {
+    size_t rank = (size_t)(p / 100.0 * (double)count + 0.999999);
+    if (rank == 0) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+/* Copy the first comma-separated name of list, trimmed and folded, into buffer. */
+static int first_name(const char *list, char *buffer, size_t size) {
+    if (!list) return 0;
+    while (*list == ' ') list++;
+    size_t len = strcspn(list, ",");
+    while (len > 0 && list[len - 1] == ' ') len--;
+    if (len == 0 || len >= size) return 0;
+    casefold(buffer, list, len, CASEFOLD_KEYS);
+    return strcmp(buffer, "unknown") != 0;
+}
+
+/* Replace query with a BENCH_PARTIAL_LENGTH slice starting at a random offset. */
+static void slice_query(char *query) {
+    size_t len = strlen(query);
+    if (len <= BENCH_PARTIAL_LENGTH) return;
+    size_t start = (size_t)(rng_next() % (len - BENCH_PARTIAL_LENGTH + 1));
+    memmove(query, query + start, BENCH_PARTIAL_LENGTH);
+    query[BENCH_PARTIAL_LENGTH] = '\0';
+}
+
+/* Substitute, delete or insert a letter at 1..BENCH_TYPOS_MAX random places; query has room for the inserts. */
+static void add_typos(char *query) {
+    size_t edits = (size_t)(rng_next() % BENCH_TYPOS_MAX) + 1;
+    for (size_t e = 0; e < edits; ++e) {
+        size_t len = strlen(query);
+        if (len == 0) return;
+        size_t at = (size_t)(rng_next() % len);
+        char letter = (char)('a' + rng_next() % 26);
+        switch (rng_next() % 3) {
+        case 0:
+            query[at] = letter;
+            break;
+        case 1:
+            memmove(query + at, query + at + 1, len - at);
+            break;
+        default:
+            memmove(query + at + 1, query + at, len - at + 1);
+            query[at] = letter;
+            break;
+        }
+    }
+}
+
+/* Copy 1..BENCH_PLOT_WORDS consecutive words from a random place in text; returns 0 when text is too short. */
+static int plot_words(const char *text, char *query, size_t size) {
+    if (!text) return 0;
+    size_t len = strlen(text);
+    if (len < 16) return 0;
+    const char *start = text + rng_next() % (len / 2);
+    while (*start && *start != ' ') start++;
+    while (*start == ' ') start++;
+    size_t want = (size_t)(rng_next() % BENCH_PLOT_WORDS) + 1;
+    const char *end = start;
+    for (size_t words = 0; *end && words < want; ++words) {
+        while (*end == ' ') end++;
+        while (*end && *end != ' ') end++;
+    }
+    if (end == start || (size_t)(end - start) >= size) return 0;
+    memcpy(query, start, (size_t)(end - start));
+    query[end - start] = '\0';
+    return 1;
+}
+
+/* Fill query from a random movie; returns the movie index, or db->count when none fits. */
+static size_t pick_query(const MovieDatabase *db, QueryKind kind, char *query, size_t size) {
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        size_t index = (size_t)(rng_next() % db->count);
+        const Movie *movie = &db->movies[index];
+        switch (kind) {
+        case QUERY_TITLE:
+            if (movie->title_lower && movie->title_lower[0] && strlen(movie->title_lower) < size) {
+                strcpy(query, movie->title_lower);
+                return index;
+            }
+            break;
+        case QUERY_TYPO:
+            if (movie->title_lower && movie->title_lower[0] && strlen(movie->title_lower) + BENCH_TYPOS_MAX < size) {
+                strcpy(query, movie->title_lower);
+                add_typos(query);
+                return index;
+            }
+            break;
+        case QUERY_PLOT:
+            if (plot_words(movie->description, query, size)) return index;
+            break;
+        case QUERY_PREFIX:
+            if (movie->title_lower && movie->title_lower[0]) {
+                size_t len = (size_t)(rng_next() % BENCH_PREFIX_MAX) + 1;
+                snprintf(query, size, "%.*s", (int)len, movie->title_lower);
+                return index;
+            }
+            break;
+        case QUERY_DIRECTOR:
+            if (first_name(movie->director, query, size)) return index;
+            break;
+        case QUERY_CAST:
+            if (first_name(movie->cast, query, size)) return index;
+            break;
+        case QUERY_GENRE:
+            if (movie->genre_count > 0 && first_name(movie->genres[0], query, size)) return index;
+            break;
+        case QUERY_YEAR:
+            if (movie->release_year_num > 0) {
+                snprintf(query, size, "%d", movie->release_year_num);
+                return index;
+            }
+            break;
+        case QUERY_MOVIE:
+            query[0] = '\0';
+            return index;
+        case QUERY_COMBINED:
+            if (movie->release_year_num > 0 && movie->genre_count > 0 && first_name(movie->genres[0], query, size)) {
+                return index;
+            }
+            break;
+        }
+    }
+    return db->count;
+}
+
+/* Open a cursor for a partial query and take its first page; returns the matches taken. */
+static size_t run_page(const BenchOp *op, const MovieDatabase *db, const TitleIndex *index, const char *query) {
+    SearchCursor cursor;
+    search_cursor_init(&cursor);
+    int opened = 0;
+    switch (op->kind) {
+    case QUERY_TITLE:
+        opened = search_cursor_open(&cursor, db, index, SEARCH_TITLE_PARTIAL, query);
+        break;
+    case QUERY_DIRECTOR:
+        opened = search_cursor_open(&cursor, db, index, SEARCH_DIRECTOR_PARTIAL, query);
+        break;
+    case QUERY_CAST:
+        opened = search_cursor_open(&cursor, db, index, SEARCH_CAST_PARTIAL, query);
+        break;
+    case QUERY_GENRE:
+        opened = search_cursor_open(&cursor, db, index, SEARCH_GENRE_PARTIAL, query);
+        break;
+    case QUERY_YEAR:
+        opened = search_cursor_open_years(&cursor, db, atoi(query), atoi(query) + 9);
+        break;
+    default:
+        break;
+    }
+    size_t page[BENCH_PAGE];
+    size_t count = opened ? search_cursor_next(&cursor, page, BENCH_PAGE) : 0;
+    search_cursor_close(&cursor);
+    return count;
+}
+
+/* Run one query; returns the number of results. */
+static size_t run_op(const BenchOp *op, const MovieDatabase *db, const TitleIndex *index,
+                     const TitleAutocomplete *completions, const TitleFuzzyIndex *fuzzy, const FullTextIndex *plots,
+                     const char *query, size_t movie_index, size_t threads) {
+    size_t *indices = NULL;
+    size_t count = 0;
+    int found = 0;
+    if (op->page) return run_page(op, db, index, query);
+    if (op->kind == QUERY_MOVIE) {
+        Recommendation *list = NULL;
+        if (op->threaded) {
+            found = op->partial
+                ? recommendation_generate_top_parallel(db, movie_index, BENCH_RECOMMENDATIONS, threads, &list, &count)
+                : recommendation_generate_parallel(db, movie_index, threads, &list, &count);
+        } else {
+            found = op->partial ? recommendation_generate_top(db, movie_index, BENCH_RECOMMENDATIONS, &list, &count)
+                                : recommendation_generate(db, movie_index, &list, &count);
+        }
+        if (found) free(list);
+        return count;
+    }
+    if (op->kind == QUERY_PREFIX) {
+        uint32_t keys[BENCH_COMPLETIONS];
+        title_autocomplete(completions, query, BENCH_COMPLETIONS, keys, &count);
+        return count;
+    }
+    if (op->kind == QUERY_TYPO) {
+        TitleFuzzyMatch matches[BENCH_COMPLETIONS];
+        title_fuzzy_search(fuzzy, query, BENCH_COMPLETIONS, matches, &count);
+        return count;
+    }
+    if (op->kind == QUERY_PLOT) {
+        FullTextMatch matches[BENCH_PLOT_RESULTS];
+        full_text_search(plots, query, BENCH_PLOT_RESULTS, matches, &count);
+        return count;
+    }
+    if (op->kind == QUERY_COMBINED) {
+        SearchQuery combined;
+        search_query_init(&combined);
+        combined.genre_substr_lower = query;
+        combined.year_from = db->movies[movie_index].release_year_num - 5;
+        combined.year_to = db->movies[movie_index].release_year_num + 5;
+        ResultSet results;
+        result_set_init(&results);
+        search_query_run(db, index, &combined, &results);
+        count = result_set_cardinality(&results);
+        result_set_free(&results);
+        return count;
+    }
+    switch (op->kind) {
+    case QUERY_TITLE:
+        found = op->partial ? title_index_partial_search(index, query, &indices, &count)
+                            : title_index_lookup(index, query, &indices, &count);
+        break;
+    case QUERY_DIRECTOR:
+        found = op->partial ? search_by_director_partial(db, query, &indices, &count)
+                            : search_by_director(db, query, &indices, &count);
+        break;
+    case QUERY_CAST:
+        found = op->partial ? search_by_cast_partial(db, query, &indices, &count)
+                            : search_by_cast(db, query, &indices, &count);
+        break;
+    case QUERY_GENRE:
+        found = op->partial ? search_by_genre_partial(db, query, &indices, &count)
+                            : search_by_genre(db, query, &indices, &count);
+        break;
+    case QUERY_YEAR:
+        found = op->partial ? search_by_release_year_range(db, atoi(query), atoi(query) + 9, &indices, &count)
+                            : search_by_release_year(db, atoi(query), &indices, &count);
+        break;
+    case QUERY_PREFIX:
+    case QUERY_TYPO:
+    case QUERY_PLOT:
+    case QUERY_MOVIE:
+    case QUERY_COMBINED:
+        break;
+    }
+    if (found) free(indices);
+    return found ? count : 0;
+}
+
+static void print_json_string(const char *s) {
+    putchar('"');
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') putchar('\\');
+        if ((unsigned char)*s < 0x20) {
+            printf("\\u%04x", (unsigned)(unsigned char)*s);
+        } else {
+            putchar(*s);
+        }
+    }
+    putchar('"');
+}
+
+/* Time one op over `queries` random queries and print its JSON object. */
+static void bench_op(const BenchOp *op, const MovieDatabase *db, const TitleIndex *index,
+                     const TitleAutocomplete *completions, const TitleFuzzyIndex *fuzzy, const FullTextIndex *plots,
+                     size_t queries, size_t threads) {
+    double *samples = (double *)malloc((queries > 0 ? queries : 1) * sizeof(double));
+    if (!samples) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    char query[256];
+    size_t taken = 0;
+    size_t results = 0;
+    double total = 0.0;
+    for (size_t i = 0; i < queries; ++i) {
+        size_t movie_index = pick_query(db, op->kind, query, sizeof(query));
+        if (movie_index >= db->count) continue;
+        if (op->partial) slice_query(query);
+        double start = now_ns();
+        results += run_op(op, db, index, completions, fuzzy, plots, query, movie_index, threads);
+        double elapsed = now_ns() - start;
+        samples[taken++] = elapsed;
+        total += elapsed;
+    }
+    qsort(samples, taken, sizeof(double), compare_double);
+
+    printf("    {\"name\": \"%s\", \"samples\": %zu", op->name, taken);
+    if (taken > 0) {
+        printf(", \"p50_ns\": %.0f, \"p99_ns\": %.0f, \"mean_ns\": %.0f, \"max_ns\": %.0f, \"mean_results\": %.1f",
+               percentile(samples, taken, 50.0), percentile(samples, taken, 99.0), total / (double)taken,
+               samples[taken - 1], (double)results / (double)taken);
+    }
+    printf("}");
+    free(samples);
+}
+
+/* Append a file BENCH_APPENDS times; the catalog grows by its rows each time. */
+static void bench_appends(MovieDatabase *db, const char *path) {
+    double samples[BENCH_APPENDS];
+    size_t taken = 0;
+    size_t rows = db->count;
+    fprintf(stderr, "Timing appends of %s...\n", path);
+    for (; taken < BENCH_APPENDS; ++taken) {
+        char *error = NULL;
+        double start = now_ns();
+        int appended = movie_db_append_from_csv(db, path, NULL, &error);
+        samples[taken] = now_ns() - start;
+        if (!appended) {
+            fprintf(stderr, "Append of %s stopped: %s\n", path, error ? error : "no rows");
+            free(error);
+            break;
+        }
+    }
+    printf("  \"append\": {\"samples\": %zu, \"rows\": %zu", taken, taken > 0 ? (db->count - rows) / taken : 0);
+    if (taken > 0) {
+        qsort(samples, taken, sizeof(double), compare_double);
+        printf(", \"p50_ms\": %.3f, \"max_ms\": %.3f", percentile(samples, taken, 50) / 1e6,
+               samples[taken - 1] / 1e6);
+    }
+    printf("},\n");
+}
+
+static int parse_size(const char *text, size_t *out) {
+    char *end = NULL;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (!end || end == text || *end != '\0') return 0;
+    *out = (size_t)value;
+    return 1;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--queries N] [--scan-queries N] [--threads N] [--seed N] [--append FILE] CATALOG.csv\n"
+            "  --queries N       samples for hash and posting lookups (default %d)\n"
+            "  --scan-queries N  samples for ops that scan the catalog (default %d)\n"
+            "  --threads N       load, index build and *_parallel recommendation threads (default 1)\n"
+            "  --append FILE     time %d appends of FILE after the ops\n",
+            program, BENCH_DEFAULT_QUERIES, BENCH_DEFAULT_SCAN_QUERIES, BENCH_APPENDS);
+}
+
+static int parse_options(int argc, char **argv, BenchOptions *options) {
+    options->queries = BENCH_DEFAULT_QUERIES;
+    options->scan_queries = BENCH_DEFAULT_SCAN_QUERIES;
+    options->threads = 1;
+    options->seed = BENCH_DEFAULT_SEED;
+    options->path = NULL;
+    options->append_path = NULL;
+    for (int i = 1; i < argc; ++i) {
+        size_t value = 0;
+        if (i + 1 < argc && strcmp(argv[i], "--queries") == 0 && parse_size(argv[i + 1], &value)) {
+            options->queries = value;
+        } else if (i + 1 < argc && strcmp(argv[i], "--scan-queries") == 0 && parse_size(argv[i + 1], &value)) {
+            options->scan_queries = value;
+        } else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0 && parse_size(argv[i + 1], &value) && value > 0) {
+            options->threads = value;
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0 && parse_size(argv[i + 1], &value)) {
+            options->seed = value;
+        } else if (i + 1 < argc && strcmp(argv[i], "--append") == 0) {
+            options->append_path = argv[i + 1];
+        } else if (argv[i][0] != '-' && !options->path) {
+            options->path = argv[i];
+            continue;
+        } else {
+            return 0;
+        }
+        i++;
+    }
+    return options->path != NULL;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        usage(argv[0]);
+        return 1;
+    }
+    rng_state = options.seed ? options.seed : BENCH_DEFAULT_SEED;
+
+    MovieDatabase db;
+    movie_db_init(&db);
+    char *error = NULL;
+    fprintf(stderr, "Loading %s...\n", options.path);
+    double start = now_ns();
+    int loaded = options.threads > 1 ? movie_db_load_from_csv_parallel(&db, options.path, options.threads, &error)
+                                     : movie_db_load_from_csv_mapped(&db, options.path, &error);
+    double load_ns = now_ns() - start;
+    if (!loaded) {
+        fprintf(stderr, "Failed to load %s: %s\n", options.path, error ? error : "unknown error");
+        free(error);
+        return 1;
+    }
+    if (db.count == 0) {
+        fprintf(stderr, "%s has no rows\n", options.path);
+        movie_db_free(&db);
+        return 1;
+    }
+
+    TitleIndex index;
+    title_index_init(&index);
+    start = now_ns();
+    int built = options.threads > 1 ? title_index_build_parallel(&index, &db, options.threads)
+                                    : title_index_build(&index, &db);
+    double index_ns = now_ns() - start;
+    if (!built) {
+        fprintf(stderr, "Failed to build the title index\n");
+        movie_db_free(&db);
+        return 1;
+    }
+    TitleAutocomplete completions;
+    title_autocomplete_init(&completions);
+    start = now_ns();
+    title_autocomplete_build(&completions, &index, &db);
+    double autocomplete_ns = now_ns() - start;
+    TitleFuzzyIndex fuzzy;
+    title_fuzzy_init(&fuzzy);
+    start = now_ns();
+    title_fuzzy_build(&fuzzy, &index, &db);
+    double fuzzy_ns = now_ns() - start;
+    FullTextIndex plots;
+    full_text_index_init(&plots);
+    start = now_ns();
+    full_text_index_build(&plots, &db, FULL_TEXT_DESCRIPTION | FULL_TEXT_TITLE);
+    double full_text_ns = now_ns() - start;
+
+    printf("{\n  \"schema\": %d,\n  \"catalog\": ", BENCH_SCHEMA);
+    print_json_string(options.path);
+    printf(",\n  \"movies\": %zu,\n  \"threads\": %zu,\n  \"cpus\": %zu,\n  \"seed\": %llu,\n", db.count,
+           options.threads, parallel_cpu_count(), (unsigned long long)options.seed);
+    printf("  \"load_ms\": %.2f,\n  \"index_build_ms\": %.2f,\n  \"autocomplete_build_ms\": %.2f,\n"
+           "  \"fuzzy_build_ms\": %.2f,\n  \"full_text_build_ms\": %.2f,\n  \"ops\": [\n",
+           load_ns / 1e6, index_ns / 1e6, autocomplete_ns / 1e6, fuzzy_ns / 1e6, full_text_ns / 1e6);
+    for (size_t i = 0; i < BENCH_OP_COUNT; ++i) {
+        const BenchOp *op = &bench_ops[i];
+        fprintf(stderr, "Timing %s...\n", op->name);
+        bench_op(op, &db, &index, &completions, &fuzzy, &plots, op->scan ? options.scan_queries : options.queries,
+                 options.threads);
+        printf(i + 1 < BENCH_OP_COUNT ? ",\n" : "\n");
+        fflush(stdout);
+    }
+    printf("  ],\n");
+    if (options.append_path) bench_appends(&db, options.append_path);
+    printf("  \"peak_rss_kb\": %ld\n}\n", peak_rss_kb());
+
+    title_autocomplete_free(&completions);
+    title_fuzzy_free(&fuzzy);
+    full_text_index_free(&plots);
+    title_index_free(&index);
+    movie_db_free(&db);
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "movie.h"
+
+/*
+ * Writes a synthetic catalog in the netflix CSV schema. Every column is drawn
+ * from the rows of a source catalog (normally the bundled dataset), so genre,
+ * director, cast, country and year frequencies follow the real data:
+ *
+ *   type, duration, rating and listed_in come from one source row (a TV show
+ *   keeps its seasons and TV genres), director and cast from another, and
+ *   country, date_added, release_year and description from one row each.
+ *   Titles join the start of one source title to the end of another, which
+ *   keeps real word lengths while making most titles distinct.
+ */
+
+#define GEN_DEFAULT_SEED 20191130u
+#define GEN_FIRST_SHOW_ID 90000000u
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    /* xorshift64* */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545f4914f6cdd1dull;
+}
+
+static const Movie *random_movie(const MovieDatabase *db) {
+    return &db->movies[rng_next() % db->count];
+}
+
+static void write_field(FILE *out, const char *value) {
+    if (!value) value = "";
+    if (!strpbrk(value, ",\"\r\n")) {
+        fputs(value, out);
+        return;
+    }
+    fputc('"', out);
+    for (const char *p = value; *p; ++p) {
+        if (*p == '"') fputc('"', out);
+        fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+/* The first words of one title followed by the last word of another. */
+static void make_title(const MovieDatabase *db, char *buffer, size_t size) {
+    const char *head = random_movie(db)->title;
+    const char *tail = random_movie(db)->title;
+    if (!head || !head[0]) head = "Untitled";
+    if (!tail) tail = "";
+
+    size_t head_len = strlen(head);
+    size_t words = 0;
+    for (size_t i = 0; i < head_len; ++i) {
+        if (head[i] == ' ') words++;
+    }
+    if (words > 0) {
+        size_t keep = (size_t)(rng_next() % words) + 1;
+        for (size_t i = 0; i < head_len; ++i) {
+            if (head[i] == ' ' && --keep == 0) {
+                head_len = i;
+                break;
+            }
+        }
+    }
+    const char *space = strrchr(tail, ' ');
+    tail = space ? space + 1 : tail;
+    if (tail[0] == '\0') {
+        snprintf(buffer, size, "%.*s", (int)head_len, head);
+    } else {
+        snprintf(buffer, size, "%.*s %s", (int)head_len, head, tail);
+    }
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--seed N] SOURCE.csv ROWS OUT.csv\n", program);
+}
+
+int main(int argc, char **argv) {
+    uint64_t seed = GEN_DEFAULT_SEED;
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "--seed") == 0) {
+        seed = strtoull(argv[arg + 1], NULL, 10);
+        arg += 2;
+    }
+    if (argc - arg != 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *source_path = argv[arg];
+    char *end = NULL;
+    unsigned long long rows = strtoull(argv[arg + 1], &end, 10);
+    if (!end || *end != '\0' || rows == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *out_path = argv[arg + 2];
+    rng_state = seed ? seed : GEN_DEFAULT_SEED;
+
+    MovieDatabase db;
+    movie_db_init(&db);
+    char *error = NULL;
+    if (!movie_db_load_from_csv(&db, source_path, &error)) {
+        fprintf(stderr, "Failed to load %s: %s\n", source_path, error ? error : "unknown error");
+        free(error);
+        return 1;
+    }
+    if (db.count == 0) {
+        fprintf(stderr, "%s has no rows to sample from\n", source_path);
+        movie_db_free(&db);
+        return 1;
+    }
+
+    FILE *out = fopen(out_path, "w");
+    if (!out) {
+        perror(out_path);
+        movie_db_free(&db);
+        return 1;
+    }
+    fputs("show_id,title,director,cast,country,date_added,release_year,rating,duration,listed_in,description,type\n", out);
+
+    char title[256];
+    char show_id[32];
+    for (unsigned long long i = 0; i < rows; ++i) {
+        const Movie *kind = random_movie(&db);
+        const Movie *people = random_movie(&db);
+        make_title(&db, title, sizeof(title));
+        snprintf(show_id, sizeof(show_id), "%llu", GEN_FIRST_SHOW_ID + i);
+
+        write_field(out, show_id);
+        fputc(',', out);
+        write_field(out, title);
+        fputc(',', out);
+        write_field(out, people->director);
+        fputc(',', out);
+        write_field(out, people->cast);
+        fputc(',', out);
+        write_field(out, random_movie(&db)->country);
+        fputc(',', out);
+        write_field(out, random_movie(&db)->date_added);
+        fputc(',', out);
+        write_field(out, random_movie(&db)->release_year);
+        fputc(',', out);
+        write_field(out, kind->rating);
+        fputc(',', out);
+        write_field(out, kind->duration);
+        fputc(',', out);
+        write_field(out, kind->listed_in);
+        fputc(',', out);
+        write_field(out, random_movie(&db)->description);
+        fputc(',', out);
+        write_field(out, kind->type);
+        fputc('\n', out);
+    }
+
+    int failed = ferror(out) != 0;
+    if (fclose(out) != 0) failed = 1;
+    movie_db_free(&db);
+    if (failed) {
+        fprintf(stderr, "Failed to write %s\n", out_path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "movie.h"
+#include "recommendation.h"
+
+/*
+ * Times the recommendation scoring kernels: every movie of the catalog
+ * scored against random source movies under each kernel the CPU supports,
+ * in blocks the size the scans use. Every kernel's keys are compared with
+ * the scalar kernel's, bit for bit. Prints JSON on stdout.
+ */
+
+#define RECO_BENCH_DEFAULT_SOURCES 50
+#define RECO_BENCH_SEED 42u
+#define RECO_BENCH_BLOCK 4096
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    /* xorshift64* */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545f4914f6cdd1dull;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size > 0 ? size : 1);
+    if (!ptr) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+/* Score the whole catalog against source into keys. */
+static void score_catalog(const MovieDatabase *db, size_t source, uint64_t *keys) {
+    for (size_t at = 0; at < db->count; at += RECO_BENCH_BLOCK) {
+        size_t count = db->count - at < RECO_BENCH_BLOCK ? db->count - at : RECO_BENCH_BLOCK;
+        recommendation_score_block(db, source, at, count, keys + at);
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t sources = RECO_BENCH_DEFAULT_SOURCES;
+    const char *path = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && strcmp(argv[i], "--sources") == 0) {
+            sources = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path || sources == 0) {
+        fprintf(stderr, "Usage: %s [--sources N] CATALOG.csv\n", argv[0]);
+        return 1;
+    }
+    rng_state = RECO_BENCH_SEED;
+
+    MovieDatabase db;
+    movie_db_init(&db);
+    char *error = NULL;
+    fprintf(stderr, "Loading %s...\n", path);
+    if (!movie_db_load_from_csv_mapped(&db, path, &error) || db.count == 0) {
+        fprintf(stderr, "Failed to load %s: %s\n", path, error ? error : "no rows");
+        free(error);
+        movie_db_free(&db);
+        return 1;
+    }
+
+    static const RecommendationKernel kernels[] = {RECOMMENDATION_KERNEL_SCALAR, RECOMMENDATION_KERNEL_AVX2};
+    const size_t kernel_count = sizeof(kernels) / sizeof(kernels[0]);
+    int supported[sizeof(kernels) / sizeof(kernels[0])];
+    for (size_t k = 0; k < kernel_count; ++k) supported[k] = recommendation_set_kernel(kernels[k]);
+    uint64_t *expected = (uint64_t *)checked_malloc(db.count * sizeof(uint64_t));
+    uint64_t *keys = (uint64_t *)checked_malloc(db.count * sizeof(uint64_t));
+    double *samples = (double *)checked_malloc(sources * kernel_count * sizeof(double));
+    size_t mismatches[sizeof(kernels) / sizeof(kernels[0])] = {0};
+
+    for (size_t s = 0; s < sources; ++s) {
+        size_t source = (size_t)(rng_next() % db.count);
+        recommendation_set_kernel(RECOMMENDATION_KERNEL_SCALAR);
+        score_catalog(&db, source, expected);
+        for (size_t k = 0; k < kernel_count; ++k) {
+            if (!supported[k]) continue;
+            recommendation_set_kernel(kernels[k]);
+            double start = now_ns();
+            score_catalog(&db, source, keys);
+            samples[k * sources + s] = now_ns() - start;
+            for (size_t i = 0; i < db.count; ++i) mismatches[k] += keys[i] != expected[i];
+        }
+    }
+    recommendation_set_kernel(RECOMMENDATION_KERNEL_AUTO);
+
+    printf("{\n  \"catalog\": \"%s\",\n  \"movies\": %zu,\n  \"sources\": %zu,\n  \"default_kernel\": \"%s\",\n"
+           "  \"kernels\": [\n", path, db.count, sources, recommendation_kernel_name(recommendation_active_kernel()));
+    size_t last_kernel = 0;
+    for (size_t k = 0; k < kernel_count; ++k) {
+        if (supported[k]) last_kernel = k;
+    }
+    int agree = 1;
+    for (size_t k = 0; k < kernel_count; ++k) {
+        if (!supported[k]) continue;
+        double *times = samples + k * sources;
+        qsort(times, sources, sizeof(double), compare_double);
+        double total = 0.0;
+        for (size_t s = 0; s < sources; ++s) total += times[s];
+        double mean = total / (double)sources;
+        printf("    {\"kernel\": \"%s\", \"p50_ns\": %.0f, \"mean_ns\": %.0f, \"rows_per_sec\": %.0f, \"mismatches\": %zu}%s\n",
+               recommendation_kernel_name(kernels[k]), times[sources / 2], mean,
+               mean > 0.0 ? (double)db.count / mean * 1e9 : 0.0, mismatches[k], k == last_kernel ? "" : ",");
+        if (mismatches[k] > 0) agree = 0;
+    }
+    printf("  ]\n}\n");
+
+    free(expected);
+    free(keys);
+    free(samples);
+    movie_db_free(&db);
+    if (!agree) {
+        fprintf(stderr, "A kernel disagreed with the scalar scores\n");
+        return 1;
+    }
+    return 0;
+}
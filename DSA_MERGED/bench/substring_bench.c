@@ -0,0 +1,234 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "movie.h"
+#include "substring.h"
+
+/*
+ * Times substring scans over real catalog columns: strstr on every string in
+ * turn (what the partial searches used to do) against one text_blob_search
+ * pass under each kernel the CPU supports. Needles are slices of the column
+ * itself, so most of them match somewhere. Prints JSON on stdout.
+ */
+
+#define SUBSTRING_BENCH_DEFAULT_NEEDLES 200
+#define SUBSTRING_BENCH_SEED 42u
+#define SUBSTRING_BENCH_MIN_NEEDLE 3
+#define SUBSTRING_BENCH_MAX_NEEDLE 8
+
+typedef struct {
+    const char *name;
+    char **strings; /* lowercase copies */
+    size_t count;
+    TextBlob blob;
+} BenchColumn;
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    /* xorshift64* */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545f4914f6cdd1dull;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static char *lowercase_copy(const char *text) {
+    size_t len = strlen(text);
+    char *copy = (char *)malloc(len + 1);
+    if (!copy) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i <= len; ++i) copy[i] = (char)tolower((unsigned char)text[i]);
+    return copy;
+}
+
+static void column_init(BenchColumn *column, const char *name, size_t capacity) {
+    column->name = name;
+    column->strings = (char **)malloc((capacity > 0 ? capacity : 1) * sizeof(char *));
+    if (!column->strings) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    column->count = 0;
+    text_blob_init(&column->blob);
+}
+
+static void column_add(BenchColumn *column, const char *text) {
+    char *copy = lowercase_copy(text ? text : "");
+    column->strings[column->count++] = copy;
+    text_blob_add(&column->blob, copy);
+}
+
+static void column_free(BenchColumn *column) {
+    for (size_t i = 0; i < column->count; ++i) free(column->strings[i]);
+    free(column->strings);
+    text_blob_free(&column->blob);
+}
+
+/* A slice of a random string of the column, or "" when the pick is too short. */
+static void pick_needle(const BenchColumn *column, char *needle, size_t size) {
+    const char *text = column->strings[rng_next() % column->count];
+    size_t len = strlen(text);
+    size_t want = SUBSTRING_BENCH_MIN_NEEDLE + (size_t)(rng_next() % (SUBSTRING_BENCH_MAX_NEEDLE - SUBSTRING_BENCH_MIN_NEEDLE + 1));
+    needle[0] = '\0';
+    if (len < want || want >= size) return;
+    size_t start = (size_t)(rng_next() % (len - want + 1));
+    memcpy(needle, text + start, want);
+    needle[want] = '\0';
+}
+
+static size_t scan_strstr(const BenchColumn *column, const char *needle) {
+    size_t matches = 0;
+    for (size_t i = 0; i < column->count; ++i) {
+        if (strstr(column->strings[i], needle)) matches++;
+    }
+    return matches;
+}
+
+static size_t scan_blob(const BenchColumn *column, const char *needle) {
+    uint32_t *ids = NULL;
+    size_t count = 0;
+    text_blob_search(&column->blob, needle, &ids, &count);
+    free(ids);
+    return count;
+}
+
+static void print_method(const char *name, double *samples, size_t taken, int last) {
+    qsort(samples, taken, sizeof(double), compare_double);
+    double total = 0.0;
+    for (size_t i = 0; i < taken; ++i) total += samples[i];
+    printf("        {\"method\": \"%s\", \"p50_ns\": %.0f, \"mean_ns\": %.0f}%s\n", name,
+           taken > 0 ? samples[taken / 2] : 0.0, taken > 0 ? total / (double)taken : 0.0, last ? "" : ",");
+}
+
+/* Returns 0 when a kernel disagreed with strstr. */
+static int bench_column(const BenchColumn *column, size_t needles, int last) {
+    static const SubstringKernel kernels[] = {SUBSTRING_KERNEL_SCALAR, SUBSTRING_KERNEL_SSE2, SUBSTRING_KERNEL_AVX2};
+    const size_t kernel_count = sizeof(kernels) / sizeof(kernels[0]);
+    double *samples = (double *)malloc((needles > 0 ? needles : 1) * (kernel_count + 1) * sizeof(double));
+    if (!samples) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    int supported[sizeof(kernels) / sizeof(kernels[0])];
+    for (size_t k = 0; k < kernel_count; ++k) supported[k] = substring_set_kernel(kernels[k]);
+
+    int agree = 1;
+    size_t taken = 0;
+    size_t matches = 0;
+    char needle[SUBSTRING_BENCH_MAX_NEEDLE + 1];
+    for (size_t i = 0; i < needles; ++i) {
+        pick_needle(column, needle, sizeof(needle));
+        if (needle[0] == '\0') continue;
+        double start = now_ns();
+        size_t expected = scan_strstr(column, needle);
+        samples[taken] = now_ns() - start;
+        for (size_t k = 0; k < kernel_count; ++k) {
+            if (!supported[k]) continue;
+            substring_set_kernel(kernels[k]);
+            start = now_ns();
+            size_t found = scan_blob(column, needle);
+            samples[(k + 1) * needles + taken] = now_ns() - start;
+            if (found != expected) agree = 0;
+        }
+        matches += expected;
+        taken++;
+    }
+    substring_set_kernel(SUBSTRING_KERNEL_AUTO);
+
+    printf("    {\"column\": \"%s\", \"strings\": %zu, \"bytes\": %zu, \"needles\": %zu, \"mean_matches\": %.1f, \"methods\": [\n",
+           column->name, column->count, column->blob.length, taken, taken > 0 ? (double)matches / (double)taken : 0.0);
+    size_t last_kernel = 0;
+    for (size_t k = 0; k < kernel_count; ++k) {
+        if (supported[k]) last_kernel = k + 1;
+    }
+    print_method("strstr", samples, taken, last_kernel == 0);
+    for (size_t k = 0; k < kernel_count; ++k) {
+        if (!supported[k]) continue;
+        print_method(substring_kernel_name(kernels[k]), samples + (k + 1) * needles, taken, k + 1 == last_kernel);
+    }
+    printf("    ]}%s\n", last ? "" : ",");
+    free(samples);
+    return agree;
+}
+
+int main(int argc, char **argv) {
+    size_t needles = SUBSTRING_BENCH_DEFAULT_NEEDLES;
+    const char *path = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && strcmp(argv[i], "--needles") == 0) {
+            needles = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: %s [--needles N] CATALOG.csv\n", argv[0]);
+        return 1;
+    }
+    rng_state = SUBSTRING_BENCH_SEED;
+
+    MovieDatabase db;
+    movie_db_init(&db);
+    char *error = NULL;
+    fprintf(stderr, "Loading %s...\n", path);
+    if (!movie_db_load_from_csv_mapped(&db, path, &error) || db.count == 0) {
+        fprintf(stderr, "Failed to load %s: %s\n", path, error ? error : "no rows");
+        free(error);
+        movie_db_free(&db);
+        return 1;
+    }
+
+    BenchColumn columns[3];
+    column_init(&columns[0], "title", db.count);
+    column_init(&columns[1], "person", db.people.names.count);
+    column_init(&columns[2], "description", db.count);
+    for (size_t i = 0; i < db.count; ++i) {
+        column_add(&columns[0], db.movies[i].title_lower);
+        column_add(&columns[2], db.movies[i].description);
+    }
+    for (size_t i = 0; i < db.people.names.count; ++i) {
+        column_add(&columns[1], db.people.names.names[i]);
+    }
+
+    printf("{\n  \"catalog\": \"%s\",\n  \"movies\": %zu,\n  \"default_kernel\": \"%s\",\n  \"columns\": [\n", path, db.count,
+           substring_kernel_name(substring_active_kernel()));
+    int agree = 1;
+    for (size_t c = 0; c < 3; ++c) {
+        fprintf(stderr, "Timing %s...\n", columns[c].name);
+        if (!bench_column(&columns[c], needles, c == 2)) agree = 0;
+        fflush(stdout);
+    }
+    printf("  ]\n}\n");
+
+    for (size_t c = 0; c < 3; ++c) column_free(&columns[c]);
+    movie_db_free(&db);
+    if (!agree) {
+        fprintf(stderr, "A kernel disagreed with strstr\n");
+        return 1;
+    }
+    return 0;
+}
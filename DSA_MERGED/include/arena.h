@@ -0,0 +1,36 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* One malloc'd block of the arena; allocations are bumped out of data[]. */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t used;
+    size_t capacity;
+    unsigned char data[];
+} ArenaChunk;
+
+/*
+ * Growable bump allocator. Everything allocated from it lives until
+ * arena_free, which releases the whole arena with one free per chunk.
+ */
+typedef struct {
+    ArenaChunk *head;       /* most recent chunk, allocations come from here */
+    size_t next_chunk_size; /* doubles with every chunk up to ARENA_MAX_CHUNK */
+    size_t chunk_count;
+    size_t bytes_reserved;  /* total chunk bytes obtained from malloc */
+    size_t bytes_used;      /* bytes handed out, including alignment padding */
+} Arena;
+
+void arena_init(Arena *arena);
+void arena_free(Arena *arena);
+
+void *arena_alloc(Arena *arena, size_t size, size_t align);
+char *arena_strdup(Arena *arena, const char *src);
+char *arena_strndup(Arena *arena, const char *src, size_t n);
+
+/* Move every chunk of src into dst; src is left empty. */
+void arena_adopt(Arena *dst, Arena *src);
+
+#endif /* ARENA_H */
@@ -0,0 +1,57 @@
+#ifndef AUTOCOMPLETE_H
+#define AUTOCOMPLETE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "movie.h"
+#include "search.h"
+
+#define AUTOCOMPLETE_NO_KEY UINT32_MAX
+
+/*
+ * One radix trie node: the edge into it is bytes [label_start, label_end) of
+ * the key_lower of label_key. Children are contiguous and ordered by best,
+ * highest first. Scores are unique, so a weight tie goes to the title that
+ * sorts first.
+ */
+typedef struct {
+    uint32_t label_key;
+    uint32_t label_start;
+    uint32_t label_end;    /* also the depth of the node */
+    uint32_t first_child;
+    uint32_t child_count;
+    uint32_t key_id;       /* title index key ending here, or AUTOCOMPLETE_NO_KEY */
+    uint64_t score;        /* of key_id: weight in the high half, reverse title rank in the low */
+    uint64_t best;         /* highest score in the subtree */
+} AutocompleteNode;
+
+/*
+ * Prefix completions over the keys of a TitleIndex. Each key gets a weight
+ * when the trie is built (the newest release year among its movies), and a
+ * query walks the prefix and then pops subtrees best-first from a small heap,
+ * so the cost is the prefix length plus about k heap operations per level,
+ * whatever the catalog size. Labels are read from the index, which must
+ * outlive the trie; rebuild it when the index gains keys.
+ */
+typedef struct {
+    const TitleIndex *index;
+    AutocompleteNode *nodes; /* nodes[0] is the root */
+    size_t node_count;
+    size_t key_count;        /* index->size when built */
+} TitleAutocomplete;
+
+void title_autocomplete_init(TitleAutocomplete *ac);
+void title_autocomplete_free(TitleAutocomplete *ac);
+int title_autocomplete_build(TitleAutocomplete *ac, const TitleIndex *index, const MovieDatabase *db);
+/* The index gained or lost keys since the trie was built. */
+int title_autocomplete_is_stale(const TitleAutocomplete *ac, const TitleIndex *index);
+
+/*
+ * Up to k key ids of the best-weighted titles starting with prefix_lower,
+ * best first (ties by title). out_key_ids has room for k ids; the matching
+ * movies are index->entries[id].indices. Returns 0 when nothing matches.
+ */
+int title_autocomplete(const TitleAutocomplete *ac, const char *prefix_lower, size_t k, uint32_t *out_key_ids, size_t *out_count);
+
+#endif /* AUTOCOMPLETE_H */
@@ -0,0 +1,26 @@
+#ifndef CASEFOLD_H
+#define CASEFOLD_H
+
+#include <stddef.h>
+
+/* Also drop accents and other diacritics: "Amélie" and "amelie" fold alike. */
+#define CASEFOLD_STRIP_ACCENTS 1u
+
+/* The folding of every search key, at load time and at query time alike. */
+#define CASEFOLD_KEYS CASEFOLD_STRIP_ACCENTS
+
+/*
+ * Fold n bytes of UTF-8 text into dst and NUL-terminate it; returns the
+ * folded length, which is never more than n, so dst needs n + 1 bytes and
+ * may be src itself. Runs of ASCII are lowercased 16 bytes at a time. Other
+ * characters get their Unicode case folding for Latin, Greek and Cyrillic
+ * (so "ß" becomes "ss"); with CASEFOLD_STRIP_ACCENTS Latin and Greek
+ * letters also lose their diacritics and combining marks are dropped.
+ * Bytes that are not valid UTF-8 are copied unchanged.
+ */
+size_t casefold(char *dst, const char *src, size_t n, unsigned flags);
+
+/* casefold over a NUL-terminated string, in place; returns the new length. */
+size_t casefold_inplace(char *text, unsigned flags);
+
+#endif /* CASEFOLD_H */
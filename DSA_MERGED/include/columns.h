@@ -0,0 +1,172 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "resultset.h"
+
+/* Fixed-width genre bitset: genre ids below GENRE_SET_CAPACITY get a bit. */
+#define GENRE_SET_WORDS 2
+#define GENRE_SET_CAPACITY (GENRE_SET_WORDS * 64)
+
+typedef struct {
+    uint64_t words[GENRE_SET_WORDS];
+} GenreSet;
+
+#define MOVIE_TYPE_UNKNOWN 0
+#define MOVIE_TYPE_MOVIE 1
+#define MOVIE_TYPE_TV_SHOW 2
+
+/*
+ * Interns distinct strings (director_lower, genres) to dense ids. Names are
+ * borrowed from the movies they first appeared in.
+ */
+typedef struct {
+    const char **names;  /* id -> name */
+    size_t *hashes;      /* id -> string_dictionary_hash(name) */
+    size_t count;
+    size_t capacity;
+    uint32_t *slots;     /* open-addressing table of id + 1, 0 = empty */
+    size_t slot_count;   /* power of two */
+} StringDictionary;
+
+/*
+ * Movies sorted by (value, index), kept as a base order plus a small sorted
+ * delta of the rows appended since the base was built. Appended rows have
+ * larger indices than every base row, so on equal values the base comes
+ * first. An append merges into the delta only; the delta is folded into the
+ * base once it outgrows 1 / MOVIE_ORDER_FOLD_FRACTION of it.
+ */
+typedef struct {
+    uint32_t *base;
+    size_t base_count;
+    uint32_t *delta;
+    size_t delta_count;
+} MovieOrder;
+
+#define MOVIE_ORDER_FOLD_FRACTION 8
+
+/* Part of a MovieOrder: positions [lo, hi) of its base and of its delta. */
+typedef struct {
+    size_t base_lo;
+    size_t base_hi;
+    size_t delta_lo;
+    size_t delta_hi;
+} MovieOrderSlice;
+
+/*
+ * Structure-of-arrays copy of the fields the scan searches and the
+ * recommendation scorer read, so a scan touches only the bytes it compares.
+ */
+typedef struct {
+    size_t count;
+    size_t capacity;
+    int *release_year;          /* Movie.release_year_num */
+    int *date_added;            /* Movie.date_added_days */
+    uint32_t *director_id;      /* id in directors, COLUMNS_NO_DIRECTOR when empty */
+    GenreSet *genre_set;        /* Movie.genre_set */
+    unsigned char *type_code;   /* MOVIE_TYPE_* */
+    StringDictionary directors; /* distinct non-empty director_lower values */
+    StringDictionary genres;    /* every distinct genre of the catalog, interned at load */
+    int genre_overflow;         /* more than GENRE_SET_CAPACITY genres: sets are incomplete */
+    ResultSet *genre_movies;    /* genre id -> movies listing it, for every genre */
+    size_t genre_movies_count;
+    ResultSet *year_movies;     /* release year - year_first -> movies of that year */
+    int year_first;
+    size_t year_span;           /* years covered by year_movies, 0 when none */
+    MovieOrder year_order;      /* movies with a positive release year, by (year, index) */
+    MovieOrder added_order;     /* movies with a known date_added, by (date, index) */
+    int borrowed;               /* the per-row arrays and orders point into a mapped snapshot */
+} MovieColumns;
+
+#define COLUMNS_NO_DIRECTOR UINT32_MAX
+#define COLUMNS_NOT_FOUND UINT32_MAX
+
+/* Number of set bits, e.g. the genres two masks share. */
+static inline int columns_popcount64(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(mask);
+#else
+    int count = 0;
+    while (mask) {
+        mask &= mask - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+static inline void genre_set_clear(GenreSet *set) {
+    for (size_t w = 0; w < GENRE_SET_WORDS; ++w) set->words[w] = 0;
+}
+
+/* Returns 0 when id does not fit in the set. */
+static inline int genre_set_add(GenreSet *set, uint32_t id) {
+    if (id >= GENRE_SET_CAPACITY) return 0;
+    set->words[id / 64] |= (uint64_t)1 << (id % 64);
+    return 1;
+}
+
+static inline int genre_set_is_empty(const GenreSet *set) {
+    uint64_t any = 0;
+    for (size_t w = 0; w < GENRE_SET_WORDS; ++w) any |= set->words[w];
+    return any == 0;
+}
+
+static inline int genre_set_intersects(const GenreSet *a, const GenreSet *b) {
+    uint64_t any = 0;
+    for (size_t w = 0; w < GENRE_SET_WORDS; ++w) any |= a->words[w] & b->words[w];
+    return any != 0;
+}
+
+/* Genres the two sets share. */
+static inline int genre_set_overlap(const GenreSet *a, const GenreSet *b) {
+    int count = 0;
+    for (size_t w = 0; w < GENRE_SET_WORDS; ++w) count += columns_popcount64(a->words[w] & b->words[w]);
+    return count;
+}
+
+void string_dictionary_init(StringDictionary *dict);
+void string_dictionary_free(StringDictionary *dict);
+size_t string_dictionary_hash(const char *name);
+/* Id of name, adding it when absent. */
+uint32_t string_dictionary_intern(StringDictionary *dict, const char *name);
+/* Id of name, or COLUMNS_NOT_FOUND. */
+uint32_t string_dictionary_find(const StringDictionary *dict, const char *name);
+/* Same as above for callers that already computed string_dictionary_hash(name). */
+uint32_t string_dictionary_intern_hashed(StringDictionary *dict, const char *name, size_t hash);
+uint32_t string_dictionary_find_hashed(const StringDictionary *dict, const char *name, size_t hash);
+
+void movie_columns_init(MovieColumns *columns);
+/* Grow the (uninitialised) column storage to hold at least count movies, keeping existing rows;
+ * arrays borrowed from a snapshot are copied first. */
+void movie_columns_reserve(MovieColumns *columns, size_t count);
+void movie_columns_free(MovieColumns *columns);
+/* Merge rows [first, count) into year_order and added_order; earlier rows keep their place.
+ * Orders lent by a snapshot must have been copied by movie_columns_reserve first. */
+void movie_columns_extend_orders(MovieColumns *columns, size_t first);
+/* First position in order whose value is at least value, by binary search. */
+size_t movie_columns_lower_bound(const uint32_t *order, size_t count, const int *values, int value);
+
+size_t movie_order_count(const MovieOrder *order);
+/* The whole order, and the movies whose value is in [from, to]; to may be INT_MAX. */
+void movie_order_all(const MovieOrder *order, MovieOrderSlice *slice);
+void movie_order_range(const MovieOrder *order, const int *values, int from, int to, MovieOrderSlice *slice);
+size_t movie_order_slice_count(const MovieOrderSlice *slice);
+/* Smallest and largest value in slice; 0 when it is empty. */
+int movie_order_first_value(const MovieOrder *order, const int *values, const MovieOrderSlice *slice, int *value);
+int movie_order_last_value(const MovieOrder *order, const int *values, const MovieOrderSlice *slice, int *value);
+/* Move up to max movies from the front of slice, in (value, index) order, to out
+ * (NULL drops them); returns how many. */
+size_t movie_order_take(const MovieOrder *order, const int *values, MovieOrderSlice *slice, size_t *out, size_t max);
+/* Same from the back of slice, largest (value, index) first. */
+size_t movie_order_take_last(const MovieOrder *order, const int *values, MovieOrderSlice *slice, size_t *out,
+                             size_t max);
+/* Movie sets of a genre id and a release year, grown on demand; year must be positive. */
+ResultSet *movie_columns_genre_movies(MovieColumns *columns, uint32_t genre_id);
+ResultSet *movie_columns_year_movies(MovieColumns *columns, int year);
+/* The set of a year, or NULL when no movie has it. */
+const ResultSet *movie_columns_find_year(const MovieColumns *columns, int year);
+
+#endif /* COLUMNS_H */
@@ -0,0 +1,92 @@
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "columns.h"
+#include "movie.h"
+#include "people.h"
+#include "resultset.h"
+#include "search.h"
+
+/* What a text cursor matches; the *_PARTIAL kinds take a substring, like the search_*_partial functions. */
+typedef enum {
+    SEARCH_TITLE,
+    SEARCH_TITLE_PARTIAL,
+    SEARCH_DIRECTOR,
+    SEARCH_DIRECTOR_PARTIAL,
+    SEARCH_CAST,
+    SEARCH_CAST_PARTIAL,
+    SEARCH_GENRE,
+    SEARCH_GENRE_PARTIAL
+} SearchKind;
+
+/*
+ * Incremental form of the search_* functions: the same movies in the same
+ * order, handed out a batch at a time. Where the source allows it the work
+ * is done as batches are asked for (title keys are verified, rows scanned
+ * and person posting lists merged on demand), so a first page costs
+ * about a page's worth of matches however many there are in all. The cursor
+ * points into the catalog and indexes, which must not change while it is
+ * open, and into itself, so it must not be copied once opened.
+ */
+typedef struct {
+    int source;                  /* how movies are produced, see cursor.c */
+    const MovieDatabase *db;
+    const TitleIndex *titles;
+    char *needle;                /* owned copy of the substring, for sources verified on demand */
+    size_t needle_len;
+    uint32_t *keys;              /* trigram candidates, verified on demand; NULL when scanning key text */
+    size_t key_count;
+    size_t next;                 /* next candidate, title key, row or order position */
+    size_t end;
+    const size_t *run;           /* movies of the title being handed out */
+    size_t run_count;
+    size_t run_pos;
+    const MovieOrder *order;     /* a sorted order handed out over slice */
+    const int *order_values;
+    MovieOrderSlice slice;
+    ResultSet set;               /* owned set, e.g. the OR of several genres */
+    ResultSetIterator set_it;
+    PersonPostingRuns *lists;    /* one per matching person */
+    size_t *list_pos;
+    size_t list_count;
+    uint64_t *heap;              /* next movie << 32 | list, smallest first */
+    size_t heap_count;
+    size_t last_movie;           /* last movie merged, to drop a movie shared by two people */
+    unsigned char *wanted;       /* director ids to keep, for whole-field scans */
+    GenreSet genres;             /* genre ids to keep, for genre scans */
+    size_t emitted;
+    size_t total;                /* exact when total_exact, else an upper bound or 0 */
+    int total_exact;
+    size_t consumed;             /* postings merged so far */
+    int done;
+} SearchCursor;
+
+void search_cursor_init(SearchCursor *cursor);
+void search_cursor_close(SearchCursor *cursor);
+
+/*
+ * Start a search for text_lower. titles is only read by the title kinds.
+ * Returns 0 when nothing can match; a cursor opened with 1 can still turn
+ * out empty, so callers go by what search_cursor_next hands out.
+ */
+int search_cursor_open(SearchCursor *cursor, const MovieDatabase *db, const TitleIndex *titles, SearchKind kind,
+                       const char *text_lower);
+/* Movies released in [from, to], oldest first; to may be INT_MAX. */
+int search_cursor_open_years(SearchCursor *cursor, const MovieDatabase *db, int from, int to);
+/* The movies of a set, ascending; the set must outlive the cursor. */
+int search_cursor_open_set(SearchCursor *cursor, const ResultSet *set);
+
+/* Write up to max more movies to out; returns how many, 0 once the cursor is exhausted. */
+size_t search_cursor_next(SearchCursor *cursor, size_t *out, size_t max);
+
+/*
+ * Matches in all. Exact (and *exact set) when the source knows its size or
+ * the cursor is exhausted; otherwise extrapolated from the share of the
+ * source scanned so far, and never below what has been handed out.
+ */
+size_t search_cursor_estimate(const SearchCursor *cursor, int *exact);
+
+#endif /* CURSOR_H */
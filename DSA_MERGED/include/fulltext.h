@@ -0,0 +1,60 @@
+#ifndef FULLTEXT_H
+#define FULLTEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "columns.h"
+#include "movie.h"
+
+/* Fields a FullTextIndex can cover; a movie's covered fields form one document. */
+#define FULL_TEXT_DESCRIPTION 1u
+#define FULL_TEXT_TITLE 2u
+#define FULL_TEXT_CAST 4u
+
+/* Okapi BM25 parameters: term frequency saturation and length normalisation. */
+#define FULL_TEXT_BM25_K1 1.2
+#define FULL_TEXT_BM25_B 0.75
+
+typedef struct {
+    size_t movie_index;
+    double score;
+} FullTextMatch;
+
+/*
+ * Inverted index over the words of some text fields of every movie. Terms
+ * are lowercase ASCII words (bytes of multi-byte UTF-8 characters count as
+ * letters), minus a short list of English stop words. Each term has a posting
+ * list of (movie, term frequency) in movie order, and each movie its length
+ * in terms, which is all BM25 needs. Like the other derived indexes it is
+ * built on first use and rebuilt when the catalog grows.
+ */
+typedef struct {
+    unsigned fields;          /* FULL_TEXT_* flags the index was built over */
+    size_t doc_count;         /* db->count when built */
+    StringDictionary terms;   /* owned by arena */
+    Arena arena;
+    size_t *term_offsets;     /* term id -> first posting; terms.count + 1 entries */
+    uint32_t *posting_docs;   /* ascending movie indices per term */
+    uint16_t *posting_freqs;  /* occurrences of the term in that movie, saturated */
+    double *term_max_weight;  /* term id -> best BM25 weight (before idf) over its postings */
+    uint32_t *doc_lengths;    /* movie -> terms in its document */
+    double average_length;
+    int built;
+} FullTextIndex;
+
+void full_text_index_init(FullTextIndex *index);
+void full_text_index_free(FullTextIndex *index);
+int full_text_index_build(FullTextIndex *index, const MovieDatabase *db, unsigned fields);
+/* The catalog changed size, or a different set of fields is wanted. */
+int full_text_index_is_stale(const FullTextIndex *index, const MovieDatabase *db, unsigned fields);
+
+/*
+ * The k movies with the highest BM25 score for the words of query (any case),
+ * best first; ties go to the earlier movie. A movie needs at least one query
+ * term to score. out has room for k matches. Returns 0 when no movie matches.
+ */
+int full_text_search(const FullTextIndex *index, const char *query, size_t k, FullTextMatch *out, size_t *out_count);
+
+#endif /* FULLTEXT_H */
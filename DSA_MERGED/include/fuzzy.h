@@ -0,0 +1,69 @@
+#ifndef FUZZY_H
+#define FUZZY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "columns.h"
+#include "movie.h"
+#include "search.h"
+
+/* Deletions are generated from the first FUZZY_PREFIX_LENGTH bytes of a word. */
+#define FUZZY_PREFIX_LENGTH 7
+/* Deletions per prefix, on the index side and at most on the query side. */
+#define FUZZY_INDEX_DELETES 2
+/* Largest edit distance a query tolerates, reached from 8 bytes on. */
+#define FUZZY_MAX_DISTANCE 3
+
+typedef struct {
+    uint32_t key_id;   /* into the TitleIndex the fuzzy index was built over */
+    uint32_t distance; /* Levenshtein distance between the query and the key */
+} TitleFuzzyMatch;
+
+/*
+ * Typo-tolerant lookup over the keys of a TitleIndex, in the SymSpell style.
+ * Titles are split into words; every distinct word is stored under the hashes
+ * of its prefix with up to FUZZY_INDEX_DELETES bytes deleted, so the words
+ * close to a query word are found by deleting bytes from the query instead of
+ * comparing it with the whole vocabulary. The query word whose close words
+ * carry the fewest titles supplies the candidates, which are then checked
+ * against the whole query with a bounded edit distance.
+ *
+ * A word is found when its prefix is within FUZZY_INDEX_DELETES edits of the
+ * query word's prefix, so a title with three typos in the first bytes of
+ * every word is missed, as is one whose words were run together or split.
+ * Like the autocomplete trie, the index reads keys
+ * from the TitleIndex, which must outlive it; rebuild it when the index
+ * gains keys.
+ */
+typedef struct {
+    const TitleIndex *index;
+    size_t key_count;         /* index->size when built */
+    StringDictionary words;   /* distinct title words, owned by arena */
+    Arena arena;
+    size_t *word_offsets;     /* word id -> first posting; words.count + 1 entries */
+    uint64_t *word_postings;  /* key length << 32 | key id of the titles holding each word, ascending */
+    uint64_t *deletes;        /* hash of a deleted prefix << 32 | word id, ascending */
+    size_t delete_count;
+    int *weights;             /* key id -> title_index_key_weight */
+    uint32_t *letters;        /* key id -> letters present, to skip hopeless keys */
+} TitleFuzzyIndex;
+
+void title_fuzzy_init(TitleFuzzyIndex *fuzzy);
+void title_fuzzy_free(TitleFuzzyIndex *fuzzy);
+int title_fuzzy_build(TitleFuzzyIndex *fuzzy, const TitleIndex *index, const MovieDatabase *db);
+/* The index gained or lost keys since the fuzzy index was built. */
+int title_fuzzy_is_stale(const TitleFuzzyIndex *fuzzy, const TitleIndex *index);
+
+/* Edit distance a query of query_len bytes tolerates: 0 below 3 bytes, 1 below 5, 2 below 8, then 3. */
+size_t title_fuzzy_max_distance(size_t query_len);
+
+/*
+ * Up to k keys within title_fuzzy_max_distance of query_lower, nearest first,
+ * then by weight (newest first) and title. out has room for k matches.
+ * Returns 0 when nothing is close enough.
+ */
+int title_fuzzy_search(const TitleFuzzyIndex *fuzzy, const char *query_lower, size_t k, TitleFuzzyMatch *out, size_t *out_count);
+
+#endif /* FUZZY_H */
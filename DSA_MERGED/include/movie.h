@@ -1,7 +1,15 @@
 #ifndef MOVIE_H
 #define MOVIE_H
 
+#include <limits.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "columns.h"
+#include "people.h"
+
+#define MOVIE_DATE_UNKNOWN INT_MIN
 
 typedef struct {
     char *show_id;
@@ -15,23 +23,60 @@ typedef struct {
     char *date_added;
     char *release_year;
     int release_year_num;
+    int date_added_days;  /* date_added as days since 1970-01-01, or MOVIE_DATE_UNKNOWN */
     char *rating;
     char *duration;
     char *listed_in;
     char *description;
     char **genres;
     size_t genre_count;
+    GenreSet genre_set;   /* ids of genres in the catalog's genre dictionary */
 } Movie;
 
 typedef struct {
     Movie *movies;
     size_t count;
     size_t capacity;
+    char *mapped_data;    /* private file mapping the raw fields point into, or NULL */
+    size_t mapped_length;
+    Arena arena;          /* owns every copied field, lowercase key and genre array */
+    MovieColumns columns; /* hot fields in column form, built by every loader */
+    PersonIndex people;   /* individual directors and cast members with their movies */
+    uint64_t generation;  /* changes whenever rows are loaded or appended, never repeats */
 } MovieDatabase;
 
 void movie_db_init(MovieDatabase *db);
 int movie_db_load_from_csv(MovieDatabase *db, const char *path, char **error_message);
+
+/* Map the CSV file and parse it in place: the raw Movie fields become views into
+ * the mapping instead of separately allocated copies. Falls back to
+ * movie_db_load_from_csv when the file cannot be mapped. */
+int movie_db_load_from_csv_mapped(MovieDatabase *db, const char *path, char **error_message);
+
+/* Same result as movie_db_load_from_csv_mapped, with the mapping split at record
+ * boundaries and the chunks parsed on up to `threads` worker threads. Movies keep
+ * the order, and therefore the indices, the serial loader gives them. */
+int movie_db_load_from_csv_parallel(MovieDatabase *db, const char *path, size_t threads, char **error_message);
 void movie_db_free(MovieDatabase *db);
 
+/* Parse another CSV file (with its own header row) and append its rows. Existing
+ * movies keep their indices; the new ones start at *out_first. Columns and the
+ * person index are extended with the new rows only. A file that adds no rows
+ * returns 0 and leaves db, and its generation, untouched. */
+int movie_db_append_from_csv(MovieDatabase *db, const char *path, size_t *out_first, char **error_message);
+
+/* Days since 1970-01-01 of a date written "November 30, 2019" (the dataset's
+ * form, month names may be abbreviated) or "2019-11-30"; MOVIE_DATE_UNKNOWN
+ * when text is neither. */
+int movie_parse_date(const char *text);
+
+/* Give db a generation no other catalog of the process has had; for loaders
+ * that fill db outside movie.c. */
+void movie_db_new_generation(MovieDatabase *db);
+
+/* (Re)intern genres, directors and people and rebuild db->columns, db->people
+ * and every Movie.genre_set; the CSV loaders call this before returning. */
+void movie_db_build_columns(MovieDatabase *db);
+
 #endif /* MOVIE_H */
 
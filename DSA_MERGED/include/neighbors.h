@@ -0,0 +1,47 @@
+#ifndef NEIGHBORS_H
+#define NEIGHBORS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "movie.h"
+
+/* Bumped whenever the file layout or the ranking changes; older files are rejected. */
+#define NEIGHBOR_GRAPH_VERSION 1
+/* Neighbors kept per movie: what the recommendation menu asks for. */
+#define NEIGHBOR_GRAPH_DEFAULT_K 20
+
+/*
+ * Each movie's best recommendations, precomputed, as a CSR adjacency: the
+ * neighbors of movie i are neighbors[offsets[i] .. offsets[i + 1]), best
+ * first, with their packed ranking keys (see recommendation_key_pack) in
+ * keys. A graph only answers for the catalog generation it was built or
+ * loaded against; anything else falls back to live scoring.
+ */
+typedef struct {
+    size_t movie_count;
+    size_t k;             /* neighbors kept per movie, at most */
+    uint64_t generation;  /* db->generation the graph is valid for, 0 when empty */
+    uint64_t *offsets;    /* movie_count + 1 entries */
+    uint32_t *neighbors;
+    uint64_t *keys;
+} NeighborGraph;
+
+void neighbor_graph_init(NeighborGraph *graph);
+void neighbor_graph_free(NeighborGraph *graph);
+
+/* Rank every movie's k best neighbors, spreading the movies over threads workers. */
+int neighbor_graph_build(NeighborGraph *graph, const MovieDatabase *db, size_t k, size_t threads);
+
+/* Whether graph can answer for db with up to k neighbors. */
+int neighbor_graph_covers(const NeighborGraph *graph, const MovieDatabase *db, size_t k);
+
+/*
+ * Write graph to path along with a fingerprint of the catalog it was built
+ * for, so a later load can reject a graph of another catalog.
+ */
+int neighbor_graph_write(const char *path, const NeighborGraph *graph, const MovieDatabase *db, char **error_message);
+/* Read a graph written for the catalog now in db; 0 with *error_message set when missing, corrupt or stale. */
+int neighbor_graph_load(const char *path, NeighborGraph *graph, const MovieDatabase *db, char **error_message);
+
+#endif /* NEIGHBORS_H */
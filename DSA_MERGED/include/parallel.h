@@ -0,0 +1,19 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+typedef void (*ParallelTask)(void *ctx, size_t worker, size_t workers);
+
+/*
+ * Run task(ctx, worker, workers) for every worker in [0, workers) and wait for
+ * all of them. The calling thread acts as worker 0. Workers must not wait on
+ * each other: if threads cannot be started the remaining workers run one
+ * after another on the calling thread.
+ */
+void parallel_run(size_t workers, ParallelTask task, void *ctx);
+
+/* Number of online processors, at least 1. */
+size_t parallel_cpu_count(void);
+
+#endif /* PARALLEL_H */
@@ -0,0 +1,74 @@
+#ifndef PEOPLE_H
+#define PEOPLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "columns.h"
+#include "substring.h"
+
+typedef enum {
+    PERSON_ROLE_DIRECTOR = 0,
+    PERSON_ROLE_CAST = 1,
+    PERSON_ROLE_COUNT
+} PersonRole;
+
+/*
+ * Movie indices per person for one role. The initial build is one flat array
+ * (CSR layout); movies appended later go to a small delta of (person, movie)
+ * keys kept sorted, so an append costs O(delta) instead of a rebuild.
+ */
+typedef struct {
+    size_t *offsets;     /* person id -> first posting; base_people + 1 entries */
+    uint32_t *postings;  /* ascending movie indices, grouped by person */
+    size_t base_people;  /* people known when the CSR part was built */
+    uint64_t *delta;     /* person << 32 | movie, ascending */
+    size_t delta_count;
+    uint64_t *pending;   /* keys recorded since the last person_index_finish */
+    size_t pending_count;
+    size_t pending_capacity;
+    int borrowed;        /* offsets, postings and delta point into a mapped snapshot */
+} PersonPostings;
+
+/*
+ * Every individual director and cast member of the catalog. The comma
+ * separated director and cast fields are split into people, interned to
+ * person ids and given a sorted posting list per role.
+ */
+typedef struct {
+    StringDictionary names;  /* lowercase person names, owned by arena */
+    Arena arena;
+    PersonPostings roles[PERSON_ROLE_COUNT];
+    TextBlob name_text;      /* the names again, packed for partial-name scans */
+} PersonIndex;
+
+void person_index_init(PersonIndex *index);
+void person_index_free(PersonIndex *index);
+
+/* Record the people of one movie; movies must be added in ascending index
+ * order, and after any movie already finished. */
+void person_index_add_movie(PersonIndex *index, size_t movie_index, const char *directors, const char *cast);
+/* Make the recorded people visible to lookups. */
+void person_index_finish(PersonIndex *index);
+
+/* Person id of a lowercase name, or COLUMNS_NOT_FOUND. */
+uint32_t person_index_find(const PersonIndex *index, const char *name_lower);
+/* Number of movies person appears in under role. */
+size_t person_index_posting_count(const PersonIndex *index, uint32_t person, PersonRole role);
+/* Append those movies, ascending, to a growable buffer; returns 0 when out of memory. */
+int person_index_collect(const PersonIndex *index, uint32_t person, PersonRole role,
+                         size_t **buffer, size_t *count, size_t *capacity);
+
+/* One person's movies under a role, in place: the base slice, then the
+ * appended movies in the low 32 bits of the delta keys. */
+typedef struct {
+    const uint32_t *base;
+    size_t base_count;
+    const uint64_t *delta;
+    size_t delta_count;
+} PersonPostingRuns;
+
+void person_index_postings(const PersonIndex *index, uint32_t person, PersonRole role, PersonPostingRuns *out);
+
+#endif /* PEOPLE_H */
@@ -16,8 +16,12 @@ typedef struct {
 void reco_tree_init(RecommendationTree *rt);
 void reco_tree_free(RecommendationTree *rt);
 
-/* Rebuild/augment the splay tree using recommendations from source_index. */
-int reco_tree_update_from_source(RecommendationTree *rt, const MovieDatabase *db, size_t source_index, size_t topn);
+/*
+ * Rebuild/augment the splay tree using recommendations from source_index; graph (may be NULL) serves them when
+ * current, otherwise they are scored on threads workers.
+ */
+int reco_tree_update_from_source(RecommendationTree *rt, const MovieDatabase *db, const NeighborGraph *graph,
+                                 size_t source_index, size_t topn, size_t threads);
 
 /* Show root and immediate children for quick UI peek. */
 void reco_tree_print_root_and_children(const RecommendationTree *rt, const MovieDatabase *db);
@@ -2,8 +2,10 @@
 #define RECOMMENDATION_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "movie.h"
+#include "neighbors.h"
 
 typedef struct {
     size_t movie_index;
@@ -13,7 +15,54 @@ typedef struct {
     int director_match;
 } Recommendation;
 
+/* Every other movie ranked against source_index, best first. */
 int recommendation_generate(const MovieDatabase *db, size_t source_index, Recommendation **out_list, size_t *out_count);
+/*
+ * Only the k best, best first, in a k-entry list, scored from the director
+ * and genre posting lists and a k-entry heap instead of ranking every movie.
+ * Ties go to the lower movie index.
+ */
+int recommendation_generate_top(const MovieDatabase *db, size_t source_index, size_t k, Recommendation **out_list,
+                                size_t *out_count);
+/*
+ * Same results as the two above, ties included, with the catalog split over
+ * threads workers when the posting lists cannot settle the ranking alone.
+ */
+int recommendation_generate_parallel(const MovieDatabase *db, size_t source_index, size_t threads,
+                                     Recommendation **out_list, size_t *out_count);
+int recommendation_generate_top_parallel(const MovieDatabase *db, size_t source_index, size_t k, size_t threads,
+                                         Recommendation **out_list, size_t *out_count);
+/*
+ * The k best from graph when it is current for db and holds k neighbors per
+ * movie (O(k)), otherwise by recommendation_generate_top_parallel on threads
+ * workers. graph may be NULL.
+ */
+int recommendation_lookup(const MovieDatabase *db, const NeighborGraph *graph, size_t source_index, size_t k,
+                          size_t threads, Recommendation **out_list, size_t *out_count);
+
+/*
+ * Kernels scoring a contiguous run of movies from the column store. The
+ * vector kernel gives the same keys as the scalar one, bit for bit; the best
+ * kernel the CPU supports is picked on first use.
+ */
+typedef enum {
+    RECOMMENDATION_KERNEL_AUTO = 0,
+    RECOMMENDATION_KERNEL_SCALAR,
+    RECOMMENDATION_KERNEL_AVX2 /* 8 movies per step */
+} RecommendationKernel;
+
+/* Force a kernel (benchmarks, tests) or go back to AUTO; returns 0 when the CPU lacks it. */
+int recommendation_set_kernel(RecommendationKernel kernel);
+RecommendationKernel recommendation_active_kernel(void);
+const char *recommendation_kernel_name(RecommendationKernel kernel);
+/* Packed keys (see recommendation_key_pack) of movies [begin, begin + count) against source_index. */
+void recommendation_score_block(const MovieDatabase *db, size_t source_index, size_t begin, size_t count,
+                                uint64_t *keys);
+
+/* A recommendation's ranking as one integer, larger is better, and back. */
+uint64_t recommendation_key_pack(const Recommendation *r);
+void recommendation_key_unpack(uint64_t key, size_t movie_index, Recommendation *out);
+
 void recommendation_print(const MovieDatabase *db, const Recommendation *list, size_t count, size_t limit);
 
 #endif /* RECOMMENDATION_H */
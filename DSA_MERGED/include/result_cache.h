@@ -0,0 +1,74 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RESULT_CACHE_DEFAULT_ENTRIES 256
+#define RESULT_CACHE_DEFAULT_BYTES (1u << 20)
+#define RESULT_CACHE_NONE UINT32_MAX
+
+/* What a cached search found: the movies kept (often just a first page) and the total. */
+typedef struct {
+    char *query;        /* normalized query, owned */
+    int mode;           /* caller-defined kind of search */
+    size_t hash;
+    size_t *indices;    /* owned, count entries */
+    size_t count;
+    size_t total;       /* matches in all, exact or estimated */
+    int exact;
+    size_t bytes;       /* counted against the byte budget */
+    uint32_t newer;     /* recency list neighbours, RESULT_CACHE_NONE at the ends */
+    uint32_t older;
+    uint32_t chain;     /* next entry in the same bucket, or next free slot */
+} ResultCacheEntry;
+
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t evictions;     /* entries dropped for room */
+    size_t invalidations; /* times the catalog generation moved on */
+} ResultCacheStats;
+
+/*
+ * Least-recently-used cache of search results keyed by (mode, normalized
+ * query), capped both in entries and in bytes. Results are only valid for
+ * the catalog generation they were computed against: a lookup or insert
+ * under another generation empties the cache first.
+ */
+typedef struct {
+    ResultCacheEntry *entries; /* max_entries slots */
+    size_t max_entries;
+    size_t max_bytes;
+    size_t count;
+    size_t bytes;
+    uint32_t *buckets;         /* hash -> first entry, RESULT_CACHE_NONE when empty */
+    size_t bucket_count;       /* power of two */
+    uint32_t newest;
+    uint32_t oldest;
+    uint32_t free_slot;
+    uint64_t generation;
+    ResultCacheStats stats;
+} ResultCache;
+
+void result_cache_init(ResultCache *cache, size_t max_entries, size_t max_bytes);
+void result_cache_free(ResultCache *cache);
+void result_cache_clear(ResultCache *cache);
+
+/* Fold query like the catalog keys, trim it and collapse runs of spaces; returns the length written. */
+size_t result_cache_normalize(const char *query, char *out, size_t size);
+
+/* The entry for a normalized query, made most recent; NULL on a miss. Valid until the next put. */
+const ResultCacheEntry *result_cache_get(ResultCache *cache, uint64_t generation, int mode, const char *query);
+/* Store a copy of a result, evicting the least recent entries for room; returns the entry, or
+ * NULL when it alone exceeds the byte budget. Valid until the next put. */
+const ResultCacheEntry *result_cache_put(ResultCache *cache, uint64_t generation, int mode, const char *query,
+                                         const size_t *indices, size_t count, size_t total, int exact);
+
+/* Write the cached keys, least recent first, one "mode<TAB>query" line each. */
+int result_cache_save_keys(const ResultCache *cache, const char *path, char **error_message);
+/* Call replay for every "mode<TAB>query" line of path, in file order. A missing file holds no keys. */
+int result_cache_load_keys(const char *path, void (*replay)(void *ctx, int mode, const char *query), void *ctx,
+                           char **error_message);
+
+#endif /* RESULT_CACHE_H */
@@ -0,0 +1,74 @@
+#ifndef RESULTSET_H
+#define RESULTSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A container switches from a sorted array to a bitmap past this many values. */
+#define RESULT_ARRAY_MAX 4096
+#define RESULT_BITMAP_WORDS 1024 /* 65536 bits */
+
+#define RESULT_CONTAINER_ARRAY 0
+#define RESULT_CONTAINER_BITMAP 1
+
+/* The movies of one 65536-wide block: a sorted array of low halves, or a bitmap. */
+typedef struct {
+    uint16_t key;          /* high 16 bits of the movie indices */
+    uint16_t kind;         /* RESULT_CONTAINER_* */
+    uint32_t cardinality;
+    uint32_t capacity;     /* values allocated, arrays only */
+    uint16_t *values;      /* ascending low halves, arrays only */
+    uint64_t *words;       /* RESULT_BITMAP_WORDS words, bitmaps only */
+} ResultContainer;
+
+/*
+ * Set of movie indices in roaring layout: the indices are split by their high
+ * 16 bits into containers kept in key order, and each container is whichever
+ * of a sorted array or a bitmap is smaller. Set operations work container by
+ * container, so they cost the size of the sets rather than of the catalog.
+ */
+typedef struct {
+    ResultContainer *containers;
+    size_t count;
+    size_t capacity;
+} ResultSet;
+
+void result_set_init(ResultSet *set);
+void result_set_free(ResultSet *set);
+void result_set_clear(ResultSet *set);
+
+/* Add one movie index; appending in ascending order is the fast path. */
+void result_set_add(ResultSet *set, uint32_t value);
+/* Replace set with the indices of an array, in any order, duplicates allowed. */
+void result_set_from_indices(ResultSet *set, const size_t *indices, size_t count);
+void result_set_copy(ResultSet *out, const ResultSet *set);
+/* Append a copy of a stored container: cardinality ascending low halves for an
+ * array, RESULT_BITMAP_WORDS words for a bitmap. key must sort after every
+ * existing one. For loaders of sets written out container by container. */
+void result_set_append_container(ResultSet *set, uint16_t key, uint16_t kind, uint32_t cardinality, const void *data);
+
+size_t result_set_cardinality(const ResultSet *set);
+int result_set_contains(const ResultSet *set, uint32_t value);
+
+/* out = a AND b, a OR b, a AND NOT b; out may alias neither input. */
+void result_set_and(ResultSet *out, const ResultSet *a, const ResultSet *b);
+void result_set_or(ResultSet *out, const ResultSet *a, const ResultSet *b);
+void result_set_andnot(ResultSet *out, const ResultSet *a, const ResultSet *b);
+/* out = every index below universe that is not in set. */
+void result_set_not(ResultSet *out, const ResultSet *set, size_t universe);
+
+/* Ascending indices as a malloc'd array, like the search_* results; 0 when empty. */
+int result_set_to_indices(const ResultSet *set, size_t **out_indices, size_t *out_count);
+
+/* Walks a set in ascending order a batch at a time; the set must not change meanwhile. */
+typedef struct {
+    const ResultSet *set;
+    size_t container;
+    uint32_t position; /* next value of an array container, or next bit of a bitmap */
+} ResultSetIterator;
+
+void result_set_iterator_init(ResultSetIterator *it, const ResultSet *set);
+/* Write up to max of the next indices to out; returns how many, 0 at the end. */
+size_t result_set_iterator_next(ResultSetIterator *it, size_t *out, size_t max);
+
+#endif /* RESULTSET_H */
@@ -2,35 +2,112 @@
 #define SEARCH_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "movie.h"
+#include "resultset.h"
+#include "substring.h"
+#include "trigram.h"
 
+/* Slots whose control bytes are matched together; the slot count is a multiple of it. */
+#define TITLE_GROUP_WIDTH 16
+/* Control byte of an unused slot; used slots hold a 7-bit tag of the key's hash. */
+#define TITLE_CTRL_EMPTY 0x80u
+
+/* A probe unit: control bytes (a 7-bit hash tag, or empty) and the key id of each slot. */
+typedef struct {
+    unsigned char ctrl[TITLE_GROUP_WIDTH];
+    uint32_t ids[TITLE_GROUP_WIDTH]; /* meaningful where ctrl holds a tag */
+} TitleIndexGroup;
+
+/* One distinct title and the movies that carry it. */
 typedef struct {
     char *key_lower;
+    size_t hash;
     size_t *indices;
     size_t count;
     size_t capacity;
-    int occupied;
 } TitleIndexEntry;
 
+/*
+ * Growable open-addressing table over lowercase titles. Keys live in a dense
+ * entries array, so a key id (its position) never changes. The slots only hold
+ * a control byte and the key id, kept together per group; a probe compares a
+ * group of TITLE_GROUP_WIDTH control bytes at once and only looks at an entry,
+ * and its full hash, on a tag match. The table doubles at 7/8 load.
+ */
 typedef struct {
-    TitleIndexEntry *entries;
-    size_t capacity;
-    size_t size;
+    TitleIndexEntry *entries; /* key id -> entry, in insertion order */
+    size_t size;              /* keys */
+    size_t entry_capacity;
+    TitleIndexGroup *groups;  /* capacity / TITLE_GROUP_WIDTH of them */
+    size_t capacity;          /* slots; a power of two, at least TITLE_GROUP_WIDTH */
+    int borrowed; /* keys, postings and groups point into a mapped snapshot and are not freed */
+    TrigramIndex trigrams;    /* key ids by the trigrams of key_lower, for partial searches */
+    TextBlob key_text;        /* key_lower of every key id, packed for scans */
 } TitleIndex;
 
 void title_index_init(TitleIndex *index);
 int title_index_build(TitleIndex *index, const MovieDatabase *db);
+/* Same index as title_index_build, built as per-thread shards that are merged in movie order. */
+int title_index_build_parallel(TitleIndex *index, const MovieDatabase *db, size_t threads);
+/* Index movies [first, db->count), e.g. after movie_db_append_from_csv. The table
+ * grows as needed; a snapshot-backed index first takes copies of what it borrows. */
+int title_index_append(TitleIndex *index, const MovieDatabase *db, size_t first);
 void title_index_free(TitleIndex *index);
 
 int title_index_lookup(const TitleIndex *index, const char *title_lower, size_t **out_indices, size_t *out_count);
+/* The entry of a lowercase title, read in place; NULL when no movie has it. */
+const TitleIndexEntry *title_index_entry(const TitleIndex *index, const char *title_lower);
 int title_index_partial_search(const TitleIndex *index, const char *needle_lower, size_t **out_indices, size_t *out_count);
+/* Ranking weight of a key: the newest release year among its movies, 0 when none is known. */
+int title_index_key_weight(const TitleIndex *index, size_t key_id, const MovieDatabase *db);
 
+/* Director searches match individual people of multi-director rows; a query
+ * containing a comma is matched against whole director fields instead. */
 int search_by_director(const MovieDatabase *db, const char *director_lower, size_t **out_indices, size_t *out_count);
 int search_by_director_partial(const MovieDatabase *db, const char *director_substr_lower, size_t **out_indices, size_t *out_count);
+/* Movies listing a cast member by full (lowercase) name, or by part of it. */
+int search_by_cast(const MovieDatabase *db, const char *actor_lower, size_t **out_indices, size_t *out_count);
+int search_by_cast_partial(const MovieDatabase *db, const char *actor_substr_lower, size_t **out_indices, size_t *out_count);
 int search_by_genre(const MovieDatabase *db, const char *genre_lower, size_t **out_indices, size_t *out_count);
 int search_by_genre_partial(const MovieDatabase *db, const char *genre_substr_lower, size_t **out_indices, size_t *out_count);
 int search_by_release_year(const MovieDatabase *db, int year, size_t **out_indices, size_t *out_count);
 
+/*
+ * Range searches read a slice of the sorted year and date_added orders in
+ * MovieColumns: a binary search for each end plus the results copied out.
+ * Ranges are inclusive; movies come oldest first, by index within a day or
+ * year. Pass INT_MAX as the upper end for an open range.
+ */
+int search_by_release_year_range(const MovieDatabase *db, int from, int to, size_t **out_indices, size_t *out_count);
+/* The k movies released closest to year; an equal distance favours the earlier year. */
+int search_by_nearest_year(const MovieDatabase *db, int year, size_t k, size_t **out_indices, size_t *out_count);
+/* Dates are days since 1970-01-01, see movie_parse_date. */
+int search_by_date_added_range(const MovieDatabase *db, int from_days, int to_days, size_t **out_indices, size_t *out_count);
+/* Movies added in the last `days` days up to the catalog's newest addition, newest first. */
+int search_added_within_days(const MovieDatabase *db, int days, size_t **out_indices, size_t *out_count);
+/* The recently-added feed: limit movies from position offset, newest first. */
+int search_recently_added(const MovieDatabase *db, size_t offset, size_t limit, size_t **out_indices, size_t *out_count);
+
+/*
+ * Several criteria at once; a NULL or empty string and a zero year leave that
+ * criterion out. Text fields are lowercase substrings, matched like the
+ * *_partial searches, and the year range is inclusive (open on a zero side).
+ */
+typedef struct {
+    const char *title_substr_lower;
+    const char *director_substr_lower;
+    const char *genre_substr_lower;
+    const char *exclude_genre_substr_lower; /* drop movies with a matching genre */
+    int year_from;
+    int year_to;
+} SearchQuery;
+
+void search_query_init(SearchQuery *query);
+/* Movies matching every criterion of query, as the AND of one result set per
+ * criterion. titles may be NULL when the query has no title. */
+int search_query_run(const MovieDatabase *db, const TitleIndex *titles, const SearchQuery *query, ResultSet *out);
+
 #endif /* SEARCH_H */
 
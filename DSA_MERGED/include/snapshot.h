@@ -0,0 +1,33 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "movie.h"
+#include "search.h"
+
+/* Bumped whenever the on-disk layout or the key folding changes; older files are treated as stale. */
+#define SNAPSHOT_VERSION 7
+
+/*
+ * Write db and index to path as a pointer-free binary snapshot: fixed-size
+ * movie and hash-slot records that refer to a shared string blob by offset,
+ * followed by a checksum. source_path (may be NULL) is the CSV the catalog was
+ * loaded from; its size and mtime are recorded so a later load can tell when
+ * the snapshot is stale.
+ */
+int snapshot_write(const char *path, const MovieDatabase *db, const TitleIndex *index,
+                   const char *source_path, char **error_message);
+
+/*
+ * Map a snapshot written by snapshot_write into an empty db and index. The
+ * strings, title postings, title hash slots, trigram postings, the per-row
+ * columns, the year and date orders and the person posting lists stay in the
+ * mapping; the Movie array, the title key entries, the director, genre and
+ * person dictionaries and the year and genre movie sets are filled in from
+ * it. Nothing is parsed or re-derived from the rows.
+ * Returns 0 with *error_message set when the file is missing, corrupt, from
+ * another version, or older than source_path.
+ */
+int snapshot_load(const char *path, const char *source_path, MovieDatabase *db, TitleIndex *index,
+                  char **error_message);
+
+#endif /* SNAPSHOT_H */
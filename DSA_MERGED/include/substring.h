@@ -0,0 +1,52 @@
+#ifndef SUBSTRING_H
+#define SUBSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Substring search kernels. The vector kernels compare the first and last
+ * byte of the needle against a block of candidate positions at once and only
+ * run memcmp where both match, which rejects almost every position of real
+ * text in two compares. The best kernel the CPU supports is picked on first
+ * use.
+ */
+typedef enum {
+    SUBSTRING_KERNEL_AUTO = 0,
+    SUBSTRING_KERNEL_SCALAR,
+    SUBSTRING_KERNEL_SSE2,  /* 16 positions per step */
+    SUBSTRING_KERNEL_AVX2   /* 32 positions per step */
+} SubstringKernel;
+
+/* First occurrence of needle in haystack[0, haystack_len), or NULL. */
+const char *substring_find(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len);
+
+/* Force a kernel (benchmarks, tests) or go back to AUTO; returns 0 when the CPU lacks it. */
+int substring_set_kernel(SubstringKernel kernel);
+SubstringKernel substring_active_kernel(void);
+const char *substring_kernel_name(SubstringKernel kernel);
+
+/*
+ * Strings packed back to back into one buffer, each followed by a NUL, so a
+ * scan for a needle is one pass of substring_find over contiguous memory
+ * instead of a strstr per heap string. String ids are dense, in add order.
+ */
+typedef struct {
+    char *text;
+    size_t length;
+    size_t capacity;
+    size_t *starts;   /* count + 1 entries: string id -> offset, then the end */
+    size_t count;
+    size_t starts_capacity;
+} TextBlob;
+
+void text_blob_init(TextBlob *blob);
+void text_blob_free(TextBlob *blob);
+void text_blob_add(TextBlob *blob, const char *text);
+
+/* Ascending ids of the strings containing needle; *out_ids is malloc'd. Returns 0 when none do. */
+int text_blob_search(const TextBlob *blob, const char *needle, uint32_t **out_ids, size_t *out_count);
+/* First id from `from` on whose string contains needle (needle_len bytes), or blob->count. */
+size_t text_blob_next(const TextBlob *blob, const char *needle, size_t needle_len, size_t from);
+
+#endif /* SUBSTRING_H */
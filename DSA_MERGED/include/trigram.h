@@ -0,0 +1,49 @@
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Needles shorter than this have no trigram and need a scan of every key. */
+#define TRIGRAM_MIN_NEEDLE 3
+
+/*
+ * Inverted index from byte trigrams to the ids of the keys containing them.
+ * Same layout as the person postings: the initial build is a CSR part over
+ * the distinct trigram codes, and keys added afterwards go to a small sorted
+ * delta of (trigram, key id) pairs. A trigram code packs its three bytes as
+ * b0 << 16 | b1 << 8 | b2.
+ */
+typedef struct {
+    uint32_t *grams;      /* distinct trigram codes of the CSR part, ascending */
+    size_t *offsets;      /* gram_count + 1 entries into postings */
+    uint32_t *postings;   /* ascending key ids, grouped by trigram */
+    size_t gram_count;
+    size_t posting_count;
+    uint64_t *delta;      /* gram << 32 | key id, ascending */
+    size_t delta_count;
+    uint64_t *pending;    /* pairs recorded since the last trigram_index_finish */
+    size_t pending_count;
+    size_t pending_capacity;
+    int built;            /* the CSR part exists; later keys go to the delta */
+    int borrowed;         /* grams, offsets, postings and delta point into a mapped snapshot */
+} TrigramIndex;
+
+void trigram_index_init(TrigramIndex *index);
+void trigram_index_free(TrigramIndex *index);
+
+/* Record the trigrams of one key; ids must be added in ascending order, and
+ * above every id already finished. */
+void trigram_index_add(TrigramIndex *index, uint32_t key_id, const char *key);
+/* Make the recorded keys visible to trigram_index_candidates. */
+void trigram_index_finish(TrigramIndex *index);
+
+/*
+ * Ascending ids of the keys that contain every trigram of needle; a superset
+ * of the keys containing needle, so callers still verify each one. Returns 0
+ * when needle is shorter than TRIGRAM_MIN_NEEDLE and the index cannot help.
+ * *out_ids is malloc'd (NULL when *out_count is 0).
+ */
+int trigram_index_candidates(const TrigramIndex *index, const char *needle, uint32_t **out_ids, size_t *out_count);
+
+#endif /* TRIGRAM_H */
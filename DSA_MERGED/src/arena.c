@@ -0,0 +1,106 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_MIN_CHUNK ((size_t)64 * 1024)
+#define ARENA_MAX_CHUNK ((size_t)16 * 1024 * 1024)
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+void arena_init(Arena *arena) {
+    if (!arena) return;
+    arena->head = NULL;
+    arena->next_chunk_size = ARENA_MIN_CHUNK;
+    arena->chunk_count = 0;
+    arena->bytes_reserved = 0;
+    arena->bytes_used = 0;
+}
+
+void arena_free(Arena *arena) {
+    if (!arena) return;
+    ArenaChunk *chunk = arena->head;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena_init(arena);
+}
+
+static ArenaChunk *arena_add_chunk(Arena *arena, size_t min_size) {
+    size_t capacity = arena->next_chunk_size;
+    if (capacity < min_size) capacity = min_size;
+    if (arena->next_chunk_size < ARENA_MAX_CHUNK) arena->next_chunk_size *= 2;
+
+    ArenaChunk *chunk = (ArenaChunk *)checked_malloc(sizeof(ArenaChunk) + capacity);
+    chunk->next = arena->head;
+    chunk->used = 0;
+    chunk->capacity = capacity;
+    arena->head = chunk;
+    arena->chunk_count++;
+    arena->bytes_reserved += sizeof(ArenaChunk) + capacity;
+    return chunk;
+}
+
+static size_t arena_padding(const ArenaChunk *chunk, size_t align) {
+    uintptr_t addr = (uintptr_t)(chunk->data + chunk->used);
+    return (size_t)((align - (addr & (align - 1))) & (align - 1));
+}
+
+void *arena_alloc(Arena *arena, size_t size, size_t align) {
+    if (!arena) return NULL;
+    if (align == 0) align = 1;
+
+    ArenaChunk *chunk = arena->head;
+    size_t padding = chunk ? arena_padding(chunk, align) : 0;
+    if (!chunk || chunk->capacity - chunk->used < size + padding) {
+        chunk = arena_add_chunk(arena, size + align);
+        padding = arena_padding(chunk, align);
+    }
+
+    void *ptr = chunk->data + chunk->used + padding;
+    chunk->used += padding + size;
+    arena->bytes_used += padding + size;
+    return ptr;
+}
+
+char *arena_strndup(Arena *arena, const char *src, size_t n) {
+    if (!src) return NULL;
+    char *copy = (char *)arena_alloc(arena, n + 1, 1);
+    memcpy(copy, src, n);
+    copy[n] = '\0';
+    return copy;
+}
+
+char *arena_strdup(Arena *arena, const char *src) {
+    if (!src) return NULL;
+    return arena_strndup(arena, src, strlen(src));
+}
+
+void arena_adopt(Arena *dst, Arena *src) {
+    if (!dst || !src || !src->head) return;
+    if (!dst->head) {
+        *dst = *src;
+        arena_init(src);
+        return;
+    }
+    /* Keep dst's current chunk at the head so its free space is still used. */
+    ArenaChunk *tail = src->head;
+    while (tail->next) tail = tail->next;
+    tail->next = dst->head->next;
+    dst->head->next = src->head;
+    dst->chunk_count += src->chunk_count;
+    dst->bytes_reserved += src->bytes_reserved;
+    dst->bytes_used += src->bytes_used;
+    arena_init(src);
+}
@@ -0,0 +1,304 @@
+#include "autocomplete.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+void title_autocomplete_init(TitleAutocomplete *ac) {
+    if (!ac) return;
+    ac->index = NULL;
+    ac->nodes = NULL;
+    ac->node_count = 0;
+    ac->key_count = 0;
+}
+
+void title_autocomplete_free(TitleAutocomplete *ac) {
+    if (!ac) return;
+    free(ac->nodes);
+    title_autocomplete_init(ac);
+}
+
+int title_autocomplete_is_stale(const TitleAutocomplete *ac, const TitleIndex *index) {
+    return !ac || !index || ac->index != index || ac->key_count != index->size;
+}
+
+typedef struct {
+    const char *key;
+    uint32_t id;
+} AutocompleteKey;
+
+static unsigned char key_byte(const AutocompleteKey *key, size_t depth) {
+    return (unsigned char)key->key[depth];
+}
+
+static void swap_keys(AutocompleteKey *keys, size_t a, size_t b) {
+    AutocompleteKey tmp = keys[a];
+    keys[a] = keys[b];
+    keys[b] = tmp;
+}
+
+/*
+ * Multikey quicksort: three-way partition on the byte at depth, so shared
+ * prefixes are compared once per partition rather than once per strcmp.
+ * Keys share their first depth bytes.
+ */
+static void sort_keys(AutocompleteKey *keys, size_t count, size_t depth) {
+    while (count > 1) {
+        if (count < 16) {
+            for (size_t i = 1; i < count; ++i) {
+                for (size_t j = i; j > 0 && strcmp(keys[j - 1].key + depth, keys[j].key + depth) > 0; --j) {
+                    swap_keys(keys, j - 1, j);
+                }
+            }
+            return;
+        }
+        swap_keys(keys, 0, count / 2);
+        unsigned char pivot = key_byte(&keys[0], depth);
+        size_t lt = 0;   /* [0, lt) below the pivot */
+        size_t i = 1;
+        size_t gt = count; /* [gt, count) above it */
+        while (i < gt) {
+            unsigned char byte = key_byte(&keys[i], depth);
+            if (byte < pivot) swap_keys(keys, lt++, i++);
+            else if (byte > pivot) swap_keys(keys, i, --gt);
+            else i++;
+        }
+        sort_keys(keys, lt, depth);
+        sort_keys(keys + gt, count - gt, depth);
+        if (pivot == '\0') return; /* the equal run has ended: at most one key */
+        keys += lt;
+        count = gt - lt;
+        depth++;
+    }
+}
+
+static int compare_best(const void *lhs, const void *rhs) {
+    uint64_t a = ((const AutocompleteNode *)lhs)->best;
+    uint64_t b = ((const AutocompleteNode *)rhs)->best;
+    return (a < b) - (a > b);
+}
+
+typedef struct {
+    TitleAutocomplete *ac;
+    const AutocompleteKey *keys;
+    const uint64_t *scores; /* by position in keys */
+    size_t node_capacity;
+} TrieBuilder;
+
+static uint32_t builder_reserve(TrieBuilder *builder, size_t count) {
+    TitleAutocomplete *ac = builder->ac;
+    if (ac->node_count + count > builder->node_capacity) {
+        size_t capacity = builder->node_capacity * 2;
+        if (capacity < ac->node_count + count) capacity = ac->node_count + count;
+        AutocompleteNode *grown = (AutocompleteNode *)realloc(ac->nodes, capacity * sizeof(AutocompleteNode));
+        if (!grown) {
+            fprintf(stderr, "Error: Out of memory while building autocomplete trie\n");
+            exit(EXIT_FAILURE);
+        }
+        ac->nodes = grown;
+        builder->node_capacity = capacity;
+    }
+    uint32_t first = (uint32_t)ac->node_count;
+    ac->node_count += count;
+    return first;
+}
+
+/* Fill node, whose label ends at depth, from keys [lo, hi); they all share the first depth bytes. */
+static void build_node(TrieBuilder *builder, uint32_t node, size_t lo, size_t hi, size_t depth) {
+    const AutocompleteKey *keys = builder->keys;
+    AutocompleteNode *nodes = builder->ac->nodes;
+    nodes[node].key_id = AUTOCOMPLETE_NO_KEY;
+    nodes[node].score = 0;
+    nodes[node].best = 0;
+    nodes[node].first_child = 0;
+    nodes[node].child_count = 0;
+    if (lo < hi && keys[lo].key[depth] == '\0') {
+        nodes[node].key_id = keys[lo].id;
+        nodes[node].score = builder->scores[lo];
+        nodes[node].best = builder->scores[lo];
+        lo++;
+    }
+    if (lo == hi) return;
+
+    /* Keys are sorted, so each child is a run of keys sharing the next byte. */
+    size_t children = 0;
+    for (size_t i = lo; i < hi; ++i) {
+        if (i == lo || keys[i].key[depth] != keys[i - 1].key[depth]) children++;
+    }
+    uint32_t first = builder_reserve(builder, children);
+    nodes = builder->ac->nodes;
+    nodes[node].first_child = first;
+    nodes[node].child_count = (uint32_t)children;
+
+    uint32_t child = first;
+    size_t run = lo;
+    while (run < hi) {
+        size_t end = run + 1;
+        while (end < hi && keys[end].key[depth] == keys[run].key[depth]) end++;
+        /* The run's common prefix is that of its first and last keys. */
+        const char *a = keys[run].key;
+        const char *b = keys[end - 1].key;
+        size_t label_end = depth;
+        while (a[label_end] != '\0' && a[label_end] == b[label_end]) label_end++;
+
+        nodes = builder->ac->nodes;
+        nodes[child].label_key = keys[run].id;
+        nodes[child].label_start = (uint32_t)depth;
+        nodes[child].label_end = (uint32_t)label_end;
+        build_node(builder, child, run, end, label_end);
+        nodes = builder->ac->nodes;
+        if (nodes[child].best > nodes[node].best) nodes[node].best = nodes[child].best;
+        child++;
+        run = end;
+    }
+    qsort(nodes + first, children, sizeof(AutocompleteNode), compare_best);
+}
+
+int title_autocomplete_build(TitleAutocomplete *ac, const TitleIndex *index, const MovieDatabase *db) {
+    if (!ac || !index || !db) return 0;
+    title_autocomplete_free(ac);
+
+    size_t count = index->size;
+    AutocompleteKey *keys = (AutocompleteKey *)checked_malloc((count > 0 ? count : 1) * sizeof(AutocompleteKey));
+    for (size_t id = 0; id < count; ++id) {
+        keys[id].key = index->entries[id].key_lower ? index->entries[id].key_lower : "";
+        keys[id].id = (uint32_t)id;
+    }
+    sort_keys(keys, count, 0);
+
+    uint64_t *scores = (uint64_t *)checked_malloc((count > 0 ? count : 1) * sizeof(uint64_t));
+    for (size_t rank = 0; rank < count; ++rank) {
+        int weight = title_index_key_weight(index, keys[rank].id, db);
+        scores[rank] = (uint64_t)((int64_t)weight - INT32_MIN) << 32 | (uint64_t)(UINT32_MAX - (uint32_t)rank);
+    }
+
+    TrieBuilder builder = {ac, keys, scores, count + 1};
+    ac->nodes = (AutocompleteNode *)checked_malloc(builder.node_capacity * sizeof(AutocompleteNode));
+    uint32_t root = builder_reserve(&builder, 1);
+    ac->nodes[root].label_key = 0;
+    ac->nodes[root].label_start = 0;
+    ac->nodes[root].label_end = 0;
+    build_node(&builder, root, 0, count, 0);
+    AutocompleteNode *fitted = (AutocompleteNode *)realloc(ac->nodes, ac->node_count * sizeof(AutocompleteNode));
+    if (fitted) ac->nodes = fitted;
+
+    free(scores);
+    free(keys);
+    ac->index = index;
+    ac->key_count = count;
+    return 1;
+}
+
+typedef struct {
+    uint64_t score;
+    uint32_t node;
+    uint32_t sibling_end; /* siblings still to visit are [node + 1, sibling_end) */
+    int leaf;             /* emit the node's own key rather than expand it */
+} AutocompleteItem;
+
+typedef struct {
+    AutocompleteItem *items;
+    size_t count;
+    size_t capacity;
+} AutocompleteHeap;
+
+static void heap_push(AutocompleteHeap *heap, uint64_t score, uint32_t node, uint32_t sibling_end, int leaf) {
+    if (heap->count == heap->capacity) {
+        heap->capacity = heap->capacity == 0 ? 32 : heap->capacity * 2;
+        AutocompleteItem *grown = (AutocompleteItem *)realloc(heap->items, heap->capacity * sizeof(AutocompleteItem));
+        if (!grown) {
+            fprintf(stderr, "Error: Out of memory during autocomplete\n");
+            exit(EXIT_FAILURE);
+        }
+        heap->items = grown;
+    }
+    size_t pos = heap->count++;
+    AutocompleteItem item = {score, node, sibling_end, leaf};
+    while (pos > 0 && heap->items[(pos - 1) / 2].score < score) {
+        heap->items[pos] = heap->items[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    heap->items[pos] = item;
+}
+
+static AutocompleteItem heap_pop(AutocompleteHeap *heap) {
+    AutocompleteItem top = heap->items[0];
+    AutocompleteItem last = heap->items[--heap->count];
+    size_t pos = 0;
+    while (1) {
+        size_t child = pos * 2 + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && heap->items[child + 1].score > heap->items[child].score) child++;
+        if (heap->items[child].score <= last.score) break;
+        heap->items[pos] = heap->items[child];
+        pos = child;
+    }
+    if (heap->count > 0) heap->items[pos] = last;
+    return top;
+}
+
+/* Node whose subtree holds exactly the keys starting with prefix, or UINT32_MAX. */
+static uint32_t find_prefix(const TitleAutocomplete *ac, const char *prefix) {
+    const TitleIndexEntry *entries = ac->index->entries;
+    uint32_t node = 0;
+    size_t depth = 0;
+    while (prefix[depth] != '\0') {
+        const AutocompleteNode *parent = &ac->nodes[node];
+        uint32_t next = UINT32_MAX;
+        for (uint32_t c = parent->first_child; c < parent->first_child + parent->child_count; ++c) {
+            const AutocompleteNode *child = &ac->nodes[c];
+            if (entries[child->label_key].key_lower[child->label_start] == prefix[depth]) {
+                next = c;
+                break;
+            }
+        }
+        if (next == UINT32_MAX) return UINT32_MAX;
+        const AutocompleteNode *child = &ac->nodes[next];
+        const char *label = entries[child->label_key].key_lower;
+        for (size_t j = child->label_start; j < child->label_end && prefix[depth] != '\0'; ++j, ++depth) {
+            if (label[j] != prefix[depth]) return UINT32_MAX;
+        }
+        node = next;
+    }
+    return node;
+}
+
+int title_autocomplete(const TitleAutocomplete *ac, const char *prefix_lower, size_t k, uint32_t *out_key_ids, size_t *out_count) {
+    if (out_count) *out_count = 0;
+    if (!ac || !ac->nodes || !prefix_lower || !out_key_ids || !out_count || k == 0) return 0;
+
+    uint32_t start = find_prefix(ac, prefix_lower);
+    if (start == UINT32_MAX) return 0;
+
+    AutocompleteHeap heap = {NULL, 0, 0};
+    heap_push(&heap, ac->nodes[start].best, start, start + 1, 0);
+    size_t count = 0;
+    while (heap.count > 0 && count < k) {
+        AutocompleteItem item = heap_pop(&heap);
+        const AutocompleteNode *node = &ac->nodes[item.node];
+        if (item.leaf) {
+            out_key_ids[count++] = node->key_id;
+            continue;
+        }
+        if (node->key_id != AUTOCOMPLETE_NO_KEY) heap_push(&heap, node->score, item.node, item.node + 1, 1);
+        if (node->child_count > 0) {
+            heap_push(&heap, ac->nodes[node->first_child].best, node->first_child,
+                      node->first_child + node->child_count, 0);
+        }
+        if (item.node + 1 < item.sibling_end) {
+            heap_push(&heap, ac->nodes[item.node + 1].best, item.node + 1, item.sibling_end, 0);
+        }
+    }
+    free(heap.items);
+    *out_count = count;
+    return count > 0;
+}
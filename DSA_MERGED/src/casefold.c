@@ -0,0 +1,257 @@
+#include "casefold.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CASEFOLD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* Base letters of U+00E0..U+00FF once folded; '*' marks two-letter bases, '-' no base. */
+static const char latin1_base[] = "aaaaaa*ceeeeiiiidnooooo-ouuuuy*y";
+
+/* Base letters of U+0100..U+017F, upper and lower case alike. */
+static const char latin_ext_a_base[] =
+    "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiii**jjkkklllllllll"
+    "lnnnnnnnnnoooooo**rrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+/* Base letters of U+1E00..U+1EFF, Latin Extended Additional, in runs. */
+typedef struct {
+    uint16_t first;
+    uint16_t last;
+    char base;
+} LetterRun;
+
+static const LetterRun latin_additional_base[] = {
+    {0x1E00, 0x1E01, 'a'}, {0x1E02, 0x1E07, 'b'}, {0x1E08, 0x1E09, 'c'}, {0x1E0A, 0x1E13, 'd'},
+    {0x1E14, 0x1E1D, 'e'}, {0x1E1E, 0x1E1F, 'f'}, {0x1E20, 0x1E21, 'g'}, {0x1E22, 0x1E2B, 'h'},
+    {0x1E2C, 0x1E2F, 'i'}, {0x1E30, 0x1E35, 'k'}, {0x1E36, 0x1E3D, 'l'}, {0x1E3E, 0x1E43, 'm'},
+    {0x1E44, 0x1E4B, 'n'}, {0x1E4C, 0x1E53, 'o'}, {0x1E54, 0x1E57, 'p'}, {0x1E58, 0x1E5F, 'r'},
+    {0x1E60, 0x1E69, 's'}, {0x1E6A, 0x1E71, 't'}, {0x1E72, 0x1E7B, 'u'}, {0x1E7C, 0x1E7F, 'v'},
+    {0x1E80, 0x1E89, 'w'}, {0x1E8A, 0x1E8D, 'x'}, {0x1E8E, 0x1E8F, 'y'}, {0x1E90, 0x1E95, 'z'},
+    {0x1E96, 0x1E96, 'h'}, {0x1E97, 0x1E97, 't'}, {0x1E98, 0x1E98, 'w'}, {0x1E99, 0x1E99, 'y'},
+    {0x1E9A, 0x1E9A, 'a'}, {0x1E9B, 0x1E9B, 's'}, {0x1EA0, 0x1EB7, 'a'}, {0x1EB8, 0x1EC7, 'e'},
+    {0x1EC8, 0x1ECB, 'i'}, {0x1ECC, 0x1EE3, 'o'}, {0x1EE4, 0x1EF1, 'u'}, {0x1EF2, 0x1EF9, 'y'},
+};
+
+/* Simple lowercase mapping of one code point; "ß" and "ẞ" are expanded by the caller. */
+static uint32_t fold_code_point(uint32_t cp) {
+    if (cp < 0x0100) {
+        if (cp >= 0x00C0 && cp <= 0x00DE && cp != 0x00D7) return cp + 0x20;
+        if (cp == 0x00B5) return 0x03BC;
+        return cp;
+    }
+    if (cp < 0x0180) {
+        if (cp == 0x0130) return 'i';
+        if (cp == 0x0178) return 0x00FF;
+        if (cp == 0x017F) return 's';
+        if ((cp <= 0x012F || (cp >= 0x0132 && cp <= 0x0137) || (cp >= 0x014A && cp <= 0x0177)) && !(cp & 1)) return cp + 1;
+        if (((cp >= 0x0139 && cp <= 0x0148) || (cp >= 0x0179 && cp <= 0x017E)) && (cp & 1)) return cp + 1;
+        return cp;
+    }
+    if (cp < 0x0250) {
+        if (cp == 0x01A0 || cp == 0x01AF) return cp + 1;
+        if (cp >= 0x01CD && cp <= 0x01DC && (cp & 1)) return cp + 1;
+        if (((cp >= 0x01DE && cp <= 0x01EF) || (cp >= 0x01F8 && cp <= 0x021F) || (cp >= 0x0222 && cp <= 0x0233)) && !(cp & 1)) {
+            return cp + 1;
+        }
+        return cp;
+    }
+    if (cp >= 0x0370 && cp < 0x03D0) {
+        if (cp == 0x0386) return 0x03AC;
+        if (cp >= 0x0388 && cp <= 0x038A) return cp + 0x25;
+        if (cp == 0x038C) return 0x03CC;
+        if (cp == 0x038E || cp == 0x038F) return cp + 0x3F;
+        if ((cp >= 0x0391 && cp <= 0x03A1) || (cp >= 0x03A3 && cp <= 0x03AB)) return cp + 0x20;
+        if (cp == 0x03C2) return 0x03C3;
+        return cp;
+    }
+    if (cp >= 0x0400 && cp < 0x0530) {
+        if (cp <= 0x040F) return cp + 0x50;
+        if (cp <= 0x042F) return cp + 0x20;
+        if (((cp >= 0x0460 && cp <= 0x0481) || (cp >= 0x048A && cp <= 0x04BF) || cp >= 0x04D0) && !(cp & 1)) return cp + 1;
+        if (cp >= 0x04C1 && cp <= 0x04CE && (cp & 1)) return cp + 1;
+        if (cp == 0x04C0) return 0x04CF;
+        return cp;
+    }
+    if (cp >= 0x1E00 && cp <= 0x1EFF) {
+        if ((cp <= 0x1E95 || cp >= 0x1EA0) && !(cp & 1)) return cp + 1;
+        return cp;
+    }
+    if (cp >= 0xFF21 && cp <= 0xFF3A) return cp + 0x20;
+    return cp;
+}
+
+/* Greek vowels with tonos or dialytika, folded, to their plain vowel; 0 when cp has none. */
+static uint32_t greek_base(uint32_t cp) {
+    switch (cp) {
+    case 0x0390: case 0x03AF: case 0x03CA: return 0x03B9;
+    case 0x03AC: return 0x03B1;
+    case 0x03AD: return 0x03B5;
+    case 0x03AE: return 0x03B7;
+    case 0x03B0: case 0x03CB: case 0x03CD: return 0x03C5;
+    case 0x03CC: return 0x03BF;
+    case 0x03CE: return 0x03C9;
+    default: return 0;
+    }
+}
+
+static size_t encode_utf8(uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    out[0] = (char)(0xE0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+}
+
+/* Decode the sequence at s into *cp; returns its length, or 0 when it is not valid UTF-8. */
+static size_t decode_utf8(const unsigned char *s, size_t n, uint32_t *cp) {
+    unsigned char c = s[0];
+    size_t len;
+    uint32_t value;
+    if (c >= 0xC2 && c <= 0xDF) {
+        len = 2;
+        value = c & 0x1Fu;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        len = 3;
+        value = c & 0x0Fu;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        len = 4;
+        value = c & 0x07u;
+    } else {
+        return 0;
+    }
+    if (len > n) return 0;
+    for (size_t i = 1; i < len; ++i) {
+        if ((s[i] & 0xC0) != 0x80) return 0;
+        value = (value << 6) | (s[i] & 0x3Fu);
+    }
+    if ((len == 3 && (value < 0x800 || (value >= 0xD800 && value <= 0xDFFF))) || (len == 4 && (value < 0x10000 || value > 0x10FFFF))) {
+        return 0;
+    }
+    *cp = value;
+    return len;
+}
+
+/*
+ * Write the folding of the character at src (len bytes, code point cp) to
+ * out; returns the bytes written, never more than len.
+ */
+static size_t fold_char(uint32_t cp, size_t len, const char *src, char *out, unsigned flags) {
+    if (cp == 0x00DF || cp == 0x1E9E) {
+        out[0] = 's';
+        out[1] = 's';
+        return 2;
+    }
+    if (cp > 0xFFFF) {
+        memmove(out, src, len);
+        return len;
+    }
+    cp = fold_code_point(cp);
+    if (flags & CASEFOLD_STRIP_ACCENTS) {
+        if (cp >= 0x0300 && cp <= 0x036F) return 0;
+        char base = 0;
+        if (cp >= 0x00E0 && cp <= 0x00FF) {
+            base = latin1_base[cp - 0x00E0];
+            if (base == '*') {
+                out[0] = cp == 0x00E6 ? 'a' : 't';
+                out[1] = cp == 0x00E6 ? 'e' : 'h';
+                return 2;
+            }
+            if (base == '-') base = 0;
+        } else if (cp >= 0x0100 && cp <= 0x017F) {
+            base = latin_ext_a_base[cp - 0x0100];
+            if (base == '*') {
+                out[0] = cp <= 0x0133 ? 'i' : 'o';
+                out[1] = cp <= 0x0133 ? 'j' : 'e';
+                return 2;
+            }
+        } else if (cp == 0x01A1) {
+            base = 'o';
+        } else if (cp == 0x01B0) {
+            base = 'u';
+        } else if (cp == 0x0219) {
+            base = 's';
+        } else if (cp == 0x021B) {
+            base = 't';
+        } else if (cp >= 0x1E00 && cp <= 0x1EFF) {
+            size_t lo = 0;
+            size_t hi = sizeof(latin_additional_base) / sizeof(latin_additional_base[0]);
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (latin_additional_base[mid].last < cp) lo = mid + 1;
+                else hi = mid;
+            }
+            if (lo < sizeof(latin_additional_base) / sizeof(latin_additional_base[0]) && latin_additional_base[lo].first <= cp) {
+                base = latin_additional_base[lo].base;
+            }
+        } else if (cp >= 0x0390 && cp <= 0x03CE) {
+            uint32_t plain = greek_base(cp);
+            if (plain) cp = plain;
+        }
+        if (base) {
+            out[0] = base;
+            return 1;
+        }
+    }
+    return encode_utf8(cp, out);
+}
+
+size_t casefold(char *dst, const char *src, size_t n, unsigned flags) {
+    size_t in = 0;
+    size_t out = 0;
+#ifdef CASEFOLD_SSE2
+    const __m128i bias = _mm_set1_epi8((char)('A' + 128));
+    const __m128i limit = _mm_set1_epi8((char)(-128 + 26));
+    const __m128i shift = _mm_set1_epi8(0x20);
+#endif
+    while (in < n) {
+#ifdef CASEFOLD_SSE2
+        /* Whole chunks of ASCII: add 0x20 to the bytes in 'A'..'Z' (biased so a signed compare works). */
+        while (in + 16 <= n) {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(const void *)(src + in));
+            if (_mm_movemask_epi8(chunk) != 0) break;
+            __m128i upper = _mm_cmplt_epi8(_mm_sub_epi8(chunk, bias), limit);
+            chunk = _mm_add_epi8(chunk, _mm_and_si128(upper, shift));
+            _mm_storeu_si128((__m128i *)(void *)(dst + out), chunk);
+            in += 16;
+            out += 16;
+        }
+#endif
+        /* ASCII up to the next other byte: the tail of the text, or the chunk that stopped the loop above. */
+        unsigned char c = 0;
+        while (in < n && (c = (unsigned char)src[in]) < 0x80) {
+            dst[out++] = (char)(c + ((unsigned char)(c - 'A') < 26u ? 0x20 : 0));
+            in++;
+        }
+        if (in >= n) break;
+        uint32_t cp;
+        size_t len = decode_utf8((const unsigned char *)src + in, n - in, &cp);
+        if (len == 0) {
+            dst[out++] = (char)c;
+            in++;
+            continue;
+        }
+        char folded[4];
+        size_t written = fold_char(cp, len, src + in, folded, flags);
+        in += len;
+        memcpy(dst + out, folded, written);
+        out += written;
+    }
+    dst[out] = '\0';
+    return out;
+}
+
+size_t casefold_inplace(char *text, unsigned flags) {
+    if (!text) return 0;
+    return casefold(text, text, strlen(text), flags);
+}
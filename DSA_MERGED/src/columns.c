@@ -0,0 +1,433 @@
+#include "columns.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+size_t string_dictionary_hash(const char *name) {
+    size_t hash = 5381u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; ++p) {
+        hash = ((hash << 5) + hash) + (size_t)(*p);
+    }
+    return hash;
+}
+
+void string_dictionary_init(StringDictionary *dict) {
+    if (!dict) return;
+    dict->names = NULL;
+    dict->hashes = NULL;
+    dict->count = 0;
+    dict->capacity = 0;
+    dict->slots = NULL;
+    dict->slot_count = 0;
+}
+
+void string_dictionary_free(StringDictionary *dict) {
+    if (!dict) return;
+    free(dict->names);
+    free(dict->hashes);
+    free(dict->slots);
+    string_dictionary_init(dict);
+}
+
+/* Slot holding name's id + 1, or the empty slot where it belongs. */
+static uint32_t *string_dictionary_probe(const StringDictionary *dict, const char *name, size_t hash) {
+    size_t mask = dict->slot_count - 1;
+    size_t idx = hash & mask;
+    while (dict->slots[idx] != 0) {
+        uint32_t id = dict->slots[idx] - 1;
+        if (dict->hashes[id] == hash && strcmp(dict->names[id], name) == 0) break;
+        idx = (idx + 1) & mask;
+    }
+    return &dict->slots[idx];
+}
+
+static void string_dictionary_rehash(StringDictionary *dict, size_t slot_count) {
+    free(dict->slots);
+    dict->slots = (uint32_t *)calloc(slot_count, sizeof(uint32_t));
+    if (!dict->slots) {
+        fprintf(stderr, "Error: Out of memory while building dictionary\n");
+        exit(EXIT_FAILURE);
+    }
+    dict->slot_count = slot_count;
+    size_t mask = slot_count - 1;
+    for (size_t id = 0; id < dict->count; ++id) {
+        size_t idx = dict->hashes[id] & mask;
+        while (dict->slots[idx] != 0) idx = (idx + 1) & mask;
+        dict->slots[idx] = (uint32_t)(id + 1);
+    }
+}
+
+uint32_t string_dictionary_intern_hashed(StringDictionary *dict, const char *name, size_t hash) {
+    /* Keep the table at most half full. */
+    if ((dict->count + 1) * 2 > dict->slot_count) {
+        string_dictionary_rehash(dict, dict->slot_count == 0 ? 64 : dict->slot_count * 2);
+    }
+    uint32_t *slot = string_dictionary_probe(dict, name, hash);
+    if (*slot != 0) return *slot - 1;
+
+    if (dict->count == dict->capacity) {
+        size_t new_capacity = dict->capacity == 0 ? 32 : dict->capacity * 2;
+        const char **grown = (const char **)realloc(dict->names, new_capacity * sizeof(const char *));
+        size_t *grown_hashes = grown ? (size_t *)realloc(dict->hashes, new_capacity * sizeof(size_t)) : NULL;
+        if (!grown || !grown_hashes) {
+            fprintf(stderr, "Error: Out of memory while building dictionary\n");
+            exit(EXIT_FAILURE);
+        }
+        dict->names = grown;
+        dict->hashes = grown_hashes;
+        dict->capacity = new_capacity;
+    }
+    dict->names[dict->count] = name;
+    dict->hashes[dict->count] = hash;
+    *slot = (uint32_t)(dict->count + 1);
+    return (uint32_t)dict->count++;
+}
+
+uint32_t string_dictionary_intern(StringDictionary *dict, const char *name) {
+    return string_dictionary_intern_hashed(dict, name, string_dictionary_hash(name));
+}
+
+uint32_t string_dictionary_find_hashed(const StringDictionary *dict, const char *name, size_t hash) {
+    if (!dict || !name || dict->slot_count == 0) return COLUMNS_NOT_FOUND;
+    uint32_t slot = *string_dictionary_probe(dict, name, hash);
+    return slot == 0 ? COLUMNS_NOT_FOUND : slot - 1;
+}
+
+uint32_t string_dictionary_find(const StringDictionary *dict, const char *name) {
+    if (!dict || !name) return COLUMNS_NOT_FOUND;
+    return string_dictionary_find_hashed(dict, name, string_dictionary_hash(name));
+}
+
+void movie_columns_init(MovieColumns *columns) {
+    if (!columns) return;
+    columns->count = 0;
+    columns->capacity = 0;
+    columns->release_year = NULL;
+    columns->date_added = NULL;
+    columns->director_id = NULL;
+    columns->genre_set = NULL;
+    columns->type_code = NULL;
+    string_dictionary_init(&columns->directors);
+    string_dictionary_init(&columns->genres);
+    columns->genre_overflow = 0;
+    columns->genre_movies = NULL;
+    columns->genre_movies_count = 0;
+    columns->year_movies = NULL;
+    columns->year_first = 0;
+    columns->year_span = 0;
+    memset(&columns->year_order, 0, sizeof(columns->year_order));
+    memset(&columns->added_order, 0, sizeof(columns->added_order));
+    columns->borrowed = 0;
+}
+
+static void *checked_realloc(void *ptr, size_t size) {
+    void *grown = realloc(ptr, size);
+    if (!grown) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+static void *copy_array(const void *data, size_t bytes) {
+    void *copy = checked_realloc(NULL, bytes > 0 ? bytes : 1);
+    if (bytes > 0) memcpy(copy, data, bytes);
+    return copy;
+}
+
+static void copy_order(MovieOrder *order) {
+    order->base = order->base_count > 0 ? (uint32_t *)copy_array(order->base, order->base_count * sizeof(uint32_t)) : NULL;
+    order->delta = order->delta_count > 0 ? (uint32_t *)copy_array(order->delta, order->delta_count * sizeof(uint32_t))
+                                          : NULL;
+}
+
+static void free_order(MovieOrder *order) {
+    free(order->base);
+    free(order->delta);
+}
+
+/* Copy the arrays a snapshot lent the columns, so rows can be appended. */
+static void movie_columns_take_ownership(MovieColumns *columns) {
+    size_t count = columns->count;
+    columns->release_year = (int *)copy_array(columns->release_year, count * sizeof(int));
+    columns->date_added = (int *)copy_array(columns->date_added, count * sizeof(int));
+    columns->director_id = (uint32_t *)copy_array(columns->director_id, count * sizeof(uint32_t));
+    columns->genre_set = (GenreSet *)copy_array(columns->genre_set, count * sizeof(GenreSet));
+    columns->type_code = (unsigned char *)copy_array(columns->type_code, count * sizeof(unsigned char));
+    copy_order(&columns->year_order);
+    copy_order(&columns->added_order);
+    columns->capacity = count;
+    columns->borrowed = 0;
+}
+
+void movie_columns_reserve(MovieColumns *columns, size_t count) {
+    if (columns->borrowed) movie_columns_take_ownership(columns);
+    if (count <= columns->capacity) return;
+    size_t capacity = columns->capacity == 0 ? count : columns->capacity;
+    while (capacity < count) capacity *= 2;
+    columns->release_year = (int *)checked_realloc(columns->release_year, capacity * sizeof(int));
+    columns->date_added = (int *)checked_realloc(columns->date_added, capacity * sizeof(int));
+    columns->director_id = (uint32_t *)checked_realloc(columns->director_id, capacity * sizeof(uint32_t));
+    columns->genre_set = (GenreSet *)checked_realloc(columns->genre_set, capacity * sizeof(GenreSet));
+    columns->type_code = (unsigned char *)checked_realloc(columns->type_code, capacity * sizeof(unsigned char));
+    columns->capacity = capacity;
+}
+
+void movie_columns_free(MovieColumns *columns) {
+    if (!columns) return;
+    if (!columns->borrowed) {
+        free(columns->release_year);
+        free(columns->date_added);
+        free_order(&columns->year_order);
+        free_order(&columns->added_order);
+        free(columns->director_id);
+        free(columns->genre_set);
+        free(columns->type_code);
+    }
+    string_dictionary_free(&columns->directors);
+    string_dictionary_free(&columns->genres);
+    for (size_t i = 0; i < columns->genre_movies_count; ++i) result_set_free(&columns->genre_movies[i]);
+    free(columns->genre_movies);
+    for (size_t i = 0; i < columns->year_span; ++i) result_set_free(&columns->year_movies[i]);
+    free(columns->year_movies);
+    movie_columns_init(columns);
+}
+
+ResultSet *movie_columns_genre_movies(MovieColumns *columns, uint32_t genre_id) {
+    if (genre_id >= columns->genre_movies_count) {
+        size_t count = columns->genre_movies_count == 0 ? 32 : columns->genre_movies_count;
+        while (count <= genre_id) count *= 2;
+        columns->genre_movies = (ResultSet *)checked_realloc(columns->genre_movies, count * sizeof(ResultSet));
+        for (size_t i = columns->genre_movies_count; i < count; ++i) result_set_init(&columns->genre_movies[i]);
+        columns->genre_movies_count = count;
+    }
+    return &columns->genre_movies[genre_id];
+}
+
+ResultSet *movie_columns_year_movies(MovieColumns *columns, int year) {
+    if (columns->year_span == 0) {
+        columns->year_movies = (ResultSet *)checked_realloc(NULL, sizeof(ResultSet));
+        result_set_init(&columns->year_movies[0]);
+        columns->year_first = year;
+        columns->year_span = 1;
+    } else if (year < columns->year_first) {
+        /* Grow downwards: shift the existing years up. */
+        size_t extra = (size_t)(columns->year_first - year);
+        size_t span = columns->year_span + extra;
+        columns->year_movies = (ResultSet *)checked_realloc(columns->year_movies, span * sizeof(ResultSet));
+        memmove(columns->year_movies + extra, columns->year_movies, columns->year_span * sizeof(ResultSet));
+        for (size_t i = 0; i < extra; ++i) result_set_init(&columns->year_movies[i]);
+        columns->year_first = year;
+        columns->year_span = span;
+    } else if ((size_t)(year - columns->year_first) >= columns->year_span) {
+        size_t span = (size_t)(year - columns->year_first) + 1;
+        columns->year_movies = (ResultSet *)checked_realloc(columns->year_movies, span * sizeof(ResultSet));
+        for (size_t i = columns->year_span; i < span; ++i) result_set_init(&columns->year_movies[i]);
+        columns->year_span = span;
+    }
+    return &columns->year_movies[year - columns->year_first];
+}
+
+const ResultSet *movie_columns_find_year(const MovieColumns *columns, int year) {
+    if (!columns || columns->year_span == 0 || year < columns->year_first) return NULL;
+    size_t offset = (size_t)(year - columns->year_first);
+    return offset < columns->year_span ? &columns->year_movies[offset] : NULL;
+}
+
+static int compare_u64(const void *lhs, const void *rhs) {
+    uint64_t a = *(const uint64_t *)lhs;
+    uint64_t b = *(const uint64_t *)rhs;
+    return (a > b) - (a < b);
+}
+
+/* Rows [first, last) with values[i] >= min_value, sorted by (value, index) into *out_count ids. */
+static uint32_t *sort_rows(const int *values, size_t first, size_t last, int min_value, size_t *out_count) {
+    size_t added = 0;
+    int low = INT_MAX;
+    int high = INT_MIN;
+    for (size_t i = first; i < last; ++i) {
+        if (values[i] < min_value) continue;
+        added++;
+        if (values[i] < low) low = values[i];
+        if (values[i] > high) high = values[i];
+    }
+    *out_count = added;
+    if (added == 0) return NULL;
+    uint32_t *rows = (uint32_t *)checked_realloc(NULL, added * sizeof(uint32_t));
+
+    /* Years and dates span few distinct values: a counting sort is linear and keeps rows in index order. */
+    size_t span = (size_t)((int64_t)high - low) + 1;
+    if (span <= added * 4 + 1024) {
+        size_t *starts = (size_t *)calloc(span + 1, sizeof(size_t));
+        if (!starts) {
+            fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", (span + 1) * sizeof(size_t));
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = first; i < last; ++i) {
+            if (values[i] >= min_value) starts[(size_t)(values[i] - low) + 1]++;
+        }
+        for (size_t v = 1; v <= span; ++v) starts[v] += starts[v - 1];
+        for (size_t i = first; i < last; ++i) {
+            if (values[i] >= min_value) rows[starts[values[i] - low]++] = (uint32_t)i;
+        }
+        free(starts);
+        return rows;
+    }
+
+    /* Bias the value so the packed keys sort as unsigned integers. */
+    uint64_t *keys = (uint64_t *)checked_realloc(NULL, added * sizeof(uint64_t));
+    size_t k = 0;
+    for (size_t i = first; i < last; ++i) {
+        if (values[i] >= min_value) keys[k++] = (uint64_t)((uint32_t)values[i] ^ 0x80000000u) << 32 | (uint64_t)i;
+    }
+    qsort(keys, added, sizeof(uint64_t), compare_u64);
+    for (size_t j = 0; j < added; ++j) rows[j] = (uint32_t)keys[j];
+    free(keys);
+    return rows;
+}
+
+/* Merge two sorted orders into a new array; on ties old comes first. Frees both. */
+static uint32_t *merge_orders(uint32_t *old, size_t old_count, uint32_t *rows, size_t added, const int *values) {
+    if (old_count == 0) {
+        free(old);
+        return rows;
+    }
+    uint32_t *merged = (uint32_t *)checked_realloc(NULL, (old_count + added) * sizeof(uint32_t));
+    size_t a = 0;
+    size_t b = 0;
+    size_t out = 0;
+    while (a < old_count || b < added) {
+        if (b == added || (a < old_count && values[old[a]] <= values[rows[b]])) {
+            merged[out++] = old[a++];
+        } else {
+            merged[out++] = rows[b++];
+        }
+    }
+    free(rows);
+    free(old);
+    return merged;
+}
+
+/* Merge the sorted rows [first, last) into the delta of order, and the delta into the base once it is large. */
+static void extend_order(MovieOrder *order, const int *values, size_t first, size_t last, int min_value) {
+    size_t added = 0;
+    uint32_t *rows = sort_rows(values, first, last, min_value, &added);
+    if (added == 0) return;
+    order->delta = merge_orders(order->delta, order->delta_count, rows, added, values);
+    order->delta_count += added;
+    if (order->delta_count * MOVIE_ORDER_FOLD_FRACTION > order->base_count) {
+        order->base = merge_orders(order->base, order->base_count, order->delta, order->delta_count, values);
+        order->base_count += order->delta_count;
+        order->delta = NULL;
+        order->delta_count = 0;
+    }
+}
+
+void movie_columns_extend_orders(MovieColumns *columns, size_t first) {
+    if (!columns || first >= columns->count) return;
+    extend_order(&columns->year_order, columns->release_year, first, columns->count, 1);
+    extend_order(&columns->added_order, columns->date_added, first, columns->count, INT_MIN + 1);
+}
+
+size_t movie_columns_lower_bound(const uint32_t *order, size_t count, const int *values, int value) {
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (values[order[mid]] < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+size_t movie_order_count(const MovieOrder *order) {
+    return order->base_count + order->delta_count;
+}
+
+void movie_order_all(const MovieOrder *order, MovieOrderSlice *slice) {
+    slice->base_lo = 0;
+    slice->base_hi = order->base_count;
+    slice->delta_lo = 0;
+    slice->delta_hi = order->delta_count;
+}
+
+void movie_order_range(const MovieOrder *order, const int *values, int from, int to, MovieOrderSlice *slice) {
+    slice->base_lo = movie_columns_lower_bound(order->base, order->base_count, values, from);
+    slice->delta_lo = movie_columns_lower_bound(order->delta, order->delta_count, values, from);
+    if (from > to) {
+        slice->base_hi = slice->base_lo;
+        slice->delta_hi = slice->delta_lo;
+    } else if (to == INT_MAX) {
+        slice->base_hi = order->base_count;
+        slice->delta_hi = order->delta_count;
+    } else {
+        slice->base_hi = movie_columns_lower_bound(order->base, order->base_count, values, to + 1);
+        slice->delta_hi = movie_columns_lower_bound(order->delta, order->delta_count, values, to + 1);
+    }
+}
+
+size_t movie_order_slice_count(const MovieOrderSlice *slice) {
+    return (slice->base_hi - slice->base_lo) + (slice->delta_hi - slice->delta_lo);
+}
+
+int movie_order_first_value(const MovieOrder *order, const int *values, const MovieOrderSlice *slice, int *value) {
+    int have_base = slice->base_lo < slice->base_hi;
+    int have_delta = slice->delta_lo < slice->delta_hi;
+    if (!have_base && !have_delta) return 0;
+    int base_value = have_base ? values[order->base[slice->base_lo]] : INT_MAX;
+    int delta_value = have_delta ? values[order->delta[slice->delta_lo]] : INT_MAX;
+    *value = base_value < delta_value ? base_value : delta_value;
+    return 1;
+}
+
+int movie_order_last_value(const MovieOrder *order, const int *values, const MovieOrderSlice *slice, int *value) {
+    int have_base = slice->base_lo < slice->base_hi;
+    int have_delta = slice->delta_lo < slice->delta_hi;
+    if (!have_base && !have_delta) return 0;
+    int base_value = have_base ? values[order->base[slice->base_hi - 1]] : INT_MIN;
+    int delta_value = have_delta ? values[order->delta[slice->delta_hi - 1]] : INT_MIN;
+    *value = base_value > delta_value ? base_value : delta_value;
+    return 1;
+}
+
+size_t movie_order_take(const MovieOrder *order, const int *values, MovieOrderSlice *slice, size_t *out, size_t max) {
+    size_t count = 0;
+    while (count < max) {
+        int from_base;
+        if (slice->base_lo == slice->base_hi) {
+            if (slice->delta_lo == slice->delta_hi) break;
+            from_base = 0;
+        } else if (slice->delta_lo == slice->delta_hi) {
+            from_base = 1;
+        } else {
+            from_base = values[order->base[slice->base_lo]] <= values[order->delta[slice->delta_lo]];
+        }
+        uint32_t movie = from_base ? order->base[slice->base_lo++] : order->delta[slice->delta_lo++];
+        if (out) out[count] = movie;
+        count++;
+    }
+    return count;
+}
+
+size_t movie_order_take_last(const MovieOrder *order, const int *values, MovieOrderSlice *slice, size_t *out,
+                             size_t max) {
+    size_t count = 0;
+    while (count < max) {
+        int from_delta;
+        if (slice->delta_lo == slice->delta_hi) {
+            if (slice->base_lo == slice->base_hi) break;
+            from_delta = 0;
+        } else if (slice->base_lo == slice->base_hi) {
+            from_delta = 1;
+        } else {
+            /* Delta rows come after base rows of the same value. */
+            from_delta = values[order->delta[slice->delta_hi - 1]] >= values[order->base[slice->base_hi - 1]];
+        }
+        uint32_t movie = from_delta ? order->delta[--slice->delta_hi] : order->base[--slice->base_hi];
+        if (out) out[count] = movie;
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,470 @@
+#include "cursor.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "substring.h"
+#include "trigram.h"
+
+/* Where a cursor's movies come from. */
+enum {
+    CURSOR_NONE,
+    CURSOR_RUN,           /* one title's movies */
+    CURSOR_ORDER,         /* a slice of a sorted order */
+    CURSOR_SET,           /* a result set, owned or borrowed */
+    CURSOR_TITLE_KEYS,    /* title keys containing the needle, found on demand */
+    CURSOR_PEOPLE,        /* posting lists of some people, merged on demand */
+    CURSOR_DIRECTOR_ROWS, /* rows whose whole director field is wanted, scanned on demand */
+    CURSOR_GENRE_ROWS     /* rows with a wanted genre, scanned on demand */
+};
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static char *string_duplicate(const char *src, size_t len) {
+    char *copy = (char *)checked_malloc(len + 1);
+    memcpy(copy, src, len + 1);
+    return copy;
+}
+
+void search_cursor_init(SearchCursor *cursor) {
+    if (!cursor) return;
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->source = CURSOR_NONE;
+    result_set_init(&cursor->set);
+}
+
+void search_cursor_close(SearchCursor *cursor) {
+    if (!cursor) return;
+    free(cursor->needle);
+    free(cursor->keys);
+    result_set_free(&cursor->set);
+    free(cursor->lists);
+    free(cursor->list_pos);
+    free(cursor->heap);
+    free(cursor->wanted);
+    search_cursor_init(cursor);
+}
+
+/* ---- posting list merge ---- */
+
+static size_t runs_length(const PersonPostingRuns *runs) {
+    return runs->base_count + runs->delta_count;
+}
+
+static uint32_t runs_at(const PersonPostingRuns *runs, size_t pos) {
+    return pos < runs->base_count ? runs->base[pos] : (uint32_t)runs->delta[pos - runs->base_count];
+}
+
+static void heap_push(SearchCursor *cursor, uint64_t entry) {
+    uint64_t *heap = cursor->heap;
+    size_t i = cursor->heap_count++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap[parent] <= entry) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = entry;
+}
+
+static uint64_t heap_pop(SearchCursor *cursor) {
+    uint64_t *heap = cursor->heap;
+    uint64_t top = heap[0];
+    uint64_t last = heap[--cursor->heap_count];
+    size_t n = cursor->heap_count;
+    size_t i = 0;
+    while (2 * i + 1 < n) {
+        size_t child = 2 * i + 1;
+        if (child + 1 < n && heap[child + 1] < heap[child]) child++;
+        if (heap[child] >= last) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (n > 0) heap[i] = last;
+    return top;
+}
+
+/* Add one person's movies under role to the merge; people without any are skipped. */
+static void cursor_add_person(SearchCursor *cursor, uint32_t person, PersonRole role) {
+    PersonPostingRuns runs;
+    person_index_postings(&cursor->db->people, person, role, &runs);
+    size_t length = runs_length(&runs);
+    if (length == 0) return;
+    size_t list = cursor->list_count++;
+    cursor->lists[list] = runs;
+    cursor->list_pos[list] = 1;
+    cursor->total += length;
+    heap_push(cursor, (uint64_t)runs_at(&runs, 0) << 32 | list);
+}
+
+static void cursor_prepare_people(SearchCursor *cursor, size_t capacity) {
+    size_t room = capacity > 0 ? capacity : 1;
+    cursor->source = CURSOR_PEOPLE;
+    cursor->lists = (PersonPostingRuns *)checked_malloc(room * sizeof(PersonPostingRuns));
+    cursor->list_pos = (size_t *)checked_malloc(room * sizeof(size_t));
+    cursor->heap = (uint64_t *)checked_malloc(room * sizeof(uint64_t));
+    cursor->last_movie = SIZE_MAX;
+}
+
+/* A single list needs no merging, so its length is the exact total. */
+static int cursor_finish_people(SearchCursor *cursor) {
+    cursor->total_exact = cursor->list_count == 1;
+    return cursor->list_count > 0;
+}
+
+static size_t next_people(SearchCursor *cursor, size_t *out, size_t max) {
+    size_t count = 0;
+    while (count < max && cursor->heap_count > 0) {
+        uint64_t top = heap_pop(cursor);
+        size_t movie = (size_t)(top >> 32);
+        size_t list = (size_t)(top & 0xffffffffu);
+        cursor->consumed++;
+        if (cursor->list_pos[list] < runs_length(&cursor->lists[list])) {
+            heap_push(cursor, (uint64_t)runs_at(&cursor->lists[list], cursor->list_pos[list]++) << 32 | list);
+        }
+        if (movie == cursor->last_movie) continue;
+        cursor->last_movie = movie;
+        out[count++] = movie;
+    }
+    return count;
+}
+
+/* ---- title keys ---- */
+
+/* Next title key containing the needle, or SIZE_MAX. */
+static size_t next_title_key(SearchCursor *cursor) {
+    const TitleIndex *titles = cursor->titles;
+    if (!cursor->keys) {
+        if (cursor->next >= titles->size) return SIZE_MAX;
+        size_t id = text_blob_next(&titles->key_text, cursor->needle, cursor->needle_len, cursor->next);
+        cursor->next = id < titles->size ? id + 1 : titles->size;
+        return id < titles->size ? id : SIZE_MAX;
+    }
+    while (cursor->next < cursor->key_count) {
+        uint32_t id = cursor->keys[cursor->next++];
+        const char *key = titles->entries[id].key_lower;
+        if (substring_find(key, strlen(key), cursor->needle, cursor->needle_len)) return id;
+    }
+    return SIZE_MAX;
+}
+
+static size_t take_run(SearchCursor *cursor, size_t *out, size_t max) {
+    size_t count = 0;
+    while (count < max && cursor->run_pos < cursor->run_count) out[count++] = cursor->run[cursor->run_pos++];
+    return count;
+}
+
+static size_t next_title_keys(SearchCursor *cursor, size_t *out, size_t max) {
+    size_t count = take_run(cursor, out, max);
+    while (count < max) {
+        size_t id = next_title_key(cursor);
+        if (id == SIZE_MAX) break;
+        cursor->run = cursor->titles->entries[id].indices;
+        cursor->run_count = cursor->titles->entries[id].count;
+        cursor->run_pos = 0;
+        count += take_run(cursor, out + count, max - count);
+    }
+    return count;
+}
+
+/* ---- director rows ---- */
+
+static size_t next_director_rows(SearchCursor *cursor, size_t *out, size_t max) {
+    const uint32_t *director_id = cursor->db->columns.director_id;
+    size_t count = 0;
+    while (count < max && cursor->next < cursor->end) {
+        size_t row = cursor->next++;
+        uint32_t id = director_id[row];
+        if (id != COLUMNS_NO_DIRECTOR && cursor->wanted[id]) out[count++] = row;
+    }
+    return count;
+}
+
+/* Scan rows for directors flagged in cursor->wanted; returns 0 when none is. */
+static int cursor_start_director_rows(SearchCursor *cursor, int any) {
+    if (!any) return 0;
+    cursor->source = CURSOR_DIRECTOR_ROWS;
+    cursor->next = 0;
+    cursor->end = cursor->db->columns.count;
+    return 1;
+}
+
+static int open_director(SearchCursor *cursor, const char *director_lower) {
+    const MovieDatabase *db = cursor->db;
+    uint32_t person = person_index_find(&db->people, director_lower);
+    if (person_index_posting_count(&db->people, person, PERSON_ROLE_DIRECTOR) > 0) {
+        cursor_prepare_people(cursor, 1);
+        cursor_add_person(cursor, person, PERSON_ROLE_DIRECTOR);
+        return cursor_finish_people(cursor);
+    }
+    if (!strchr(director_lower, ',')) return 0;
+
+    /* A whole multi-director field, as in search_by_director. */
+    uint32_t target = string_dictionary_find(&db->columns.directors, director_lower);
+    if (target == COLUMNS_NOT_FOUND) return 0;
+    cursor->wanted = (unsigned char *)calloc(db->columns.directors.count, 1);
+    if (!cursor->wanted) return 0;
+    cursor->wanted[target] = 1;
+    return cursor_start_director_rows(cursor, 1);
+}
+
+static int open_people_partial(SearchCursor *cursor, PersonRole role, const char *needle) {
+    const PersonIndex *people = &cursor->db->people;
+    uint32_t *ids = NULL;
+    size_t id_count = 0;
+    text_blob_search(&people->name_text, needle, &ids, &id_count);
+    cursor_prepare_people(cursor, id_count);
+    for (size_t i = 0; i < id_count; ++i) cursor_add_person(cursor, ids[i], role);
+    free(ids);
+    return cursor_finish_people(cursor);
+}
+
+static int open_director_partial(SearchCursor *cursor, const char *needle) {
+    if (!strchr(needle, ',')) return open_people_partial(cursor, PERSON_ROLE_DIRECTOR, needle);
+
+    /* The needle spans several names, so match it against whole director fields. */
+    const StringDictionary *directors = &cursor->db->columns.directors;
+    if (directors->count == 0) return 0;
+    cursor->wanted = (unsigned char *)calloc(directors->count, 1);
+    if (!cursor->wanted) return 0;
+    int any = 0;
+    size_t needle_len = strlen(needle);
+    for (size_t id = 0; id < directors->count; ++id) {
+        if (substring_find(directors->names[id], strlen(directors->names[id]), needle, needle_len) != NULL) {
+            cursor->wanted[id] = 1;
+            any = 1;
+        }
+    }
+    return cursor_start_director_rows(cursor, any);
+}
+
+/* ---- sets ---- */
+
+static int cursor_start_set(SearchCursor *cursor, const ResultSet *set) {
+    cursor->source = CURSOR_SET;
+    result_set_iterator_init(&cursor->set_it, set);
+    cursor->total = result_set_cardinality(set);
+    cursor->total_exact = 1;
+    return cursor->total > 0;
+}
+
+static size_t next_genre_rows(SearchCursor *cursor, size_t *out, size_t max) {
+    const GenreSet *genre_set = cursor->db->columns.genre_set;
+    size_t count = 0;
+    while (count < max && cursor->next < cursor->end) {
+        size_t row = cursor->next++;
+        if (genre_set_intersects(&genre_set[row], &cursor->genres)) out[count++] = row;
+    }
+    return count;
+}
+
+/*
+ * The movies of every genre whose name contains needle, as search_by_genre_partial.
+ * One genre is its own set, and several are found by scanning the rows' genre
+ * sets on demand; genres beyond GENRE_SET_CAPACITY have their sets ORed instead.
+ */
+static int open_genre_partial(SearchCursor *cursor, const char *needle) {
+    const MovieColumns *columns = &cursor->db->columns;
+    size_t needle_len = strlen(needle);
+    size_t genre_count = columns->genres.count < columns->genre_movies_count ? columns->genres.count
+                                                                               : columns->genre_movies_count;
+    size_t matched = 0;
+    size_t first = 0;
+    int fits = 1;
+    genre_set_clear(&cursor->genres);
+    for (size_t id = 0; id < genre_count; ++id) {
+        const char *name = columns->genres.names[id];
+        if (substring_find(name, strlen(name), needle, needle_len) == NULL) continue;
+        if (matched++ == 0) first = id;
+        if (!genre_set_add(&cursor->genres, (uint32_t)id)) fits = 0;
+        cursor->total += result_set_cardinality(&columns->genre_movies[id]);
+    }
+    if (matched == 0) return 0;
+    if (matched == 1) return cursor_start_set(cursor, &columns->genre_movies[first]);
+    if (fits) {
+        cursor->source = CURSOR_GENRE_ROWS;
+        cursor->next = 0;
+        cursor->end = columns->count;
+        return 1;
+    }
+
+    ResultSet merged;
+    result_set_init(&merged);
+    for (size_t id = first; id < genre_count; ++id) {
+        const char *name = columns->genres.names[id];
+        if (substring_find(name, strlen(name), needle, needle_len) == NULL) continue;
+        result_set_or(&merged, &cursor->set, &columns->genre_movies[id]);
+        ResultSet swap = cursor->set;
+        cursor->set = merged;
+        merged = swap;
+    }
+    result_set_free(&merged);
+    return cursor_start_set(cursor, &cursor->set);
+}
+
+/* ---- opening ---- */
+
+static int open_title(SearchCursor *cursor, const char *title_lower) {
+    const TitleIndexEntry *entry = title_index_entry(cursor->titles, title_lower);
+    if (!entry || entry->count == 0) return 0;
+    cursor->source = CURSOR_RUN;
+    cursor->run = entry->indices;
+    cursor->run_count = entry->count;
+    cursor->total = entry->count;
+    cursor->total_exact = 1;
+    return 1;
+}
+
+static int open_title_partial(SearchCursor *cursor, const char *needle) {
+    const TitleIndex *titles = cursor->titles;
+    if (!titles || titles->size == 0) return 0;
+    cursor->source = CURSOR_TITLE_KEYS;
+    cursor->needle_len = strlen(needle);
+    cursor->needle = string_duplicate(needle, cursor->needle_len);
+    if (trigram_index_candidates(&titles->trigrams, needle, &cursor->keys, &cursor->key_count)) {
+        if (cursor->key_count > 0) return 1;
+        cursor->source = CURSOR_NONE;
+        return 0;
+    }
+    cursor->keys = NULL; /* short needle: scan the packed key text instead */
+    return 1;
+}
+
+int search_cursor_open(SearchCursor *cursor, const MovieDatabase *db, const TitleIndex *titles, SearchKind kind,
+                       const char *text_lower) {
+    if (!cursor) return 0;
+    search_cursor_close(cursor);
+    if (!db || !text_lower) return 0;
+    cursor->db = db;
+    cursor->titles = titles;
+
+    switch (kind) {
+    case SEARCH_TITLE:
+        return open_title(cursor, text_lower);
+    case SEARCH_TITLE_PARTIAL:
+        return open_title_partial(cursor, text_lower);
+    case SEARCH_DIRECTOR:
+        return open_director(cursor, text_lower);
+    case SEARCH_DIRECTOR_PARTIAL:
+        return open_director_partial(cursor, text_lower);
+    case SEARCH_CAST:
+        cursor_prepare_people(cursor, 1);
+        cursor_add_person(cursor, person_index_find(&db->people, text_lower), PERSON_ROLE_CAST);
+        return cursor_finish_people(cursor);
+    case SEARCH_CAST_PARTIAL:
+        return open_people_partial(cursor, PERSON_ROLE_CAST, text_lower);
+    case SEARCH_GENRE: {
+        uint32_t target = string_dictionary_find(&db->columns.genres, text_lower);
+        if (target == COLUMNS_NOT_FOUND || target >= db->columns.genre_movies_count) return 0;
+        return cursor_start_set(cursor, &db->columns.genre_movies[target]);
+    }
+    case SEARCH_GENRE_PARTIAL:
+        return open_genre_partial(cursor, text_lower);
+    }
+    return 0;
+}
+
+int search_cursor_open_years(SearchCursor *cursor, const MovieDatabase *db, int from, int to) {
+    if (!cursor) return 0;
+    search_cursor_close(cursor);
+    if (!db || from > to || to <= 0) return 0;
+    const MovieColumns *columns = &db->columns;
+    MovieOrderSlice slice;
+    movie_order_range(&columns->year_order, columns->release_year, from, to, &slice);
+    size_t total = movie_order_slice_count(&slice);
+    if (total == 0) return 0;
+    cursor->db = db;
+    cursor->source = CURSOR_ORDER;
+    cursor->order = &columns->year_order;
+    cursor->order_values = columns->release_year;
+    cursor->slice = slice;
+    cursor->total = total;
+    cursor->total_exact = 1;
+    return 1;
+}
+
+int search_cursor_open_set(SearchCursor *cursor, const ResultSet *set) {
+    if (!cursor) return 0;
+    search_cursor_close(cursor);
+    if (!set) return 0;
+    return cursor_start_set(cursor, set);
+}
+
+size_t search_cursor_next(SearchCursor *cursor, size_t *out, size_t max) {
+    if (!cursor || !out || cursor->done || max == 0) return 0;
+    size_t count = 0;
+    switch (cursor->source) {
+    case CURSOR_RUN:
+        count = take_run(cursor, out, max);
+        break;
+    case CURSOR_ORDER:
+        count = movie_order_take(cursor->order, cursor->order_values, &cursor->slice, out, max);
+        break;
+    case CURSOR_SET:
+        count = result_set_iterator_next(&cursor->set_it, out, max);
+        break;
+    case CURSOR_TITLE_KEYS:
+        count = next_title_keys(cursor, out, max);
+        break;
+    case CURSOR_PEOPLE:
+        count = next_people(cursor, out, max);
+        break;
+    case CURSOR_DIRECTOR_ROWS:
+        count = next_director_rows(cursor, out, max);
+        break;
+    case CURSOR_GENRE_ROWS:
+        count = next_genre_rows(cursor, out, max);
+        break;
+    default:
+        break;
+    }
+    /* Every source fills the batch unless it has run dry. */
+    if (count < max) cursor->done = 1;
+    cursor->emitted += count;
+    return count;
+}
+
+/* Share of the source looked at so far, for sources whose size is not known up front. */
+static double search_cursor_progress(const SearchCursor *cursor) {
+    switch (cursor->source) {
+    case CURSOR_TITLE_KEYS:
+        if (cursor->keys) return cursor->key_count ? (double)cursor->next / (double)cursor->key_count : 1.0;
+        if (cursor->next >= cursor->titles->size || cursor->titles->key_text.length == 0) return 1.0;
+        return (double)cursor->titles->key_text.starts[cursor->next] / (double)cursor->titles->key_text.length;
+    case CURSOR_PEOPLE:
+        return cursor->total ? (double)cursor->consumed / (double)cursor->total : 1.0;
+    case CURSOR_DIRECTOR_ROWS:
+    case CURSOR_GENRE_ROWS:
+        return cursor->end ? (double)cursor->next / (double)cursor->end : 1.0;
+    default:
+        return 1.0;
+    }
+}
+
+size_t search_cursor_estimate(const SearchCursor *cursor, int *exact) {
+    if (exact) *exact = 1;
+    if (!cursor) return 0;
+    if (cursor->done) return cursor->emitted;
+    if (cursor->total_exact) return cursor->total;
+    if (exact) *exact = 0;
+
+    /* What the current title still holds is certain; the rest is extrapolated. */
+    size_t known = cursor->emitted + (cursor->run_count - cursor->run_pos);
+    double progress = search_cursor_progress(cursor);
+    if (progress <= 0.0) return known;
+    double estimate = (double)cursor->emitted / progress + 0.5;
+    /* Merged posting lists and genre sets can share movies, so their sum only bounds the total. */
+    if ((cursor->source == CURSOR_PEOPLE || cursor->source == CURSOR_GENRE_ROWS) && estimate > (double)cursor->total) {
+        estimate = (double)cursor->total;
+    }
+    return estimate > (double)known ? (size_t)estimate : known;
+}
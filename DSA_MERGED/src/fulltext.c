@@ -0,0 +1,383 @@
+#include "fulltext.h"
+#include "casefold.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Longer tokens (URLs, run-together words) are not indexed. */
+#define FULL_TEXT_TERM_MAX 32
+
+/* Sorted for bsearch; one-letter words are dropped before this list is consulted. */
+static const char *const stop_words[] = {
+    "an", "and", "are", "as", "at", "be", "but", "by", "for", "from", "has", "he", "her", "his", "in",
+    "into", "is", "it", "its", "of", "on", "or", "she", "that", "the", "their", "them", "they", "this",
+    "to", "was", "were", "who", "with",
+};
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static void *checked_realloc(void *ptr, size_t size) {
+    void *grown = realloc(ptr, size);
+    if (!grown) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+void full_text_index_init(FullTextIndex *index) {
+    if (!index) return;
+    index->fields = 0;
+    index->doc_count = 0;
+    string_dictionary_init(&index->terms);
+    arena_init(&index->arena);
+    index->term_offsets = NULL;
+    index->posting_docs = NULL;
+    index->posting_freqs = NULL;
+    index->term_max_weight = NULL;
+    index->doc_lengths = NULL;
+    index->average_length = 0.0;
+    index->built = 0;
+}
+
+void full_text_index_free(FullTextIndex *index) {
+    if (!index) return;
+    string_dictionary_free(&index->terms);
+    arena_free(&index->arena);
+    free(index->term_offsets);
+    free(index->posting_docs);
+    free(index->posting_freqs);
+    free(index->term_max_weight);
+    free(index->doc_lengths);
+    full_text_index_init(index);
+}
+
+int full_text_index_is_stale(const FullTextIndex *index, const MovieDatabase *db, unsigned fields) {
+    return !index || !db || !index->built || index->doc_count != db->count || index->fields != fields;
+}
+
+static int is_term_byte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+static int compare_stop_word(const void *key, const void *entry) {
+    return strcmp((const char *)key, *(const char *const *)entry);
+}
+
+/*
+ * Next indexable term of text at or after *cursor, folded into term
+ * (FULL_TEXT_TERM_MAX + 1 bytes); returns 0 at the end of the text.
+ */
+static int next_term(const char **cursor, char *term) {
+    const char *p = *cursor;
+    while (*p) {
+        while (*p && !is_term_byte((unsigned char)*p)) p++;
+        const char *start = p;
+        while (*p && is_term_byte((unsigned char)*p)) p++;
+        size_t len = (size_t)(p - start);
+        if (len < 2 || len > FULL_TEXT_TERM_MAX) continue;
+        len = casefold(term, start, len, CASEFOLD_KEYS);
+        if (len < 2) continue;
+        if (len <= 5 && bsearch(term, stop_words, sizeof(stop_words) / sizeof(stop_words[0]), sizeof(stop_words[0]),
+                                compare_stop_word)) {
+            continue;
+        }
+        *cursor = p;
+        return 1;
+    }
+    *cursor = p;
+    return 0;
+}
+
+/* BM25 weight of a term occurring freq times in a document of length terms, before the idf factor. */
+static double term_weight(const FullTextIndex *index, uint16_t freq, uint32_t length) {
+    double norm = FULL_TEXT_BM25_K1 * (1.0 - FULL_TEXT_BM25_B + FULL_TEXT_BM25_B * (double)length / index->average_length);
+    return (double)freq * (FULL_TEXT_BM25_K1 + 1.0) / ((double)freq + norm);
+}
+
+int full_text_index_build(FullTextIndex *index, const MovieDatabase *db, unsigned fields) {
+    if (!index || !db) return 0;
+    full_text_index_free(index);
+    size_t doc_count = db->count;
+    index->doc_lengths = (uint32_t *)checked_malloc((doc_count > 0 ? doc_count : 1) * sizeof(uint32_t));
+
+    /* (term, movie, frequency) per distinct term of every movie, in movie order. */
+    uint32_t *entry_terms = NULL;
+    uint32_t *entry_docs = NULL;
+    uint16_t *entry_freqs = NULL;
+    size_t entry_count = 0;
+    size_t entry_capacity = 0;
+    uint32_t *doc_terms = NULL;
+    size_t doc_term_capacity = 0;
+    double total_length = 0.0;
+    char term[FULL_TEXT_TERM_MAX + 1];
+    for (size_t doc = 0; doc < doc_count; ++doc) {
+        const Movie *movie = &db->movies[doc];
+        const char *texts[3] = {
+            (fields & FULL_TEXT_TITLE) ? movie->title : NULL,
+            (fields & FULL_TEXT_CAST) ? movie->cast : NULL,
+            (fields & FULL_TEXT_DESCRIPTION) ? movie->description : NULL,
+        };
+        size_t length = 0;
+        for (size_t f = 0; f < 3; ++f) {
+            const char *cursor = texts[f];
+            if (!cursor) continue;
+            while (next_term(&cursor, term)) {
+                size_t hash = string_dictionary_hash(term);
+                uint32_t id = string_dictionary_find_hashed(&index->terms, term, hash);
+                if (id == COLUMNS_NOT_FOUND) {
+                    id = string_dictionary_intern_hashed(&index->terms, arena_strdup(&index->arena, term), hash);
+                }
+                if (length == doc_term_capacity) {
+                    doc_term_capacity = doc_term_capacity == 0 ? 64 : doc_term_capacity * 2;
+                    doc_terms = (uint32_t *)checked_realloc(doc_terms, doc_term_capacity * sizeof(uint32_t));
+                }
+                doc_terms[length++] = id;
+            }
+        }
+        index->doc_lengths[doc] = (uint32_t)length;
+        total_length += (double)length;
+
+        /* Documents are a few dozen terms, where insertion sort beats qsort. */
+        for (size_t i = 1; i < length; ++i) {
+            uint32_t value = doc_terms[i];
+            size_t j = i;
+            for (; j > 0 && doc_terms[j - 1] > value; --j) doc_terms[j] = doc_terms[j - 1];
+            doc_terms[j] = value;
+        }
+        for (size_t i = 0; i < length;) {
+            size_t run = i + 1;
+            while (run < length && doc_terms[run] == doc_terms[i]) run++;
+            if (entry_count == entry_capacity) {
+                entry_capacity = entry_capacity == 0 ? 4096 : entry_capacity * 2;
+                entry_terms = (uint32_t *)checked_realloc(entry_terms, entry_capacity * sizeof(uint32_t));
+                entry_docs = (uint32_t *)checked_realloc(entry_docs, entry_capacity * sizeof(uint32_t));
+                entry_freqs = (uint16_t *)checked_realloc(entry_freqs, entry_capacity * sizeof(uint16_t));
+            }
+            entry_terms[entry_count] = doc_terms[i];
+            entry_docs[entry_count] = (uint32_t)doc;
+            entry_freqs[entry_count] = (uint16_t)(run - i < UINT16_MAX ? run - i : UINT16_MAX);
+            entry_count++;
+            i = run;
+        }
+    }
+    free(doc_terms);
+    index->average_length = doc_count > 0 && total_length > 0.0 ? total_length / (double)doc_count : 1.0;
+
+    /* Postings per term; movies were visited in order, so each list comes out ascending. */
+    size_t term_count = index->terms.count;
+    index->term_offsets = (size_t *)calloc(term_count + 1, sizeof(size_t));
+    if (!index->term_offsets) {
+        fprintf(stderr, "Error: Out of memory while building the full-text index\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t e = 0; e < entry_count; ++e) index->term_offsets[entry_terms[e] + 1]++;
+    for (size_t t = 0; t < term_count; ++t) index->term_offsets[t + 1] += index->term_offsets[t];
+    index->posting_docs = (uint32_t *)checked_malloc((entry_count > 0 ? entry_count : 1) * sizeof(uint32_t));
+    index->posting_freqs = (uint16_t *)checked_malloc((entry_count > 0 ? entry_count : 1) * sizeof(uint16_t));
+    size_t *fill = (size_t *)checked_malloc((term_count > 0 ? term_count : 1) * sizeof(size_t));
+    memcpy(fill, index->term_offsets, term_count * sizeof(size_t));
+    for (size_t e = 0; e < entry_count; ++e) {
+        size_t at = fill[entry_terms[e]]++;
+        index->posting_docs[at] = entry_docs[e];
+        index->posting_freqs[at] = entry_freqs[e];
+    }
+    free(fill);
+    free(entry_terms);
+    free(entry_docs);
+    free(entry_freqs);
+
+    /* The best weight each term reaches in any movie bounds its share of a score. */
+    index->term_max_weight = (double *)checked_malloc((term_count > 0 ? term_count : 1) * sizeof(double));
+    for (size_t t = 0; t < term_count; ++t) {
+        double best = 0.0;
+        for (size_t p = index->term_offsets[t]; p < index->term_offsets[t + 1]; ++p) {
+            double weight = term_weight(index, index->posting_freqs[p], index->doc_lengths[index->posting_docs[p]]);
+            if (weight > best) best = weight;
+        }
+        index->term_max_weight[t] = best;
+    }
+
+    index->fields = fields;
+    index->doc_count = doc_count;
+    index->built = 1;
+    return 1;
+}
+
+typedef struct {
+    size_t pos;
+    size_t end;
+    double idf;
+    double upper; /* idf times the term's best weight */
+} TermCursor;
+
+static int compare_cursor_upper(const void *a, const void *b) {
+    double x = ((const TermCursor *)a)->upper;
+    double y = ((const TermCursor *)b)->upper;
+    return (x > y) - (x < y);
+}
+
+/* First position of cursor's list at or after doc, galloping from the current one. */
+static void cursor_seek(const FullTextIndex *index, TermCursor *cursor, uint32_t doc) {
+    size_t lo = cursor->pos;
+    size_t step = 1;
+    size_t hi = lo;
+    while (hi < cursor->end && index->posting_docs[hi] < doc) {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    if (hi > cursor->end) hi = cursor->end;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->posting_docs[mid] < doc) lo = mid + 1;
+        else hi = mid;
+    }
+    cursor->pos = lo;
+}
+
+/* Whether a ranks below b: lower score, or the same score and a later movie. */
+static int match_below(const FullTextMatch *a, const FullTextMatch *b) {
+    if (a->score != b->score) return a->score < b->score;
+    return a->movie_index > b->movie_index;
+}
+
+/* Min-heap of the k best so far; heap[0] is the one to beat. */
+static void heap_sift_down(FullTextMatch *heap, size_t count, size_t pos) {
+    FullTextMatch item = heap[pos];
+    while (1) {
+        size_t child = 2 * pos + 1;
+        if (child >= count) break;
+        if (child + 1 < count && match_below(&heap[child + 1], &heap[child])) child++;
+        if (!match_below(&heap[child], &item)) break;
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    heap[pos] = item;
+}
+
+static void heap_push(FullTextMatch *heap, size_t *count, FullTextMatch item) {
+    size_t pos = (*count)++;
+    while (pos > 0 && match_below(&item, &heap[(pos - 1) / 2])) {
+        heap[pos] = heap[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    heap[pos] = item;
+}
+
+static int compare_rank(const void *a, const void *b) {
+    const FullTextMatch *x = (const FullTextMatch *)a;
+    const FullTextMatch *y = (const FullTextMatch *)b;
+    if (match_below(y, x)) return -1;
+    if (match_below(x, y)) return 1;
+    return 0;
+}
+
+/*
+ * Document-at-a-time with MaxScore pruning: query terms are ordered by their
+ * score bound, and once the k-th best score exceeds the bounds of the
+ * weakest terms combined, a movie holding only those terms cannot make the
+ * top k. Only the remaining (essential) lists are walked; the weak ones are
+ * probed by galloping search, and only while the movie can still get in.
+ */
+int full_text_search(const FullTextIndex *index, const char *query, size_t k, FullTextMatch *out, size_t *out_count) {
+    if (out_count) *out_count = 0;
+    if (!index || !index->built || !query || !out || !out_count || k == 0) return 0;
+
+    TermCursor *cursors = NULL;
+    uint32_t *seen = NULL;
+    size_t cursor_count = 0;
+    size_t capacity = 0;
+    double documents = (double)index->doc_count;
+    char term[FULL_TEXT_TERM_MAX + 1];
+    const char *text = query;
+    while (next_term(&text, term)) {
+        uint32_t id = string_dictionary_find(&index->terms, term);
+        if (id == COLUMNS_NOT_FOUND) continue;
+        int repeated = 0;
+        for (size_t i = 0; i < cursor_count && !repeated; ++i) repeated = seen[i] == id;
+        if (repeated) continue;
+        if (cursor_count == capacity) {
+            capacity = capacity == 0 ? 8 : capacity * 2;
+            cursors = (TermCursor *)checked_realloc(cursors, capacity * sizeof(TermCursor));
+            seen = (uint32_t *)checked_realloc(seen, capacity * sizeof(uint32_t));
+        }
+        TermCursor *cursor = &cursors[cursor_count];
+        cursor->pos = index->term_offsets[id];
+        cursor->end = index->term_offsets[id + 1];
+        double frequency = (double)(cursor->end - cursor->pos);
+        cursor->idf = log(1.0 + (documents - frequency + 0.5) / (frequency + 0.5));
+        cursor->upper = cursor->idf * index->term_max_weight[id];
+        seen[cursor_count++] = id;
+    }
+    free(seen);
+    if (cursor_count == 0) {
+        free(cursors);
+        return 0;
+    }
+
+    qsort(cursors, cursor_count, sizeof(TermCursor), compare_cursor_upper);
+    double *bound_below = (double *)checked_malloc(cursor_count * sizeof(double)); /* uppers of cursors [0, i] */
+    for (size_t i = 0; i < cursor_count; ++i) bound_below[i] = cursors[i].upper + (i > 0 ? bound_below[i - 1] : 0.0);
+
+    FullTextMatch *heap = (FullTextMatch *)checked_malloc(k * sizeof(FullTextMatch));
+    size_t heap_count = 0;
+    size_t essential = 0; /* cursors below this index are only probed */
+    while (1) {
+        uint32_t doc = UINT32_MAX;
+        for (size_t i = essential; i < cursor_count; ++i) {
+            if (cursors[i].pos < cursors[i].end && index->posting_docs[cursors[i].pos] < doc) {
+                doc = index->posting_docs[cursors[i].pos];
+            }
+        }
+        if (doc == UINT32_MAX) break;
+
+        uint32_t length = index->doc_lengths[doc];
+        double score = 0.0;
+        for (size_t i = essential; i < cursor_count; ++i) {
+            TermCursor *cursor = &cursors[i];
+            if (cursor->pos < cursor->end && index->posting_docs[cursor->pos] == doc) {
+                score += cursor->idf * term_weight(index, index->posting_freqs[cursor->pos], length);
+                cursor->pos++;
+            }
+        }
+        for (size_t i = essential; i-- > 0;) {
+            if (heap_count == k && score + bound_below[i] < heap[0].score) break;
+            TermCursor *cursor = &cursors[i];
+            cursor_seek(index, cursor, doc);
+            if (cursor->pos < cursor->end && index->posting_docs[cursor->pos] == doc) {
+                score += cursor->idf * term_weight(index, index->posting_freqs[cursor->pos], length);
+            }
+        }
+
+        FullTextMatch match = {doc, score};
+        if (heap_count < k) {
+            heap_push(heap, &heap_count, match);
+        } else if (match_below(&heap[0], &match)) {
+            heap[0] = match;
+            heap_sift_down(heap, heap_count, 0);
+        } else {
+            continue;
+        }
+        if (heap_count == k) {
+            while (essential < cursor_count && bound_below[essential] < heap[0].score) essential++;
+        }
+    }
+    free(bound_below);
+    free(cursors);
+
+    qsort(heap, heap_count, sizeof(FullTextMatch), compare_rank);
+    memcpy(out, heap, heap_count * sizeof(FullTextMatch));
+    free(heap);
+    *out_count = heap_count;
+    return heap_count > 0;
+}
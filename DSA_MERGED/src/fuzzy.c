@@ -0,0 +1,519 @@
+#include "fuzzy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Longer words are left out of the vocabulary; their titles are still found through their other words. */
+#define FUZZY_WORD_MAX 64
+/* The prefix itself, every single deletion and every pair: 1 + 7 + 21. */
+#define FUZZY_MAX_VARIANTS 29
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static void *checked_realloc(void *ptr, size_t size) {
+    void *grown = realloc(ptr, size);
+    if (!grown) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+void title_fuzzy_init(TitleFuzzyIndex *fuzzy) {
+    if (!fuzzy) return;
+    fuzzy->index = NULL;
+    fuzzy->key_count = 0;
+    string_dictionary_init(&fuzzy->words);
+    arena_init(&fuzzy->arena);
+    fuzzy->word_offsets = NULL;
+    fuzzy->word_postings = NULL;
+    fuzzy->deletes = NULL;
+    fuzzy->delete_count = 0;
+    fuzzy->weights = NULL;
+    fuzzy->letters = NULL;
+}
+
+void title_fuzzy_free(TitleFuzzyIndex *fuzzy) {
+    if (!fuzzy) return;
+    string_dictionary_free(&fuzzy->words);
+    arena_free(&fuzzy->arena);
+    free(fuzzy->word_offsets);
+    free(fuzzy->word_postings);
+    free(fuzzy->deletes);
+    free(fuzzy->weights);
+    free(fuzzy->letters);
+    title_fuzzy_init(fuzzy);
+}
+
+int title_fuzzy_is_stale(const TitleFuzzyIndex *fuzzy, const TitleIndex *index) {
+    return !fuzzy || !index || fuzzy->index != index || fuzzy->key_count != index->size;
+}
+
+size_t title_fuzzy_max_distance(size_t query_len) {
+    if (query_len < 3) return 0;
+    if (query_len < 5) return 1;
+    if (query_len < 8) return 2;
+    return FUZZY_MAX_DISTANCE;
+}
+
+/* Letters, digits and every byte of a multi-byte UTF-8 sequence. */
+static int is_word_byte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+/* Next word at or after *cursor; returns 0 at the end of the text. */
+static int next_word(const char **cursor, const char **word, size_t *len) {
+    const char *p = *cursor;
+    while (*p && !is_word_byte((unsigned char)*p)) p++;
+    if (!*p) return 0;
+    const char *start = p;
+    while (*p && is_word_byte((unsigned char)*p)) p++;
+    *word = start;
+    *len = (size_t)(p - start);
+    *cursor = p;
+    return 1;
+}
+
+/*
+ * Which letters occur in text: a bit per letter, digits folded onto five bits
+ * and everything else onto the top one. An edit removes at most one letter
+ * from the set and adds at most one, so a key within d edits of a query lacks
+ * at most d of the query's letters and has at most d the query lacks.
+ */
+static uint32_t letter_mask(const char *text, size_t len) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= 'a' && c <= 'z') mask |= 1u << (c - 'a');
+        else if (c >= '0' && c <= '9') mask |= 1u << (26 + (c - '0') % 5);
+        else mask |= 1u << 31;
+    }
+    return mask;
+}
+
+static size_t popcount32(uint32_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_popcount(value);
+#else
+    size_t count = 0;
+    for (; value; value &= value - 1) count++;
+    return count;
+#endif
+}
+
+/* FNV-1a of text[0, len) with the bytes at skip_a and skip_b left out. */
+static uint32_t variant_hash(const char *text, size_t len, size_t skip_a, size_t skip_b) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        if (i == skip_a || i == skip_b) continue;
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Distinct hashes of the word's prefix with up to max_deletes bytes deleted,
+ * ascending. Variants that would be empty are skipped, so short words do not
+ * all meet under the empty string.
+ */
+static size_t prefix_variants(const char *word, size_t len, size_t max_deletes, uint32_t *hashes) {
+    size_t prefix = len < FUZZY_PREFIX_LENGTH ? len : FUZZY_PREFIX_LENGTH;
+    size_t count = 0;
+    hashes[count++] = variant_hash(word, prefix, SIZE_MAX, SIZE_MAX);
+    for (size_t i = 0; max_deletes >= 1 && prefix > 1 && i < prefix; ++i) {
+        hashes[count++] = variant_hash(word, prefix, i, SIZE_MAX);
+        for (size_t j = i + 1; max_deletes >= 2 && prefix > 2 && j < prefix; ++j) {
+            hashes[count++] = variant_hash(word, prefix, i, j);
+        }
+    }
+    qsort(hashes, count, sizeof(uint32_t), compare_u32);
+    size_t unique = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (unique == 0 || hashes[unique - 1] != hashes[i]) hashes[unique++] = hashes[i];
+    }
+    return unique;
+}
+
+/*
+ * Levenshtein distance of a and b, or bound + 1 once it is certain to exceed
+ * bound. Only the diagonal band of width 2 * bound + 1 is computed; row holds
+ * b_len + 1 entries.
+ */
+static size_t bounded_distance(const char *a, size_t a_len, const char *b, size_t b_len, size_t bound, size_t *row) {
+    size_t over = bound + 1;
+    if ((a_len > b_len ? a_len - b_len : b_len - a_len) > bound) return over;
+    for (size_t j = 0; j <= b_len; ++j) row[j] = j <= bound ? j : over;
+    for (size_t i = 1; i <= a_len; ++i) {
+        size_t lo = i > bound ? i - bound : 1;
+        size_t hi = i + bound < b_len ? i + bound : b_len;
+        size_t diagonal = row[lo - 1];
+        row[lo - 1] = (lo == 1 && i <= bound) ? i : over;
+        size_t smallest = row[lo - 1];
+        for (size_t j = lo; j <= hi; ++j) {
+            size_t up = row[j];
+            size_t value = diagonal + (a[i - 1] != b[j - 1]);
+            if (up + 1 < value) value = up + 1;
+            if (row[j - 1] + 1 < value) value = row[j - 1] + 1;
+            if (value > over) value = over;
+            diagonal = up;
+            row[j] = value;
+            if (value < smallest) smallest = value;
+        }
+        if (smallest > bound) return over;
+    }
+    return row[b_len] < over ? row[b_len] : over;
+}
+
+/* Per byte value, the positions of a pattern of up to 64 bytes holding it. */
+typedef struct {
+    uint64_t masks[256];
+    size_t length;
+} PatternMasks;
+
+static void pattern_masks_init(PatternMasks *pattern, const char *text, size_t len) {
+    memset(pattern->masks, 0, sizeof(pattern->masks));
+    for (size_t i = 0; i < len; ++i) pattern->masks[(unsigned char)text[i]] |= 1ull << i;
+    pattern->length = len;
+}
+
+/*
+ * Same result as bounded_distance for a pattern of 1 to 64 bytes, computed a
+ * column at a time with Myers' bit-parallel recurrence (in Hyyrö's form for
+ * whole-string distance), so a key costs a few word operations per byte.
+ */
+static size_t bounded_distance_bits(const PatternMasks *pattern, const char *text, size_t text_len, size_t bound) {
+    size_t over = bound + 1;
+    size_t score = pattern->length;
+    uint64_t last = 1ull << (pattern->length - 1);
+    uint64_t positive = ~0ull;
+    uint64_t negative = 0;
+    for (size_t j = 0; j < text_len; ++j) {
+        uint64_t eq = pattern->masks[(unsigned char)text[j]];
+        uint64_t xv = eq | negative;
+        uint64_t xh = (((eq & positive) + positive) ^ positive) | eq;
+        uint64_t ph = negative | ~(xh | positive);
+        uint64_t mh = positive & xh;
+        if (ph & last) score++;
+        else if (mh & last) score--;
+        /* Each remaining byte lowers the final distance by at most one. */
+        if (score > bound + (text_len - j - 1)) return over;
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        positive = mh | ~(xv | ph);
+        negative = ph & xv;
+    }
+    return score <= bound ? score : over;
+}
+
+static void push_u32(uint32_t **items, size_t *count, size_t *capacity, uint32_t value) {
+    if (*count == *capacity) {
+        *capacity = *capacity == 0 ? 64 : *capacity * 2;
+        *items = (uint32_t *)checked_realloc(*items, *capacity * sizeof(uint32_t));
+    }
+    (*items)[(*count)++] = value;
+}
+
+int title_fuzzy_build(TitleFuzzyIndex *fuzzy, const TitleIndex *index, const MovieDatabase *db) {
+    if (!fuzzy || !index || !db) return 0;
+    title_fuzzy_free(fuzzy);
+    size_t key_count = index->size;
+
+    fuzzy->weights = (int *)checked_malloc((key_count > 0 ? key_count : 1) * sizeof(int));
+    fuzzy->letters = (uint32_t *)checked_malloc((key_count > 0 ? key_count : 1) * sizeof(uint32_t));
+    uint32_t *lengths = (uint32_t *)checked_malloc((key_count > 0 ? key_count : 1) * sizeof(uint32_t));
+    size_t longest = 0;
+    for (size_t id = 0; id < key_count; ++id) {
+        const char *key = index->entries[id].key_lower ? index->entries[id].key_lower : "";
+        size_t len = strlen(key);
+        fuzzy->weights[id] = title_index_key_weight(index, id, db);
+        fuzzy->letters[id] = letter_mask(key, len);
+        lengths[id] = (uint32_t)len;
+        if (len > longest) longest = len;
+    }
+
+    /* Keys by length, then id, so every posting list below comes out in that order. */
+    size_t *by_length = (size_t *)calloc(longest + 2, sizeof(size_t));
+    uint32_t *order = (uint32_t *)checked_malloc((key_count > 0 ? key_count : 1) * sizeof(uint32_t));
+    if (!by_length) {
+        fprintf(stderr, "Error: Out of memory while building the fuzzy index\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t id = 0; id < key_count; ++id) by_length[lengths[id] + 1]++;
+    for (size_t len = 0; len <= longest; ++len) by_length[len + 1] += by_length[len];
+    for (size_t id = 0; id < key_count; ++id) order[by_length[lengths[id]]++] = (uint32_t)id;
+    free(by_length);
+
+    /* (word, key) once per distinct word of every key. */
+    uint32_t *token_words = NULL;
+    uint32_t *token_keys = NULL;
+    size_t token_count = 0;
+    size_t token_capacity = 0;
+    char scratch[FUZZY_WORD_MAX + 1];
+    for (size_t rank = 0; rank < key_count; ++rank) {
+        uint32_t id = order[rank];
+        const char *cursor = index->entries[id].key_lower ? index->entries[id].key_lower : "";
+        const char *word = NULL;
+        size_t len = 0;
+        size_t key_first = token_count;
+        while (next_word(&cursor, &word, &len)) {
+            if (len > FUZZY_WORD_MAX) continue;
+            memcpy(scratch, word, len);
+            scratch[len] = '\0';
+            size_t hash = string_dictionary_hash(scratch);
+            uint32_t word_id = string_dictionary_find_hashed(&fuzzy->words, scratch, hash);
+            if (word_id == COLUMNS_NOT_FOUND) {
+                word_id = string_dictionary_intern_hashed(&fuzzy->words, arena_strndup(&fuzzy->arena, word, len), hash);
+            }
+            int repeated = 0;
+            for (size_t t = key_first; t < token_count && !repeated; ++t) repeated = token_words[t] == word_id;
+            if (repeated) continue;
+            if (token_count == token_capacity) {
+                token_capacity = token_capacity == 0 ? 1024 : token_capacity * 2;
+                token_words = (uint32_t *)checked_realloc(token_words, token_capacity * sizeof(uint32_t));
+                token_keys = (uint32_t *)checked_realloc(token_keys, token_capacity * sizeof(uint32_t));
+            }
+            token_words[token_count] = word_id;
+            token_keys[token_count] = id;
+            token_count++;
+        }
+    }
+    free(order);
+
+    size_t word_count = fuzzy->words.count;
+    fuzzy->word_offsets = (size_t *)calloc(word_count + 1, sizeof(size_t));
+    if (!fuzzy->word_offsets) {
+        fprintf(stderr, "Error: Out of memory while building the fuzzy index\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t t = 0; t < token_count; ++t) fuzzy->word_offsets[token_words[t] + 1]++;
+    for (size_t w = 0; w < word_count; ++w) fuzzy->word_offsets[w + 1] += fuzzy->word_offsets[w];
+    fuzzy->word_postings = (uint64_t *)checked_malloc((token_count > 0 ? token_count : 1) * sizeof(uint64_t));
+    size_t *fill = (size_t *)checked_malloc((word_count > 0 ? word_count : 1) * sizeof(size_t));
+    memcpy(fill, fuzzy->word_offsets, word_count * sizeof(size_t));
+    for (size_t t = 0; t < token_count; ++t) {
+        uint32_t id = token_keys[t];
+        fuzzy->word_postings[fill[token_words[t]]++] = (uint64_t)lengths[id] << 32 | id;
+    }
+    free(fill);
+    free(token_words);
+    free(token_keys);
+    free(lengths);
+
+    /* Every word under each variant of its prefix. */
+    uint32_t hashes[FUZZY_MAX_VARIANTS];
+    size_t delete_capacity = word_count * 8 + 1;
+    fuzzy->deletes = (uint64_t *)checked_malloc(delete_capacity * sizeof(uint64_t));
+    for (size_t w = 0; w < word_count; ++w) {
+        const char *word = fuzzy->words.names[w];
+        size_t variants = prefix_variants(word, strlen(word), FUZZY_INDEX_DELETES, hashes);
+        if (fuzzy->delete_count + variants > delete_capacity) {
+            while (fuzzy->delete_count + variants > delete_capacity) delete_capacity *= 2;
+            fuzzy->deletes = (uint64_t *)checked_realloc(fuzzy->deletes, delete_capacity * sizeof(uint64_t));
+        }
+        for (size_t v = 0; v < variants; ++v) {
+            fuzzy->deletes[fuzzy->delete_count++] = (uint64_t)hashes[v] << 32 | (uint32_t)w;
+        }
+    }
+    qsort(fuzzy->deletes, fuzzy->delete_count, sizeof(uint64_t), compare_u64);
+
+    fuzzy->index = index;
+    fuzzy->key_count = key_count;
+    return 1;
+}
+
+/* First position of sorted[lo, hi) at or above key. */
+static size_t lower_bound_u64(const uint64_t *sorted, size_t lo, size_t hi, uint64_t key) {
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (sorted[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * Vocabulary words within bound of word, into *close; returns how many titles
+ * of a length in [shortest, longest] they carry.
+ */
+static size_t close_words(const TitleFuzzyIndex *fuzzy, const char *word, size_t len, size_t bound, size_t shortest, size_t longest,
+                          uint32_t **close, size_t *close_count, size_t *close_capacity, size_t **row, size_t *row_capacity) {
+    uint32_t hashes[FUZZY_MAX_VARIANTS];
+    size_t variants = prefix_variants(word, len, bound < FUZZY_INDEX_DELETES ? bound : FUZZY_INDEX_DELETES, hashes);
+    *close_count = 0;
+    for (size_t v = 0; v < variants; ++v) {
+        for (size_t pos = lower_bound_u64(fuzzy->deletes, 0, fuzzy->delete_count, (uint64_t)hashes[v] << 32);
+             pos < fuzzy->delete_count && (uint32_t)(fuzzy->deletes[pos] >> 32) == hashes[v]; ++pos) {
+            push_u32(close, close_count, close_capacity, (uint32_t)fuzzy->deletes[pos]);
+        }
+    }
+    if (*close_count > 1) qsort(*close, *close_count, sizeof(uint32_t), compare_u32);
+
+    size_t kept = 0;
+    size_t titles = 0;
+    for (size_t i = 0; i < *close_count; ++i) {
+        uint32_t word_id = (*close)[i];
+        if (kept > 0 && (*close)[kept - 1] == word_id) continue;
+        const char *candidate = fuzzy->words.names[word_id];
+        size_t candidate_len = strlen(candidate);
+        if (candidate_len + 1 > *row_capacity) {
+            *row_capacity = candidate_len + 1;
+            *row = (size_t *)checked_realloc(*row, *row_capacity * sizeof(size_t));
+        }
+        if (bounded_distance(word, len, candidate, candidate_len, bound, *row) > bound) continue;
+        (*close)[kept++] = word_id;
+        size_t first = fuzzy->word_offsets[word_id];
+        size_t last = fuzzy->word_offsets[word_id + 1];
+        titles += lower_bound_u64(fuzzy->word_postings, first, last, (uint64_t)(longest + 1) << 32) -
+                  lower_bound_u64(fuzzy->word_postings, first, last, (uint64_t)shortest << 32);
+    }
+    *close_count = kept;
+    return titles;
+}
+
+typedef struct {
+    uint32_t distance;
+    int weight;
+    const char *key;
+    uint32_t key_id;
+} FuzzyCandidate;
+
+static int compare_candidates(const void *a, const void *b) {
+    const FuzzyCandidate *x = (const FuzzyCandidate *)a;
+    const FuzzyCandidate *y = (const FuzzyCandidate *)b;
+    if (x->distance != y->distance) return x->distance < y->distance ? -1 : 1;
+    if (x->weight != y->weight) return x->weight > y->weight ? -1 : 1;
+    return strcmp(x->key, y->key);
+}
+
+int title_fuzzy_search(const TitleFuzzyIndex *fuzzy, const char *query_lower, size_t k, TitleFuzzyMatch *out, size_t *out_count) {
+    if (out_count) *out_count = 0;
+    if (!fuzzy || !fuzzy->index || !query_lower || !out || !out_count || k == 0) return 0;
+    const TitleIndex *index = fuzzy->index;
+    size_t query_len = strlen(query_lower);
+    size_t max_distance = title_fuzzy_max_distance(query_len);
+    size_t shortest = query_len > max_distance ? query_len - max_distance : 0;
+
+    /*
+     * The query word whose close words carry the fewest titles picks the
+     * candidates. Words too short to tolerate a typo are only used when the
+     * query has nothing else: a mistyped "th" or "te" would match the wrong
+     * word exactly and hide the title it came from.
+     */
+    uint32_t *close = NULL;
+    size_t close_count = 0;
+    size_t close_capacity = 0;
+    uint32_t *best = NULL;
+    size_t best_count = 0;
+    size_t best_capacity = 0;
+    size_t best_titles = 0;
+    size_t best_bound = 0;
+    size_t *row = NULL;
+    size_t row_capacity = 0;
+    const char *cursor = query_lower;
+    const char *word = NULL;
+    size_t len = 0;
+    while (next_word(&cursor, &word, &len)) {
+        if (len > FUZZY_WORD_MAX) continue;
+        size_t bound = title_fuzzy_max_distance(len);
+        if (bound > max_distance) bound = max_distance;
+        size_t titles = close_words(fuzzy, word, len, bound, shortest, query_len + max_distance, &close, &close_count, &close_capacity, &row, &row_capacity);
+        if (titles == 0 || (bound == 0 && best_bound > 0)) continue;
+        if (best_titles > 0 && titles >= best_titles && (bound > 0) == (best_bound > 0)) continue;
+        uint32_t *swap = best;
+        best = close;
+        close = swap;
+        size_t swap_capacity = best_capacity;
+        best_capacity = close_capacity;
+        close_capacity = swap_capacity;
+        best_count = close_count;
+        best_titles = titles;
+        best_bound = bound;
+    }
+    free(close);
+    if (best_titles == 0) {
+        free(best);
+        free(row);
+        return 0;
+    }
+
+    /*
+     * Only keys of a length within max_distance are visited, and the letter
+     * check drops most of those without touching their text. Postings of
+     * different close words may overlap, so a key can be matched twice; the
+     * copies sort next to each other and are skipped below.
+     */
+    uint32_t query_letters = letter_mask(query_lower, query_len);
+    PatternMasks pattern;
+    int use_bits = query_len >= 1 && query_len <= 64;
+    if (use_bits) pattern_masks_init(&pattern, query_lower, query_len);
+    FuzzyCandidate *matches = NULL;
+    size_t match_count = 0;
+    size_t match_capacity = 0;
+    for (size_t b = 0; b < best_count; ++b) {
+        size_t last = fuzzy->word_offsets[best[b] + 1];
+        for (size_t p = lower_bound_u64(fuzzy->word_postings, fuzzy->word_offsets[best[b]], last, (uint64_t)shortest << 32);
+             p < last; ++p) {
+            size_t key_len = (size_t)(fuzzy->word_postings[p] >> 32);
+            if (key_len > query_len + max_distance) break;
+            uint32_t key_id = (uint32_t)fuzzy->word_postings[p];
+            uint32_t key_letters = fuzzy->letters[key_id];
+            if (popcount32(query_letters & ~key_letters) > max_distance || popcount32(key_letters & ~query_letters) > max_distance) continue;
+            const char *key = index->entries[key_id].key_lower;
+            size_t distance;
+            if (use_bits) {
+                distance = bounded_distance_bits(&pattern, key, key_len, max_distance);
+            } else {
+                if (key_len + 1 > row_capacity) {
+                    row_capacity = key_len + 1;
+                    row = (size_t *)checked_realloc(row, row_capacity * sizeof(size_t));
+                }
+                distance = bounded_distance(query_lower, query_len, key, key_len, max_distance, row);
+            }
+            if (distance > max_distance) continue;
+            if (match_count == match_capacity) {
+                match_capacity = match_capacity == 0 ? 16 : match_capacity * 2;
+                matches = (FuzzyCandidate *)checked_realloc(matches, match_capacity * sizeof(FuzzyCandidate));
+            }
+            FuzzyCandidate *match = &matches[match_count++];
+            match->distance = (uint32_t)distance;
+            match->weight = fuzzy->weights[key_id];
+            match->key = key;
+            match->key_id = key_id;
+        }
+    }
+    free(best);
+    free(row);
+
+    if (match_count > 1) qsort(matches, match_count, sizeof(FuzzyCandidate), compare_candidates);
+    size_t shown = 0;
+    for (size_t i = 0; i < match_count && shown < k; ++i) {
+        if (i > 0 && matches[i].key_id == matches[i - 1].key_id) continue;
+        out[shown].key_id = matches[i].key_id;
+        out[shown].distance = matches[i].distance;
+        shown++;
+    }
+    free(matches);
+    *out_count = shown;
+    return shown > 0;
+}
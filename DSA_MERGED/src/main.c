@@ -1,16 +1,34 @@
-#include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "autocomplete.h"
+#include "casefold.h"
+#include "cursor.h"
+#include "fulltext.h"
+#include "fuzzy.h"
 #include "history.h"
 #include "movie.h"
+#include "neighbors.h"
+#include "parallel.h"
 #include "recommendation.h"
 #include "reco_tree.h"
+#include "result_cache.h"
 #include "search.h"
+#include "snapshot.h"
+#include "substring.h"
 #include "watchlist.h"
 
 #define INPUT_BUFFER 512
+#define RESULTS_SHOWN 25
+#define CACHE_MODE_YEARS 100 /* result cache mode of year searches; text searches use their SearchKind */
+#define AUTOCOMPLETE_SHOWN 10
+#define FUZZY_SHOWN 10
+#define PLOT_RESULTS 25
+#define PLOT_FIELDS (FULL_TEXT_DESCRIPTION | FULL_TEXT_TITLE)
+#define NEAREST_YEAR_RESULTS 25
+#define RECENT_FEED_PAGE 25
 #define DEFAULT_DATASET "data/netflix_titles_nov_2019.csv"
 
 static void trim_newline(char *s) {
@@ -21,13 +39,6 @@ static void trim_newline(char *s) {
     }
 }
 
-static void to_lower_inplace(char *s) {
-    if (!s) return;
-    for (; *s; ++s) {
-        *s = (char)tolower((unsigned char)*s);
-    }
-}
-
 static void press_enter_to_continue(void) {
     printf("\nPress Enter to continue...");
     char buffer[INPUT_BUFFER];
@@ -114,17 +125,15 @@ static void prompt_add_to_watchlist(const MovieDatabase *db,
 static int g_has_last_viewed = 0;
 static size_t g_last_viewed_index = 0;
 
-static void show_search_results(const MovieDatabase *db,
-                                WatchlistManager *watchlists,
-                                SearchHistory *history,
-                                const size_t *indices,
-                                size_t count) {
-    if (!db || !indices || count == 0) {
-        printf("No matches found.\n");
-        return;
-    }
-    size_t display = count > 25 ? 25 : count;
-    printf("\nFound %zu match(es). Showing first %zu:\n", count, display);
+/* List the first page of a search and let the user open one; total may be an estimate. */
+static void show_result_page(const MovieDatabase *db,
+                             WatchlistManager *watchlists,
+                             SearchHistory *history,
+                             const size_t *indices,
+                             size_t display,
+                             size_t total,
+                             int exact) {
+    printf("\nFound %s%zu match(es). Showing first %zu:\n", exact ? "" : "~", total, display);
     for (size_t i = 0; i < display; ++i) {
         size_t idx = indices[i];
         if (idx >= db->count) continue;
@@ -164,13 +173,297 @@ static void show_search_results(const MovieDatabase *db,
     }
 }
 
+static void show_search_results(const MovieDatabase *db,
+                                WatchlistManager *watchlists,
+                                SearchHistory *history,
+                                const size_t *indices,
+                                size_t count) {
+    if (!db || !indices || count == 0) {
+        printf("No matches found.\n");
+        return;
+    }
+    show_result_page(db, watchlists, history, indices, count > RESULTS_SHOWN ? RESULTS_SHOWN : count, count, 1);
+}
+
+/* A first page of results, as the search menu shows it and the result cache keeps it. */
+typedef struct {
+    size_t indices[RESULTS_SHOWN];
+    size_t count;
+    size_t total; /* an estimate unless exact */
+    int exact;
+} ResultPage;
+
+static void read_cursor_page(SearchCursor *cursor, ResultPage *page) {
+    page->count = search_cursor_next(cursor, page->indices, RESULTS_SHOWN);
+    page->exact = 1;
+    page->total = page->count > 0 ? search_cursor_estimate(cursor, &page->exact) : 0;
+}
+
+/* "1995", "1990-1999" or "2015-" (open-ended); returns 0 when text is none of them. */
+static int parse_year_range(const char *text, long *from, long *to, int *range) {
+    char *endptr = NULL;
+    *from = strtol(text, &endptr, 10);
+    *to = *from;
+    *range = *endptr == '-';
+    if (*range) {
+        char *rest = endptr + 1;
+        *to = strtol(rest, &endptr, 10);
+        if (endptr == rest) *to = INT_MAX;
+    }
+    return endptr != text && *from > 0 && *to >= *from && *to <= INT_MAX && *endptr == '\0';
+}
+
+/* First page of a normalized query: from the cache while the catalog is unchanged, else through a cursor. */
+static void cached_search(const MovieDatabase *db,
+                          const TitleIndex *index,
+                          ResultCache *cache,
+                          int mode,
+                          const char *query,
+                          ResultPage *page) {
+    const ResultCacheEntry *entry = result_cache_get(cache, db->generation, mode, query);
+    if (entry) {
+        page->count = entry->count < RESULTS_SHOWN ? entry->count : RESULTS_SHOWN;
+        if (page->count > 0) memcpy(page->indices, entry->indices, page->count * sizeof(size_t));
+        page->total = entry->total;
+        page->exact = entry->exact;
+        return;
+    }
+    SearchCursor cursor;
+    search_cursor_init(&cursor);
+    int opened = 0;
+    if (mode == CACHE_MODE_YEARS) {
+        long from = 0;
+        long to = 0;
+        int range = 0;
+        opened = parse_year_range(query, &from, &to, &range) && search_cursor_open_years(&cursor, db, (int)from, (int)to);
+    } else {
+        opened = search_cursor_open(&cursor, db, index, (SearchKind)mode, query);
+    }
+    page->count = 0;
+    page->total = 0;
+    page->exact = 1;
+    if (opened) read_cursor_page(&cursor, page);
+    search_cursor_close(&cursor);
+    result_cache_put(cache, db->generation, mode, query, page->indices, page->count, page->total, page->exact);
+}
+
+/* Run one search and show its first page; returns 0 when nothing matched. */
+static int show_cached_search(const MovieDatabase *db,
+                              const TitleIndex *index,
+                              ResultCache *cache,
+                              int mode,
+                              const char *query,
+                              WatchlistManager *watchlists,
+                              SearchHistory *history) {
+    ResultPage page;
+    cached_search(db, index, cache, mode, query, &page);
+    if (page.count == 0) return 0;
+    show_result_page(db, watchlists, history, page.indices, page.count, page.total, page.exact);
+    return 1;
+}
+
+/* Replays a recorded search into the history and the cache, see --history-file. */
+typedef struct {
+    const MovieDatabase *db;
+    const TitleIndex *index;
+    ResultCache *cache;
+    SearchHistory *history;
+    size_t replayed;
+} CacheWarmup;
+
+static void warm_cache(void *ctx, int mode, const char *query) {
+    CacheWarmup *warmup = (CacheWarmup *)ctx;
+    if (mode != CACHE_MODE_YEARS && (mode < SEARCH_TITLE || mode > SEARCH_GENRE_PARTIAL)) return;
+    char normalized[INPUT_BUFFER];
+    if (result_cache_normalize(query, normalized, sizeof(normalized)) == 0) return;
+    ResultPage page;
+    cached_search(warmup->db, warmup->index, warmup->cache, mode, normalized, &page);
+    history_record(warmup->history, normalized);
+    warmup->replayed++;
+}
+
+/* Reads one folded line; returns 0 on end of input. A blank line leaves the criterion out. */
+static int prompt_criterion(const char *prompt, char *out, size_t size) {
+    printf("%s", prompt);
+    if (!fgets(out, (int)size, stdin)) return 0;
+    trim_newline(out);
+    casefold_inplace(out, CASEFOLD_KEYS);
+    return 1;
+}
+
+static void combined_search(const MovieDatabase *db,
+                            TitleIndex *index,
+                            SearchHistory *history,
+                            WatchlistManager *watchlists) {
+    char title[INPUT_BUFFER];
+    char director[INPUT_BUFFER];
+    char genre[INPUT_BUFFER];
+    char exclude[INPUT_BUFFER];
+    char years[INPUT_BUFFER];
+    printf("Leave a field blank to skip it.\n");
+    if (!prompt_criterion("Title contains: ", title, sizeof(title))) return;
+    if (!prompt_criterion("Director contains: ", director, sizeof(director))) return;
+    if (!prompt_criterion("Genre contains: ", genre, sizeof(genre))) return;
+    if (!prompt_criterion("Exclude genre containing: ", exclude, sizeof(exclude))) return;
+    if (!prompt_criterion("Release years (e.g. 2015, 2010-2015, 2015-): ", years, sizeof(years))) return;
+
+    SearchQuery query;
+    search_query_init(&query);
+    query.title_substr_lower = title;
+    query.director_substr_lower = director;
+    query.genre_substr_lower = genre;
+    query.exclude_genre_substr_lower = exclude;
+    if (years[0] != '\0') {
+        long from = 0;
+        long to = 0;
+        int range = 0;
+        if (!parse_year_range(years, &from, &to, &range)) {
+            printf("Invalid year range.\n");
+            return;
+        }
+        query.year_from = (int)from;
+        query.year_to = (int)to;
+    }
+    if (title[0] == '\0' && director[0] == '\0' && genre[0] == '\0' && exclude[0] == '\0' && years[0] == '\0') {
+        printf("No criteria given.\n");
+        return;
+    }
+    if (title[0] != '\0') history_record(history, title);
+
+    ResultSet results;
+    result_set_init(&results);
+    SearchCursor cursor;
+    search_cursor_init(&cursor);
+    ResultPage page;
+    page.count = 0;
+    if (search_query_run(db, index, &query, &results) && search_cursor_open_set(&cursor, &results)) {
+        read_cursor_page(&cursor, &page);
+    }
+    search_cursor_close(&cursor);
+    if (page.count > 0) {
+        show_result_page(db, watchlists, history, page.indices, page.count, page.total, page.exact);
+    } else {
+        printf("No movies match all of the criteria.\n");
+    }
+    result_set_free(&results);
+}
+
+/* Type a prefix, see the best-ranked titles starting with it, refine or pick one. */
+static void autocomplete_search(const MovieDatabase *db,
+                                TitleIndex *index,
+                                TitleAutocomplete *completions,
+                                SearchHistory *history,
+                                WatchlistManager *watchlists) {
+    if (title_autocomplete_is_stale(completions, index) && !title_autocomplete_build(completions, index, db)) {
+        printf("Failed to build title completions.\n");
+        return;
+    }
+    uint32_t keys[AUTOCOMPLETE_SHOWN];
+    size_t shown = 0;
+    char line[INPUT_BUFFER];
+    printf("Start typing a title: ");
+    while (fgets(line, sizeof(line), stdin)) {
+        trim_newline(line);
+        if (line[0] == '\0') return;
+        char *endptr = NULL;
+        long choice = strtol(line, &endptr, 10);
+        if (shown > 0 && *endptr == '\0' && choice > 0 && (size_t)choice <= shown) {
+            const TitleIndexEntry *entry = &index->entries[keys[choice - 1]];
+            history_record(history, db->movies[entry->indices[0]].title);
+            show_search_results(db, watchlists, history, entry->indices, entry->count);
+            return;
+        }
+        casefold_inplace(line, CASEFOLD_KEYS);
+        if (!title_autocomplete(completions, line, AUTOCOMPLETE_SHOWN, keys, &shown)) {
+            printf("No titles start with '%s'. Type another start: ", line);
+            continue;
+        }
+        for (size_t i = 0; i < shown; ++i) {
+            const TitleIndexEntry *entry = &index->entries[keys[i]];
+            const Movie *movie = &db->movies[entry->indices[0]];
+            printf("%2zu) %s (%s)%s\n", i + 1,
+                   movie->title ? movie->title : entry->key_lower,
+                   movie->release_year ? movie->release_year : "n/a",
+                   entry->count > 1 ? " and others with this title" : "");
+        }
+        printf("Enter a number to open a title, a longer start to refine, or press Enter to return: ");
+    }
+}
+
+/* Offer the titles closest to a query that found nothing; returns 0 when none is close enough. */
+static int suggest_titles(const MovieDatabase *db,
+                          TitleIndex *index,
+                          TitleFuzzyIndex *fuzzy,
+                          const char *query_lower,
+                          SearchHistory *history,
+                          WatchlistManager *watchlists) {
+    if (title_fuzzy_is_stale(fuzzy, index) && !title_fuzzy_build(fuzzy, index, db)) return 0;
+    TitleFuzzyMatch matches[FUZZY_SHOWN];
+    size_t shown = 0;
+    if (!title_fuzzy_search(fuzzy, query_lower, FUZZY_SHOWN, matches, &shown)) return 0;
+    printf("Did you mean:\n");
+    for (size_t i = 0; i < shown; ++i) {
+        const TitleIndexEntry *entry = &index->entries[matches[i].key_id];
+        const Movie *movie = &db->movies[entry->indices[0]];
+        printf("%2zu) %s (%s)%s\n", i + 1,
+               movie->title ? movie->title : entry->key_lower,
+               movie->release_year ? movie->release_year : "n/a",
+               entry->count > 1 ? " and others with this title" : "");
+    }
+    printf("Enter a number to open a title, or press Enter to return: ");
+    char line[INPUT_BUFFER];
+    if (!fgets(line, sizeof(line), stdin)) return 1;
+    trim_newline(line);
+    char *endptr = NULL;
+    long choice = strtol(line, &endptr, 10);
+    if (line[0] != '\0' && *endptr == '\0' && choice > 0 && (size_t)choice <= shown) {
+        const TitleIndexEntry *entry = &index->entries[matches[choice - 1].key_id];
+        history_record(history, db->movies[entry->indices[0]].title);
+        show_search_results(db, watchlists, history, entry->indices, entry->count);
+    }
+    return 1;
+}
+
+/* Rank movies by how well their description and title match some keywords. */
+static void plot_search(const MovieDatabase *db,
+                        FullTextIndex *plots,
+                        SearchHistory *history,
+                        WatchlistManager *watchlists) {
+    char query[INPUT_BUFFER];
+    printf("Enter plot keywords: ");
+    if (!fgets(query, sizeof(query), stdin)) return;
+    trim_newline(query);
+    if (query[0] == '\0') return;
+    history_record(history, query);
+    if (full_text_index_is_stale(plots, db, PLOT_FIELDS)) {
+        printf("Indexing descriptions...\n");
+        if (!full_text_index_build(plots, db, PLOT_FIELDS)) {
+            printf("Could not index descriptions.\n");
+            return;
+        }
+    }
+    FullTextMatch matches[PLOT_RESULTS];
+    size_t found = 0;
+    if (!full_text_search(plots, query, PLOT_RESULTS, matches, &found)) {
+        printf("No movies match '%s'.\n", query);
+        return;
+    }
+    size_t indices[PLOT_RESULTS];
+    for (size_t i = 0; i < found; ++i) indices[i] = matches[i].movie_index;
+    show_search_results(db, watchlists, history, indices, found);
+}
+
 static void search_menu(const MovieDatabase *db,
                         TitleIndex *index,
+                        TitleAutocomplete *completions,
+                        TitleFuzzyIndex *fuzzy,
+                        FullTextIndex *plots,
+                        ResultCache *cache,
                         SearchHistory *history,
                         WatchlistManager *watchlists,
                         RecommendationTree *reco) {
     (void)reco; /* recommendations shown only via menu, not here */
-    if (!db || !index || !history || !watchlists) return;
+    if (!db || !index || !completions || !fuzzy || !plots || !cache || !history || !watchlists) return;
     char buffer[INPUT_BUFFER];
     while (1) {
         printf("\n--- Search Menu ---\n");
@@ -178,12 +471,16 @@ static void search_menu(const MovieDatabase *db,
         printf(" 2) Partial title search\n");
         printf(" 3) Search by director\n");
         printf(" 4) Search by genre (examples: drama, comedy, thriller, horror, action, romance, documentary, kids, anime)\n");
-        printf(" 5) Search by release year\n");
-        printf(" 6) Back to main menu\n");
+        printf(" 5) Search by release year or range\n");
+        printf(" 6) Search by cast member\n");
+        printf(" 7) Combined search (title, director, genre, year)\n");
+        printf(" 8) Title autocomplete\n");
+        printf(" 9) Search by plot keywords\n");
+        printf(" 0) Back to main menu\n");
         printf("Choose: ");
         if (!fgets(buffer, sizeof(buffer), stdin)) return;
         trim_newline(buffer);
-        if (buffer[0] == '6' || buffer[0] == '\0') return;
+        if (buffer[0] == '0' || buffer[0] == '\0') return;
 
         size_t *indices = NULL;
         size_t count = 0;
@@ -198,13 +495,9 @@ static void search_menu(const MovieDatabase *db,
                 history_record(history, query);
                 {
                     char lowered[INPUT_BUFFER];
-                    strncpy(lowered, query, sizeof(lowered));
-                    lowered[sizeof(lowered) - 1] = '\0';
-                    to_lower_inplace(lowered);
-                    if (title_index_lookup(index, lowered, &indices, &count)) {
-                        show_search_results(db, watchlists, history, indices, count);
-                        free(indices);
-                    } else {
+                    result_cache_normalize(query, lowered, sizeof(lowered));
+                    if (!show_cached_search(db, index, cache, SEARCH_TITLE, lowered, watchlists, history) &&
+                        !suggest_titles(db, index, fuzzy, lowered, history, watchlists)) {
                         printf("No exact matches for '%s'.\n", query);
                     }
                 }
@@ -217,13 +510,9 @@ static void search_menu(const MovieDatabase *db,
                 history_record(history, query);
                 {
                     char lowered[INPUT_BUFFER];
-                    strncpy(lowered, query, sizeof(lowered));
-                    lowered[sizeof(lowered) - 1] = '\0';
-                    to_lower_inplace(lowered);
-                    if (title_index_partial_search(index, lowered, &indices, &count)) {
-                        show_search_results(db, watchlists, history, indices, count);
-                        free(indices);
-                    } else {
+                    result_cache_normalize(query, lowered, sizeof(lowered));
+                    if (!show_cached_search(db, index, cache, SEARCH_TITLE_PARTIAL, lowered, watchlists, history) &&
+                        !suggest_titles(db, index, fuzzy, lowered, history, watchlists)) {
                         printf("No partial matches for '%s'.\n", query);
                     }
                 }
@@ -236,13 +525,8 @@ static void search_menu(const MovieDatabase *db,
                 history_record(history, query);
                 {
                     char lowered[INPUT_BUFFER];
-                    strncpy(lowered, query, sizeof(lowered));
-                    lowered[sizeof(lowered) - 1] = '\0';
-                    to_lower_inplace(lowered);
-                    if (search_by_director_partial(db, lowered, &indices, &count)) {
-                        show_search_results(db, watchlists, history, indices, count);
-                        free(indices);
-                    } else {
+                    result_cache_normalize(query, lowered, sizeof(lowered));
+                    if (!show_cached_search(db, index, cache, SEARCH_DIRECTOR_PARTIAL, lowered, watchlists, history)) {
                         printf("No matches for director '%s'.\n", query);
                     }
                 }
@@ -255,38 +539,61 @@ static void search_menu(const MovieDatabase *db,
                 history_record(history, query);
                 {
                     char lowered[INPUT_BUFFER];
-                    strncpy(lowered, query, sizeof(lowered));
-                    lowered[sizeof(lowered) - 1] = '\0';
-                    to_lower_inplace(lowered);
-                    if (search_by_genre_partial(db, lowered, &indices, &count)) {
-                        show_search_results(db, watchlists, history, indices, count);
-                        free(indices);
-                    } else {
+                    result_cache_normalize(query, lowered, sizeof(lowered));
+                    if (!show_cached_search(db, index, cache, SEARCH_GENRE_PARTIAL, lowered, watchlists, history)) {
                         printf("No matches for genre '%s'.\n", query);
                     }
                 }
                 break;
             case '5':
-                printf("Enter release year: ");
+                printf("Enter release year or range (e.g. 1995, 1990-1999, 2015-): ");
                 if (!fgets(query, sizeof(query), stdin)) break;
                 trim_newline(query);
                 if (query[0] == '\0') break;
                 history_record(history, query);
                 {
-                    char *endptr = NULL;
-                    long year = strtol(query, &endptr, 10);
-                    if (endptr == query || year <= 0) {
+                    char normalized[INPUT_BUFFER];
+                    result_cache_normalize(query, normalized, sizeof(normalized));
+                    long from = 0;
+                    long to = 0;
+                    int range = 0;
+                    if (!parse_year_range(normalized, &from, &to, &range)) {
                         printf("Invalid year.\n");
                         break;
                     }
-                    if (search_by_release_year(db, (int)year, &indices, &count)) {
+                    if (show_cached_search(db, index, cache, CACHE_MODE_YEARS, normalized, watchlists, history)) break;
+                    if (!range && search_by_nearest_year(db, (int)from, NEAREST_YEAR_RESULTS, &indices, &count)) {
+                        printf("No matches for year %ld; showing the closest years instead.\n", from);
                         show_search_results(db, watchlists, history, indices, count);
                         free(indices);
                     } else {
-                        printf("No matches for year %ld.\n", year);
+                        printf("No matches for '%s'.\n", query);
+                    }
+                }
+                break;
+            case '6':
+                printf("Enter cast member name: ");
+                if (!fgets(query, sizeof(query), stdin)) break;
+                trim_newline(query);
+                if (query[0] == '\0') break;
+                history_record(history, query);
+                {
+                    char lowered[INPUT_BUFFER];
+                    result_cache_normalize(query, lowered, sizeof(lowered));
+                    if (!show_cached_search(db, index, cache, SEARCH_CAST_PARTIAL, lowered, watchlists, history)) {
+                        printf("No matches for cast member '%s'.\n", query);
                     }
                 }
                 break;
+            case '7':
+                combined_search(db, index, history, watchlists);
+                break;
+            case '8':
+                autocomplete_search(db, index, completions, history, watchlists);
+                break;
+            case '9':
+                plot_search(db, plots, history, watchlists);
+                break;
             default:
                 printf("Invalid option.\n");
                 break;
@@ -432,7 +739,9 @@ static void watchlist_menu(WatchlistManager *watchlists, const MovieDatabase *db
 static void recommendation_menu(const MovieDatabase *db,
                                 TitleIndex *index,
                                 WatchlistManager *watchlists,
-                                RecommendationTree *reco) {
+                                RecommendationTree *reco,
+                                const NeighborGraph *neighbors,
+                                size_t threads) {
     if (!db || !index || !reco) return;
     (void)watchlists; /* currently unused in this menu */
     char buffer[INPUT_BUFFER];
@@ -440,7 +749,7 @@ static void recommendation_menu(const MovieDatabase *db,
     if (!splay_root(&reco->tree)) {
         if (g_has_last_viewed) {
             /* Build from last viewed automatically */
-            if (!reco_tree_update_from_source(reco, db, g_last_viewed_index, 20)) {
+            if (!reco_tree_update_from_source(reco, db, neighbors, g_last_viewed_index, NEIGHBOR_GRAPH_DEFAULT_K, threads)) {
                 printf("No recommendations yet. View a movie from search first.\n");
                 return;
             }
@@ -485,12 +794,70 @@ static void recommendation_menu(const MovieDatabase *db,
     }
 }
 
-static int reload_dataset(MovieDatabase *db, TitleIndex *index, const char *path) {
-    if (!db || !index || !path) return 0;
+/* Newest additions to the catalog, a page at a time, or everything added in the last N days. */
+static void recently_added_menu(const MovieDatabase *db, WatchlistManager *watchlists, SearchHistory *history) {
+    char buffer[INPUT_BUFFER];
+    printf("Show titles added in the last how many days? (Enter for the newest %d): ", RECENT_FEED_PAGE);
+    if (!fgets(buffer, sizeof(buffer), stdin)) return;
+    trim_newline(buffer);
+
+    size_t *indices = NULL;
+    size_t count = 0;
+    if (buffer[0] != '\0') {
+        char *endptr = NULL;
+        long days = strtol(buffer, &endptr, 10);
+        if (endptr == buffer || *endptr != '\0' || days <= 0 || days > INT_MAX) {
+            printf("Invalid number of days.\n");
+            return;
+        }
+        if (search_added_within_days(db, (int)days, &indices, &count)) {
+            show_search_results(db, watchlists, history, indices, count);
+            free(indices);
+        } else {
+            printf("No titles with a known date added.\n");
+        }
+        return;
+    }
+
+    size_t offset = 0;
+    while (search_recently_added(db, offset, RECENT_FEED_PAGE, &indices, &count)) {
+        const Movie *newest = &db->movies[indices[0]];
+        printf("\nAdded on or before %s:", newest->date_added ? newest->date_added : "n/a");
+        show_search_results(db, watchlists, history, indices, count);
+        free(indices);
+        offset += count;
+        printf("Show older additions? (y/n): ");
+        if (!fgets(buffer, sizeof(buffer), stdin)) return;
+        trim_newline(buffer);
+        if (buffer[0] != 'y' && buffer[0] != 'Y') return;
+    }
+    if (offset == 0) printf("No titles with a known date added.\n");
+}
+
+typedef struct {
+    size_t threads;
+    const char *snapshot_in;  /* snapshot to try before parsing the CSV, or NULL */
+    const char *snapshot_out; /* where to save the catalog after parsing the CSV, or NULL */
+    const char *history_file; /* searches to replay into the result cache at startup, saved at exit; or NULL */
+    const char *neighbors_in;  /* precomputed recommendations to serve from, or NULL */
+    const char *neighbors_out; /* build the recommendation graph, save it here and exit; or NULL */
+} DatasetOptions;
+
+static int reload_dataset(MovieDatabase *db, TitleIndex *index, const char *path, const DatasetOptions *options) {
+    if (!db || !index || !path || !options) return 0;
     movie_db_free(db);
     movie_db_init(db);
     char *error = NULL;
-    if (!movie_db_load_from_csv(db, path, &error)) {
+    if (options->snapshot_in) {
+        if (snapshot_load(options->snapshot_in, path, db, index, &error)) {
+            printf("Loaded catalog snapshot %s\n", options->snapshot_in);
+            return 1;
+        }
+        fprintf(stderr, "%s; loading %s instead.\n", error ? error : "Snapshot unavailable", path);
+        free(error);
+        error = NULL;
+    }
+    if (!movie_db_load_from_csv_parallel(db, path, options->threads, &error)) {
         if (error) {
             fprintf(stderr, "%s\n", error);
             free(error);
@@ -499,27 +866,107 @@ static int reload_dataset(MovieDatabase *db, TitleIndex *index, const char *path
         }
         return 0;
     }
-    if (!title_index_build(index, db)) {
+    if (!title_index_build_parallel(index, db, options->threads)) {
         fprintf(stderr, "Failed to build search index.\n");
         return 0;
     }
+    if (options->snapshot_out) {
+        if (!snapshot_write(options->snapshot_out, db, index, path, &error)) {
+            fprintf(stderr, "%s\n", error ? error : "Failed to write snapshot");
+            free(error);
+        }
+    }
     return 1;
 }
 
+/* Add the rows of a delta CSV to the loaded catalog without rebuilding it. */
+static int append_dataset(MovieDatabase *db, TitleIndex *index, const char *path) {
+    size_t first = 0;
+    char *error = NULL;
+    if (!movie_db_append_from_csv(db, path, &first, &error)) {
+        fprintf(stderr, "%s\n", error ? error : "Failed to append titles");
+        free(error);
+    }
+    if (db->count == first) return 0;
+    if (!title_index_append(index, db, first)) {
+        fprintf(stderr, "Failed to update search index.\n");
+        return 0;
+    }
+    printf("Added %zu movie entries from %s (%zu total)\n", db->count - first, path, db->count);
+    return 1;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--threads N] [--snapshot-in FILE] [--snapshot-out FILE] [--history-file FILE] [--neighbors FILE] [--build-neighbors FILE] [--append FILE]... [dataset.csv]\n", program);
+    fprintf(stderr, "  --threads N          parse the dataset, build the title index and score recommendations on N threads (0 = one per CPU)\n");
+    fprintf(stderr, "  --snapshot-in FILE   start from a catalog snapshot; the CSV is parsed if it is missing or stale\n");
+    fprintf(stderr, "  --snapshot-out FILE  save a snapshot of the catalog after parsing the CSV\n");
+    fprintf(stderr, "  --history-file FILE  re-run the searches saved in FILE to warm the result cache, and save them there at exit\n");
+    fprintf(stderr, "  --neighbors FILE     serve recommendations from a graph saved by --build-neighbors for this catalog\n");
+    fprintf(stderr, "  --build-neighbors FILE  rank every movie's recommendations on --threads threads, save them to FILE and exit\n");
+    fprintf(stderr, "  --append FILE        add the titles of another CSV file after loading (repeatable)\n");
+}
+
 int main(int argc, char **argv) {
-    const char *dataset_path = (argc >= 2) ? argv[1] : DEFAULT_DATASET;
+    const char *dataset_path = DEFAULT_DATASET;
+    DatasetOptions options = {1, NULL, NULL, NULL, NULL, NULL};
+    const char **append_paths = (const char **)malloc((size_t)argc * sizeof(const char *));
+    size_t append_count = 0;
+    if (!append_paths) return 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            char *endptr = NULL;
+            long threads = strtol(argv[++i], &endptr, 10);
+            if (endptr == argv[i] || threads < 0 || threads > 256) {
+                fprintf(stderr, "Invalid thread count: %s\n", argv[i]);
+                return 1;
+            }
+            options.threads = threads == 0 ? parallel_cpu_count() : (size_t)threads;
+        } else if (strcmp(argv[i], "--snapshot-in") == 0 && i + 1 < argc) {
+            options.snapshot_in = argv[++i];
+        } else if (strcmp(argv[i], "--snapshot-out") == 0 && i + 1 < argc) {
+            options.snapshot_out = argv[++i];
+        } else if (strcmp(argv[i], "--history-file") == 0 && i + 1 < argc) {
+            options.history_file = argv[++i];
+        } else if (strcmp(argv[i], "--neighbors") == 0 && i + 1 < argc) {
+            options.neighbors_in = argv[++i];
+        } else if (strcmp(argv[i], "--build-neighbors") == 0 && i + 1 < argc) {
+            options.neighbors_out = argv[++i];
+        } else if (strcmp(argv[i], "--append") == 0 && i + 1 < argc) {
+            append_paths[append_count++] = argv[++i];
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            print_usage(argv[0]);
+            free(append_paths);
+            return 1;
+        } else {
+            dataset_path = argv[i];
+        }
+    }
+
+    substring_set_kernel(SUBSTRING_KERNEL_AUTO); /* pick the scan kernel from CPUID once, before any thread runs */
+    recommendation_set_kernel(RECOMMENDATION_KERNEL_AUTO);
     MovieDatabase db;
     movie_db_init(&db);
     TitleIndex title_index;
     title_index_init(&title_index);
+    TitleAutocomplete completions; /* built on first use, rebuilt when the index gains keys */
+    title_autocomplete_init(&completions);
+    TitleFuzzyIndex fuzzy; /* built on first use, like the completions */
+    title_fuzzy_init(&fuzzy);
+    FullTextIndex plots; /* built on first plot search */
+    full_text_index_init(&plots);
+    ResultCache cache; /* first pages of recent searches, for the current catalog generation */
+    result_cache_init(&cache, RESULT_CACHE_DEFAULT_ENTRIES, RESULT_CACHE_DEFAULT_BYTES);
     SearchHistory history;
     history_init(&history, 200);
     WatchlistManager watchlists;
     watchlist_manager_init(&watchlists);
     RecommendationTree reco;
     reco_tree_init(&reco);
+    NeighborGraph neighbors; /* precomputed recommendations; live scoring when empty or stale */
+    neighbor_graph_init(&neighbors);
 
-    if (!reload_dataset(&db, &title_index, dataset_path)) {
+    if (!reload_dataset(&db, &title_index, dataset_path, &options)) {
         printf("Would you like to provide a different dataset path? (y/n): ");
         char buffer[INPUT_BUFFER];
         if (fgets(buffer, sizeof(buffer), stdin)) {
@@ -528,7 +975,7 @@ int main(int argc, char **argv) {
                 printf("Enter CSV file path: ");
                 if (fgets(buffer, sizeof(buffer), stdin)) {
                     trim_newline(buffer);
-                    if (!reload_dataset(&db, &title_index, buffer)) {
+                    if (!reload_dataset(&db, &title_index, buffer, &options)) {
                         printf("Failed to load dataset. Exiting.\n");
                         goto cleanup;
                     }
@@ -542,6 +989,42 @@ int main(int argc, char **argv) {
     }
 
     printf("Loaded %zu movie entries from %s\n", db.count, dataset_path);
+    for (size_t i = 0; i < append_count; ++i) {
+        append_dataset(&db, &title_index, append_paths[i]);
+    }
+    if (options.neighbors_out) {
+        char *error = NULL;
+        printf("Ranking %d recommendations for each of %zu movies on %zu thread(s)...\n", NEIGHBOR_GRAPH_DEFAULT_K, db.count,
+               options.threads);
+        if (!neighbor_graph_build(&neighbors, &db, NEIGHBOR_GRAPH_DEFAULT_K, options.threads)) {
+            fprintf(stderr, "Failed to build the recommendation graph.\n");
+        } else if (!neighbor_graph_write(options.neighbors_out, &neighbors, &db, &error)) {
+            fprintf(stderr, "%s\n", error ? error : "Failed to write neighbor graph");
+            free(error);
+        } else {
+            printf("Saved the recommendation graph to %s\n", options.neighbors_out);
+        }
+        goto cleanup;
+    }
+    if (options.neighbors_in) {
+        char *error = NULL;
+        if (neighbor_graph_load(options.neighbors_in, &neighbors, &db, &error)) {
+            printf("Loaded the recommendation graph %s\n", options.neighbors_in);
+        } else {
+            fprintf(stderr, "%s; recommendations will be scored live.\n", error ? error : "Neighbor graph unavailable");
+            free(error);
+        }
+    }
+    if (options.history_file) {
+        CacheWarmup warmup = {&db, &title_index, &cache, &history, 0};
+        char *error = NULL;
+        if (result_cache_load_keys(options.history_file, warm_cache, &warmup, &error)) {
+            if (warmup.replayed > 0) printf("Replayed %zu recorded searches from %s\n", warmup.replayed, options.history_file);
+        } else {
+            fprintf(stderr, "%s\n", error ? error : "Failed to read history file");
+            free(error);
+        }
+    }
 
     char input[INPUT_BUFFER];
     while (1) {
@@ -551,30 +1034,44 @@ int main(int argc, char **argv) {
         printf(" 2) View search history\n");
         printf(" 3) Manage watchlists\n");
         printf(" 4) Get recommendations\n");
-        printf(" 5) Exit\n");
+        printf(" 5) Add titles from a CSV file\n");
+        printf(" 6) Recently added\n");
+        printf(" 7) Exit\n");
         printf("Choose: ");
         if (!fgets(input, sizeof(input), stdin)) break;
         trim_newline(input);
-        if (input[0] == '5' || input[0] == '\0') {
+        if (input[0] == '7' || input[0] == '\0') {
             printf("Goodbye!\n");
             break;
         }
 
         switch (input[0]) {
             case '1':
-                search_menu(&db, &title_index, &history, &watchlists, &reco);
+                search_menu(&db, &title_index, &completions, &fuzzy, &plots, &cache, &history, &watchlists, &reco);
                 break;
             case '2':
                 history_print(&history);
+                printf("Result cache: %zu hits, %zu misses, %zu of %zu searches kept\n", cache.stats.hits,
+                       cache.stats.misses, cache.count, cache.max_entries);
                 press_enter_to_continue();
                 break;
             case '3':
                 watchlist_menu(&watchlists, &db);
                 break;
             case '4':
-                recommendation_menu(&db, &title_index, &watchlists, &reco);
+                recommendation_menu(&db, &title_index, &watchlists, &reco, &neighbors, options.threads);
                 press_enter_to_continue();
                 break;
+            case '5':
+                printf("Enter CSV file path: ");
+                if (!fgets(input, sizeof(input), stdin)) break;
+                trim_newline(input);
+                if (input[0] == '\0') break;
+                append_dataset(&db, &title_index, input);
+                break;
+            case '6':
+                recently_added_menu(&db, &watchlists, &history);
+                break;
             default:
                 printf("Invalid choice. Please try again.\n");
                 break;
@@ -582,10 +1079,23 @@ int main(int argc, char **argv) {
     }
 
 cleanup:
+    if (options.history_file && db.count > 0 && !options.neighbors_out) { /* a failed load or a graph build keeps the old file */
+        char *error = NULL;
+        if (!result_cache_save_keys(&cache, options.history_file, &error)) {
+            fprintf(stderr, "%s\n", error ? error : "Failed to write history file");
+            free(error);
+        }
+    }
+    result_cache_free(&cache);
+    free(append_paths);
+    title_autocomplete_free(&completions);
+    title_fuzzy_free(&fuzzy);
+    full_text_index_free(&plots);
     title_index_free(&title_index);
     watchlist_manager_free(&watchlists);
     history_clear(&history);
     reco_tree_free(&reco);
+    neighbor_graph_free(&neighbors);
     movie_db_free(&db);
     return 0;
 }
@@ -1,13 +1,30 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
 #include "movie.h"
+#include "casefold.h"
+#include "parallel.h"
 
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#define MOVIE_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
 #define MOVIE_INITIAL_CAPACITY 1024
 #define CSV_MAX_LINE 8192
 #define CSV_MAX_FIELDS 64
+#define CSV_SCRATCH_SIZE (CSV_MAX_LINE + CSV_MAX_FIELDS)
 
 static void *checked_malloc(size_t size) {
     void *ptr = malloc(size);
@@ -26,14 +43,10 @@ static char *string_duplicate(const char *src) {
     return copy;
 }
 
-static char *string_duplicate_lower(const char *src) {
+static char *arena_strdup_lower(Arena *arena, const char *src, size_t n) {
     if (!src) return NULL;
-    size_t n = strlen(src);
-    char *copy = (char *)checked_malloc(n + 1);
-    for (size_t i = 0; i < n; ++i) {
-        copy[i] = (char)tolower((unsigned char)src[i]);
-    }
-    copy[n] = '\0';
+    char *copy = (char *)arena_alloc(arena, n + 1, 1);
+    casefold(copy, src, n, CASEFOLD_KEYS);
     return copy;
 }
 
@@ -48,34 +61,30 @@ static void string_trim(char *s) {
     s[end - start] = '\0';
 }
 
-static int parse_csv_line(const char *line, char ***out_fields) {
-    size_t capacity = 16;
-    size_t count = 0;
-    char **fields = (char **)checked_malloc(capacity * sizeof(char *));
+/*
+ * Split one line into fields. Unescaped field text is written into scratch
+ * (at least CSV_SCRATCH_SIZE bytes) and fields[] point into it, so a row costs
+ * no allocations.
+ */
+static int parse_csv_line(const char *line, char *scratch, char **fields, int max_fields) {
+    int count = 0;
+    size_t used = 0;
 
     const char *p = line;
     while (*p) {
-        if (count == capacity) {
-            capacity *= 2;
-            fields = (char **)realloc(fields, capacity * sizeof(char *));
-            if (!fields) {
-                fprintf(stderr, "Error: Out of memory during CSV parsing\n");
-                exit(EXIT_FAILURE);
-            }
-        }
-
         while (*p == ' ' || *p == '\t') p++;
 
         int in_quotes = 0;
         if (*p == '"') { in_quotes = 1; p++; }
 
-        char buffer[CSV_MAX_LINE];
+        char *buffer = scratch + used;
+        size_t limit = CSV_SCRATCH_SIZE - used;
         size_t bi = 0;
         while (*p) {
             if (in_quotes) {
                 if (*p == '"') {
                     if (*(p + 1) == '"') {
-                        if (bi + 1 >= sizeof(buffer)) break;
+                        if (bi + 1 >= limit) break;
                         buffer[bi++] = '"';
                         p += 2;
                     } else {
@@ -86,96 +95,124 @@ static int parse_csv_line(const char *line, char ***out_fields) {
                         break;
                     }
                 } else {
-                    if (bi + 1 >= sizeof(buffer)) break;
+                    if (bi + 1 >= limit) break;
                     buffer[bi++] = *p++;
                 }
             } else {
                 if (*p == ',') { p++; break; }
                 if (*p == '\r' || *p == '\n') { break; }
-                if (bi + 1 >= sizeof(buffer)) break;
+                if (bi + 1 >= limit) break;
                 buffer[bi++] = *p++;
             }
         }
         buffer[bi] = '\0';
+        used += bi + 1;
 
-        char *field = string_duplicate(buffer);
-        string_trim(field);
-        fields[count++] = field;
+        string_trim(buffer);
+        if (count < max_fields) fields[count++] = buffer;
 
         if (*p == '\r') p++;
         if (*p == '\n') p++;
-        if (!*p) break;
+        if (!*p || used >= CSV_SCRATCH_SIZE) break;
     }
 
-    *out_fields = fields;
-    return (int)count;
-}
-
-static void free_fields(char **fields, int count) {
-    if (!fields) return;
-    for (int i = 0; i < count; ++i) free(fields[i]);
-    free(fields);
+    return count;
 }
 
 static void movie_init(Movie *movie) {
     memset(movie, 0, sizeof(*movie));
 }
 
-static void movie_free(Movie *movie) {
-    if (!movie) return;
-    free(movie->show_id);
-    free(movie->type);
-    free(movie->title);
-    free(movie->title_lower);
-    free(movie->director);
-    free(movie->director_lower);
-    free(movie->cast);
-    free(movie->country);
-    free(movie->date_added);
-    free(movie->release_year);
-    free(movie->rating);
-    free(movie->duration);
-    free(movie->listed_in);
-    free(movie->description);
-    if (movie->genres) {
-        for (size_t i = 0; i < movie->genre_count; ++i) {
-            free(movie->genres[i]);
+/* Days from 1970-01-01 to a proleptic Gregorian date (Hinnant's days_from_civil). */
+static int days_from_civil(int year, int month, int day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = year - era * 400;
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+static int valid_date(int year, int month, int day) {
+    static const int month_days[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (year < 1 || year > 9999 || month < 1 || month > 12 || day < 1 || day > month_days[month - 1]) return 0;
+    int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month != 2 || day <= 28 + leap;
+}
+
+/* Reads up to max_digits digits at *p; returns -1 when there are none. */
+static int parse_digits(const char **p, int max_digits) {
+    int value = -1;
+    for (int n = 0; n < max_digits && isdigit((unsigned char)**p); ++n, ++*p) {
+        value = (value < 0 ? 0 : value * 10) + (**p - '0');
+    }
+    return value;
+}
+
+int movie_parse_date(const char *text) {
+    static const char *const months[12] = {"january", "february", "march",     "april",   "may",      "june",
+                                           "july",    "august",   "september", "october", "november", "december"};
+    if (!text) return MOVIE_DATE_UNKNOWN;
+    const char *p = text;
+    while (*p == ' ') p++;
+
+    int year;
+    int month = 0;
+    int day;
+    if (isdigit((unsigned char)*p)) {
+        year = parse_digits(&p, 4);
+        if (*p++ != '-') return MOVIE_DATE_UNKNOWN;
+        month = parse_digits(&p, 2);
+        if (*p++ != '-') return MOVIE_DATE_UNKNOWN;
+        day = parse_digits(&p, 2);
+    } else {
+        /* A month name, or any prefix of one at least three letters long. */
+        size_t len = 0;
+        while (isalpha((unsigned char)p[len])) len++;
+        if (len < 3) return MOVIE_DATE_UNKNOWN;
+        for (int m = 0; m < 12 && month == 0; ++m) {
+            size_t i = 0;
+            while (i < len && months[m][i] == (char)tolower((unsigned char)p[i])) i++;
+            if (i == len) month = m + 1;
         }
-        free(movie->genres);
+        if (month == 0) return MOVIE_DATE_UNKNOWN;
+        p += len;
+        if (*p == '.') p++;
+        while (*p == ' ') p++;
+        day = parse_digits(&p, 2);
+        while (*p == ' ') p++;
+        if (*p == ',') p++;
+        while (*p == ' ') p++;
+        year = parse_digits(&p, 4);
     }
-    memset(movie, 0, sizeof(*movie));
+    while (*p == ' ') p++;
+    if (*p != '\0' || !valid_date(year, month, day)) return MOVIE_DATE_UNKNOWN;
+    return days_from_civil(year, month, day);
 }
 
-static void movie_parse_genres(Movie *movie) {
+static void movie_parse_genres(Arena *arena, Movie *movie) {
     movie->genres = NULL;
     movie->genre_count = 0;
     if (!movie->listed_in || movie->listed_in[0] == '\0') return;
 
-    size_t capacity = 4;
-    movie->genres = (char **)checked_malloc(capacity * sizeof(char *));
-
-    char *working = string_duplicate(movie->listed_in);
-    char *token = strtok(working, ",");
-    while (token) {
-        while (*token == ' ') token++;
-        char *end = token + strlen(token);
-        while (end > token && isspace((unsigned char)*(end - 1))) *(--end) = '\0';
-
-        if (*token) {
-            if (movie->genre_count == capacity) {
-                capacity *= 2;
-                movie->genres = (char **)realloc(movie->genres, capacity * sizeof(char *));
-                if (!movie->genres) {
-                    fprintf(stderr, "Error: Out of memory while storing genres\n");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            movie->genres[movie->genre_count++] = string_duplicate_lower(token);
+    size_t capacity = 1;
+    for (const char *c = movie->listed_in; *c; ++c) {
+        if (*c == ',') capacity++;
+    }
+    movie->genres = (char **)arena_alloc(arena, capacity * sizeof(char *), sizeof(char *));
+
+    const char *token = movie->listed_in;
+    while (*token) {
+        const char *stop = strchr(token, ',');
+        if (!stop) stop = token + strlen(token);
+        const char *end = stop;
+        while (token < end && *token == ' ') token++;
+        while (end > token && isspace((unsigned char)*(end - 1))) end--;
+        if (end > token) {
+            movie->genres[movie->genre_count++] = arena_strdup_lower(arena, token, (size_t)(end - token));
         }
-        token = strtok(NULL, ",");
+        token = *stop ? stop + 1 : stop;
     }
-
-    free(working);
 }
 
 static int normalize_header_index(char **fields, int count, const char *needle) {
@@ -198,9 +235,22 @@ static int normalize_header_index(char **fields, int count, const char *needle)
     return -1;
 }
 
+/* Source of MovieDatabase.generation, shared by every catalog of the process. */
+static uint64_t movie_db_generations = 0;
+
+void movie_db_new_generation(MovieDatabase *db) {
+    if (db) db->generation = ++movie_db_generations;
+}
+
 void movie_db_init(MovieDatabase *db) {
     if (!db) return;
+    db->generation = ++movie_db_generations;
     db->count = 0;
+    db->mapped_data = NULL;
+    db->mapped_length = 0;
+    arena_init(&db->arena);
+    movie_columns_init(&db->columns);
+    person_index_init(&db->people);
     db->capacity = MOVIE_INITIAL_CAPACITY;
     db->movies = (Movie *)checked_malloc(db->capacity * sizeof(Movie));
     for (size_t i = 0; i < db->capacity; ++i) {
@@ -220,10 +270,66 @@ static int movie_db_grow(MovieDatabase *db) {
     return 1;
 }
 
-static void movie_assign_field(Movie *movie, char **fields, int count, int idx, char **out_storage) {
-    (void)movie;
-    const char *value = (idx >= 0 && idx < count && fields[idx]) ? fields[idx] : "";
-    *out_storage = string_duplicate(value);
+typedef struct {
+    int show_id;
+    int type;
+    int title;
+    int director;
+    int cast;
+    int country;
+    int date_added;
+    int release_year;
+    int rating;
+    int duration;
+    int listed_in;
+    int description;
+} CsvColumnMap;
+
+static void csv_column_map_resolve(CsvColumnMap *map, char **headers, int header_count) {
+    map->show_id = normalize_header_index(headers, header_count, "showid");
+    map->type = normalize_header_index(headers, header_count, "type");
+    map->title = normalize_header_index(headers, header_count, "title");
+    map->director = normalize_header_index(headers, header_count, "director");
+    map->cast = normalize_header_index(headers, header_count, "cast");
+    map->country = normalize_header_index(headers, header_count, "country");
+    map->date_added = normalize_header_index(headers, header_count, "dateadded");
+    map->release_year = normalize_header_index(headers, header_count, "releaseyear");
+    map->rating = normalize_header_index(headers, header_count, "rating");
+    map->duration = normalize_header_index(headers, header_count, "duration");
+    map->listed_in = normalize_header_index(headers, header_count, "listedin");
+    map->description = normalize_header_index(headers, header_count, "description");
+}
+
+/*
+ * copy is 0 when fields are NUL-terminated views that outlive the movie
+ * (mapped mode); otherwise the text is copied into the arena.
+ */
+static void movie_assign_field(Arena *arena, char **fields, int count, int idx, int copy, char **out_storage) {
+    static char empty[] = "";
+    char *value = (idx >= 0 && idx < count && fields[idx]) ? fields[idx] : empty;
+    *out_storage = copy ? arena_strdup(arena, value) : value;
+}
+
+static void movie_assign_fields(Arena *arena, Movie *movie, char **fields, int count, const CsvColumnMap *map, int copy) {
+    movie_assign_field(arena, fields, count, map->show_id, copy, &movie->show_id);
+    movie_assign_field(arena, fields, count, map->type, copy, &movie->type);
+    movie_assign_field(arena, fields, count, map->title, copy, &movie->title);
+    movie_assign_field(arena, fields, count, map->director, copy, &movie->director);
+    movie_assign_field(arena, fields, count, map->cast, copy, &movie->cast);
+    movie_assign_field(arena, fields, count, map->country, copy, &movie->country);
+    movie_assign_field(arena, fields, count, map->date_added, copy, &movie->date_added);
+    movie_assign_field(arena, fields, count, map->release_year, copy, &movie->release_year);
+    movie_assign_field(arena, fields, count, map->rating, copy, &movie->rating);
+    movie_assign_field(arena, fields, count, map->duration, copy, &movie->duration);
+    movie_assign_field(arena, fields, count, map->listed_in, copy, &movie->listed_in);
+    movie_assign_field(arena, fields, count, map->description, copy, &movie->description);
+
+    movie->title_lower = arena_strdup_lower(arena, movie->title, strlen(movie->title));
+    movie->director_lower = arena_strdup_lower(arena, movie->director, strlen(movie->director));
+    movie->release_year_num = (movie->release_year && movie->release_year[0]) ? atoi(movie->release_year) : 0;
+    movie->date_added_days = movie_parse_date(movie->date_added);
+
+    movie_parse_genres(arena, movie);
 }
 
 int movie_db_load_from_csv(MovieDatabase *db, const char *path, char **error_message) {
@@ -249,101 +355,632 @@ int movie_db_load_from_csv(MovieDatabase *db, const char *path, char **error_mes
         return 0;
     }
 
-    char **headers = NULL;
-    int header_count = parse_csv_line(line, &headers);
+    char scratch[CSV_SCRATCH_SIZE];
+    char *headers[CSV_MAX_FIELDS];
+    int header_count = parse_csv_line(line, scratch, headers, CSV_MAX_FIELDS);
     if (header_count <= 0) {
         if (error_message) {
             *error_message = string_duplicate("Failed to parse CSV header row");
         }
         fclose(fp);
-        free_fields(headers, header_count);
         return 0;
     }
 
-    int idx_show_id = normalize_header_index(headers, header_count, "showid");
-    int idx_type = normalize_header_index(headers, header_count, "type");
-    int idx_title = normalize_header_index(headers, header_count, "title");
-    int idx_director = normalize_header_index(headers, header_count, "director");
-    int idx_cast = normalize_header_index(headers, header_count, "cast");
-    int idx_country = normalize_header_index(headers, header_count, "country");
-    int idx_date_added = normalize_header_index(headers, header_count, "dateadded");
-    int idx_release_year = normalize_header_index(headers, header_count, "releaseyear");
-    int idx_rating = normalize_header_index(headers, header_count, "rating");
-    int idx_duration = normalize_header_index(headers, header_count, "duration");
-    int idx_listed_in = normalize_header_index(headers, header_count, "listedin");
-    int idx_description = normalize_header_index(headers, header_count, "description");
-
-    if (idx_title < 0) {
+    CsvColumnMap map;
+    csv_column_map_resolve(&map, headers, header_count);
+
+    if (map.title < 0) {
         if (error_message) {
             *error_message = string_duplicate("The CSV file does not contain a 'title' column.");
         }
         fclose(fp);
-        free_fields(headers, header_count);
         return 0;
     }
 
     size_t loaded = 0;
+    char *fields[CSV_MAX_FIELDS];
     while (fgets(line, sizeof(line), fp)) {
-        char **fields = NULL;
-        int field_count = parse_csv_line(line, &fields);
-        if (field_count <= 0) {
-            free_fields(fields, field_count);
-            continue;
-        }
+        int field_count = parse_csv_line(line, scratch, fields, CSV_MAX_FIELDS);
+        if (field_count <= 0) continue;
 
         if (db->count == db->capacity) {
             if (!movie_db_grow(db)) {
                 if (error_message) {
                     *error_message = string_duplicate("Out of memory while expanding movie database.");
                 }
-                free_fields(fields, field_count);
                 break;
             }
         }
 
         Movie *movie = &db->movies[db->count];
         movie_init(movie);
-
-        movie_assign_field(movie, fields, field_count, idx_show_id, &movie->show_id);
-        movie_assign_field(movie, fields, field_count, idx_type, &movie->type);
-        movie_assign_field(movie, fields, field_count, idx_title, &movie->title);
-        movie_assign_field(movie, fields, field_count, idx_director, &movie->director);
-        movie_assign_field(movie, fields, field_count, idx_cast, &movie->cast);
-        movie_assign_field(movie, fields, field_count, idx_country, &movie->country);
-        movie_assign_field(movie, fields, field_count, idx_date_added, &movie->date_added);
-        movie_assign_field(movie, fields, field_count, idx_release_year, &movie->release_year);
-        movie_assign_field(movie, fields, field_count, idx_rating, &movie->rating);
-        movie_assign_field(movie, fields, field_count, idx_duration, &movie->duration);
-        movie_assign_field(movie, fields, field_count, idx_listed_in, &movie->listed_in);
-        movie_assign_field(movie, fields, field_count, idx_description, &movie->description);
-
-        movie->title_lower = string_duplicate_lower(movie->title);
-        movie->director_lower = string_duplicate_lower(movie->director);
-        movie->release_year_num = (movie->release_year && movie->release_year[0]) ? atoi(movie->release_year) : 0;
-
-        movie_parse_genres(movie);
+        movie_assign_fields(&db->arena, movie, fields, field_count, &map, 1);
 
         db->count++;
         loaded++;
-        free_fields(fields, field_count);
     }
 
-    free_fields(headers, header_count);
     fclose(fp);
 
     if (loaded == 0 && error_message && !*error_message) {
         *error_message = string_duplicate("No movie records were loaded from the CSV file.");
     }
 
+    movie_db_build_columns(db);
     return loaded > 0;
 }
 
-void movie_db_free(MovieDatabase *db) {
+static void csv_trim_view(char **start, char **end) {
+    while (*start < *end && isspace((unsigned char)**start)) (*start)++;
+    while (*end > *start && isspace((unsigned char)*(*end - 1))) (*end)--;
+}
+
+/*
+ * Parse one record of a NUL-terminated, writable buffer in place. Each field is
+ * terminated by overwriting its delimiter, so fields[] point straight into the
+ * buffer; quoted fields are only compacted when they contain doubled quotes.
+ * Unlike parse_csv_line, quoted fields may span lines. Returns the number of
+ * fields (0 for a blank line) and advances *cursor past the record.
+ */
+static int parse_csv_record_inplace(char **cursor, char **fields, int max_fields) {
+    char *p = *cursor;
+    int count = 0;
+
+    if (*p == '\r' || *p == '\n') {
+        if (*p == '\r') p++;
+        if (*p == '\n') p++;
+        *cursor = p;
+        return 0;
+    }
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t') p++;
+
+        char *start;
+        char *end;
+        char delimiter;
+        if (*p == '"') {
+            start = ++p;
+            char *out = p;
+            int escaped = 0;
+            while (*p) {
+                if (*p == '"') {
+                    if (p[1] != '"') break;
+                    escaped = 1;
+                    *out++ = '"';
+                    p += 2;
+                } else if (escaped) {
+                    *out++ = *p++;
+                } else {
+                    out = ++p;
+                }
+            }
+            end = out;
+            if (*p == '"') p++;
+            while (*p == ' ' || *p == '\t') p++;
+            delimiter = *p;
+            if (delimiter == ',') p++;
+        } else {
+            start = p;
+            while (*p && *p != ',' && *p != '\r' && *p != '\n') p++;
+            end = p;
+            delimiter = *p;
+            if (delimiter == ',') p++;
+        }
+
+        csv_trim_view(&start, &end);
+        /* end never passes the delimiter, so save line breaks before overwriting them. */
+        if (delimiter == '\r' || delimiter == '\n') {
+            if (*p == '\r') p++;
+            if (*p == '\n') p++;
+            *end = '\0';
+            if (count < max_fields) fields[count++] = start;
+            break;
+        }
+        *end = '\0';
+        if (count < max_fields) fields[count++] = start;
+    }
+
+    *cursor = p;
+    return count;
+}
+
+/* Parse the header record at *cursor and leave *cursor on the first data record. */
+static int csv_parse_header(char **cursor, CsvColumnMap *map, char **error_message) {
+    char *headers[CSV_MAX_FIELDS];
+    int header_count = 0;
+    while (**cursor && header_count == 0) {
+        header_count = parse_csv_record_inplace(cursor, headers, CSV_MAX_FIELDS);
+    }
+    if (header_count <= 0) {
+        if (error_message) {
+            *error_message = string_duplicate("Failed to parse CSV header row");
+        }
+        return 0;
+    }
+
+    csv_column_map_resolve(map, headers, header_count);
+    if (map->title < 0) {
+        if (error_message) {
+            *error_message = string_duplicate("The CSV file does not contain a 'title' column.");
+        }
+        return 0;
+    }
+    return 1;
+}
+
+/* Parse every record of a writable buffer; see movie_assign_field for copy. */
+static size_t movie_db_parse_records(MovieDatabase *db, char *cursor, const CsvColumnMap *map, int copy, char **error_message) {
+    size_t loaded = 0;
+    char *fields[CSV_MAX_FIELDS];
+    while (*cursor) {
+        int field_count = parse_csv_record_inplace(&cursor, fields, CSV_MAX_FIELDS);
+        if (field_count <= 0) continue;
+
+        if (db->count == db->capacity) {
+            if (!movie_db_grow(db)) {
+                if (error_message) {
+                    *error_message = string_duplicate("Out of memory while expanding movie database.");
+                }
+                break;
+            }
+        }
+
+        Movie *movie = &db->movies[db->count];
+        movie_init(movie);
+        movie_assign_fields(&db->arena, movie, fields, field_count, map, copy);
+
+        db->count++;
+        loaded++;
+    }
+    return loaded;
+}
+
+#ifdef MOVIE_HAVE_MMAP
+
+/*
+ * Map the file copy-on-write with at least one spare zero byte past its end, so
+ * the parser can treat it as a C string and terminate the last field in place.
+ */
+static char *map_file_private(int fd, size_t size, size_t *out_length) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t page_size = page > 0 ? (size_t)page : 4096u;
+    size_t length = ((size + 1 + page_size - 1) / page_size) * page_size;
+
+    void *region = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) return NULL;
+    void *file = mmap(region, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (file == MAP_FAILED) {
+        munmap(region, length);
+        return NULL;
+    }
+    *out_length = length;
+    return (char *)region;
+}
+
+/*
+ * Map path into db. Returns 1 with *out_size set on success, 0 on a hard error
+ * and -1 when the file should go through the stdio loader instead.
+ */
+static int movie_db_map_csv(MovieDatabase *db, const char *path, char **error_message, size_t *out_size) {
+    if (db->mapped_data) {
+        if (error_message) {
+            *error_message = string_duplicate("Movie database already holds a mapped catalog.");
+        }
+        return 0;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        if (error_message) {
+            size_t len = strlen(path) + 64;
+            *error_message = (char *)checked_malloc(len);
+            snprintf(*error_message, len, "Failed to open CSV file: %s", path);
+        }
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t length = 0;
+    char *data = map_file_private(fd, (size_t)st.st_size, &length);
+    close(fd);
+    if (!data) return -1;
+
+    db->mapped_data = data;
+    db->mapped_length = length;
+    *out_size = (size_t)st.st_size;
+    return 1;
+}
+
+int movie_db_load_from_csv_mapped(MovieDatabase *db, const char *path, char **error_message) {
+    if (error_message) *error_message = NULL;
+    if (!db || !path) return 0;
+
+    size_t size = 0;
+    int mapped = movie_db_map_csv(db, path, error_message, &size);
+    if (mapped < 0) return movie_db_load_from_csv(db, path, error_message);
+    if (mapped == 0) return 0;
+
+    char *cursor = db->mapped_data;
+    CsvColumnMap map;
+    if (!csv_parse_header(&cursor, &map, error_message)) return 0;
+
+    size_t loaded = movie_db_parse_records(db, cursor, &map, 0, error_message);
+
+    if (loaded == 0 && error_message && !*error_message) {
+        *error_message = string_duplicate("No movie records were loaded from the CSV file.");
+    }
+
+    movie_db_build_columns(db);
+    return loaded > 0;
+}
+
+/* Bytes of body per worker below which splitting the parse is not worth it. */
+#define PARALLEL_MIN_CHUNK ((size_t)1 << 20)
+
+typedef struct {
+    char *raw_start;       /* even byte split of the body */
+    char *start;           /* first record boundary at or after raw_start */
+    size_t quotes;         /* '"' bytes in [raw_start, next raw_start) */
+    int aligned;           /* records from start end exactly on the next chunk's start */
+    Movie *movies;
+    size_t count;
+    size_t capacity;
+    Arena arena;
+} CsvChunk;
+
+typedef struct {
+    CsvChunk *chunks;
+    size_t chunk_count;
+    char *body_end;
+    const CsvColumnMap *map;
+} CsvParallelLoad;
+
+static void csv_chunk_count_quotes(void *ctx, size_t worker, size_t workers) {
+    (void)workers;
+    CsvParallelLoad *load = (CsvParallelLoad *)ctx;
+    CsvChunk *chunk = &load->chunks[worker];
+    const char *end = worker + 1 < load->chunk_count ? load->chunks[worker + 1].raw_start : load->body_end;
+    size_t quotes = 0;
+    const char *p = chunk->raw_start;
+    while (p < end && (p = (const char *)memchr(p, '"', (size_t)(end - p))) != NULL) {
+        quotes++;
+        p++;
+    }
+    chunk->quotes = quotes;
+}
+
+/* Quote parity says whether raw_start lies inside a quoted field; the chunk starts after the next unquoted newline. */
+static void csv_chunk_find_start(void *ctx, size_t worker, size_t workers) {
+    (void)workers;
+    CsvParallelLoad *load = (CsvParallelLoad *)ctx;
+    CsvChunk *chunk = &load->chunks[worker];
+    if (worker == 0) {
+        chunk->start = chunk->raw_start;
+        return;
+    }
+    size_t quotes_before = 0;
+    for (size_t i = 0; i < worker; ++i) quotes_before += load->chunks[i].quotes;
+    int in_quotes = (int)(quotes_before & 1u);
+    const char *p = chunk->raw_start;
+    while (p < load->body_end) {
+        if (*p == '"') {
+            in_quotes = !in_quotes;
+        } else if (*p == '\n' && !in_quotes) {
+            p++;
+            break;
+        }
+        p++;
+    }
+    chunk->start = (char *)p;
+}
+
+#define CSV_AT(p, limit) ((p) < (limit) ? *(p) : '\0')
+
+/*
+ * Read-only mirror of parse_csv_record_inplace that only finds where a record
+ * ends. Returns NULL when the record runs into limit before its line break,
+ * unless limit is the end of the file.
+ */
+static const char *csv_skip_record(const char *p, const char *limit, int limit_is_end) {
+    if (CSV_AT(p, limit) == '\r' || CSV_AT(p, limit) == '\n') {
+        if (CSV_AT(p, limit) == '\r') p++;
+        if (CSV_AT(p, limit) == '\n') p++;
+        return p;
+    }
+    while (CSV_AT(p, limit)) {
+        while (CSV_AT(p, limit) == ' ' || CSV_AT(p, limit) == '\t') p++;
+        char delimiter;
+        if (CSV_AT(p, limit) == '"') {
+            p++;
+            while (CSV_AT(p, limit)) {
+                if (*p == '"') {
+                    if (CSV_AT(p + 1, limit) != '"') break;
+                    p += 2;
+                } else {
+                    p++;
+                }
+            }
+            if (CSV_AT(p, limit) == '"') p++;
+            while (CSV_AT(p, limit) == ' ' || CSV_AT(p, limit) == '\t') p++;
+        } else {
+            while (CSV_AT(p, limit) && *p != ',' && *p != '\r' && *p != '\n') p++;
+        }
+        delimiter = CSV_AT(p, limit);
+        if (delimiter == ',') {
+            p++;
+        } else if (delimiter == '\r' || delimiter == '\n') {
+            if (CSV_AT(p, limit) == '\r') p++;
+            if (CSV_AT(p, limit) == '\n') p++;
+            return p;
+        }
+    }
+    return (p < limit || limit_is_end) ? p : NULL;
+}
+
+/*
+ * Parity only tracks quotes, while the parser treats a quote inside an unquoted
+ * field as text; confirm the chunk splits into whole records before anything is
+ * parsed in place.
+ */
+static void csv_chunk_verify(void *ctx, size_t worker, size_t workers) {
+    (void)workers;
+    CsvParallelLoad *load = (CsvParallelLoad *)ctx;
+    CsvChunk *chunk = &load->chunks[worker];
+    int last = worker + 1 == load->chunk_count;
+    const char *limit = last ? load->body_end : load->chunks[worker + 1].start;
+    const char *p = chunk->start;
+    while (p && p < limit) {
+        const char *next = csv_skip_record(p, limit, last);
+        if (next == p) break;
+        p = next;
+    }
+    chunk->aligned = (p == limit);
+}
+
+static void csv_chunk_parse(void *ctx, size_t worker, size_t workers) {
+    (void)workers;
+    CsvParallelLoad *load = (CsvParallelLoad *)ctx;
+    CsvChunk *chunk = &load->chunks[worker];
+    char *limit = worker + 1 < load->chunk_count ? load->chunks[worker + 1].start : load->body_end;
+    char *cursor = chunk->start;
+    char *fields[CSV_MAX_FIELDS];
+    while (cursor < limit) {
+        int field_count = parse_csv_record_inplace(&cursor, fields, CSV_MAX_FIELDS);
+        if (field_count <= 0) continue;
+        if (chunk->count == chunk->capacity) {
+            size_t new_capacity = chunk->capacity == 0 ? 256 : chunk->capacity * 2;
+            Movie *grown = (Movie *)realloc(chunk->movies, new_capacity * sizeof(Movie));
+            if (!grown) {
+                fprintf(stderr, "Error: Out of memory while parsing CSV chunk\n");
+                exit(EXIT_FAILURE);
+            }
+            chunk->movies = grown;
+            chunk->capacity = new_capacity;
+        }
+        Movie *movie = &chunk->movies[chunk->count++];
+        movie_init(movie);
+        movie_assign_fields(&chunk->arena, movie, fields, field_count, load->map, 0);
+    }
+}
+
+int movie_db_load_from_csv_parallel(MovieDatabase *db, const char *path, size_t threads, char **error_message) {
+    if (error_message) *error_message = NULL;
+    if (!db || !path) return 0;
+    if (threads <= 1) return movie_db_load_from_csv_mapped(db, path, error_message);
+
+    size_t size = 0;
+    int mapped = movie_db_map_csv(db, path, error_message, &size);
+    if (mapped < 0) return movie_db_load_from_csv(db, path, error_message);
+    if (mapped == 0) return 0;
+
+    char *cursor = db->mapped_data;
+    CsvColumnMap map;
+    if (!csv_parse_header(&cursor, &map, error_message)) return 0;
+
+    char *body_end = db->mapped_data + size;
+    size_t body_size = (size_t)(body_end - cursor);
+    size_t chunk_count = threads;
+    if (chunk_count > body_size / PARALLEL_MIN_CHUNK) chunk_count = body_size / PARALLEL_MIN_CHUNK;
+
+    size_t loaded = 0;
+    if (chunk_count <= 1) {
+        loaded = movie_db_parse_records(db, cursor, &map, 0, error_message);
+    } else {
+        CsvParallelLoad load;
+        load.chunks = (CsvChunk *)checked_malloc(chunk_count * sizeof(CsvChunk));
+        load.chunk_count = chunk_count;
+        load.body_end = body_end;
+        load.map = &map;
+        for (size_t i = 0; i < chunk_count; ++i) {
+            CsvChunk *chunk = &load.chunks[i];
+            chunk->raw_start = cursor + body_size / chunk_count * i;
+            chunk->start = NULL;
+            chunk->quotes = 0;
+            chunk->aligned = 0;
+            chunk->movies = NULL;
+            chunk->count = 0;
+            chunk->capacity = 0;
+            arena_init(&chunk->arena);
+        }
+
+        parallel_run(chunk_count, csv_chunk_count_quotes, &load);
+        parallel_run(chunk_count, csv_chunk_find_start, &load);
+        parallel_run(chunk_count, csv_chunk_verify, &load);
+
+        int aligned = 1;
+        for (size_t i = 0; i < chunk_count; ++i) {
+            if (!load.chunks[i].aligned) aligned = 0;
+        }
+
+        if (!aligned) {
+            /* Nothing has been written into the mapping yet, so a serial parse is still safe. */
+            loaded = movie_db_parse_records(db, cursor, &map, 0, error_message);
+        } else {
+            parallel_run(chunk_count, csv_chunk_parse, &load);
+
+            size_t total = db->count;
+            for (size_t i = 0; i < chunk_count; ++i) total += load.chunks[i].count;
+            while (db->capacity < total) {
+                if (!movie_db_grow(db)) {
+                    fprintf(stderr, "Error: Out of memory while expanding movie database\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            for (size_t i = 0; i < chunk_count; ++i) {
+                CsvChunk *chunk = &load.chunks[i];
+                if (chunk->count > 0) {
+                    memcpy(&db->movies[db->count], chunk->movies, chunk->count * sizeof(Movie));
+                }
+                db->count += chunk->count;
+                loaded += chunk->count;
+                free(chunk->movies);
+                arena_adopt(&db->arena, &chunk->arena);
+            }
+        }
+        free(load.chunks);
+    }
+
+    if (loaded == 0 && error_message && !*error_message) {
+        *error_message = string_duplicate("No movie records were loaded from the CSV file.");
+    }
+
+    movie_db_build_columns(db);
+    return loaded > 0;
+}
+
+#else
+
+int movie_db_load_from_csv_mapped(MovieDatabase *db, const char *path, char **error_message) {
+    return movie_db_load_from_csv(db, path, error_message);
+}
+
+int movie_db_load_from_csv_parallel(MovieDatabase *db, const char *path, size_t threads, char **error_message) {
+    (void)threads;
+    return movie_db_load_from_csv(db, path, error_message);
+}
+
+#endif /* MOVIE_HAVE_MMAP */
+
+static unsigned char movie_type_code(const char *type) {
+    if (!type) return MOVIE_TYPE_UNKNOWN;
+    if (strcmp(type, "Movie") == 0) return MOVIE_TYPE_MOVIE;
+    if (strcmp(type, "TV Show") == 0) return MOVIE_TYPE_TV_SHOW;
+    return MOVIE_TYPE_UNKNOWN;
+}
+
+/* Add movies [first, db->count) to the columns and the person index. */
+static void movie_db_index_rows(MovieDatabase *db, size_t first) {
+    MovieColumns *columns = &db->columns;
+    db->generation = ++movie_db_generations;
+    movie_columns_reserve(columns, db->count);
+    for (size_t i = first; i < db->count; ++i) {
+        Movie *movie = &db->movies[i];
+        columns->release_year[i] = movie->release_year_num;
+        columns->date_added[i] = movie->date_added_days;
+        if (movie->release_year_num > 0) {
+            result_set_add(movie_columns_year_movies(columns, movie->release_year_num), (uint32_t)i);
+        }
+        columns->type_code[i] = movie_type_code(movie->type);
+        if (movie->director_lower && movie->director_lower[0]) {
+            columns->director_id[i] = string_dictionary_intern(&columns->directors, movie->director_lower);
+        } else {
+            columns->director_id[i] = COLUMNS_NO_DIRECTOR;
+        }
+        genre_set_clear(&movie->genre_set);
+        for (size_t j = 0; j < movie->genre_count; ++j) {
+            uint32_t id = string_dictionary_intern(&columns->genres, movie->genres[j]);
+            if (!genre_set_add(&movie->genre_set, id)) columns->genre_overflow = 1;
+            result_set_add(movie_columns_genre_movies(columns, id), (uint32_t)i);
+        }
+        columns->genre_set[i] = movie->genre_set;
+    }
+    columns->count = db->count;
+    movie_columns_extend_orders(columns, first);
+
+    for (size_t i = first; i < db->count; ++i) {
+        person_index_add_movie(&db->people, i, db->movies[i].director, db->movies[i].cast);
+    }
+    person_index_finish(&db->people);
+}
+
+void movie_db_build_columns(MovieDatabase *db) {
     if (!db) return;
-    for (size_t i = 0; i < db->count; ++i) {
-        movie_free(&db->movies[i]);
+    movie_columns_free(&db->columns);
+    person_index_free(&db->people);
+    movie_db_index_rows(db, 0);
+}
+
+int movie_db_append_from_csv(MovieDatabase *db, const char *path, size_t *out_first, char **error_message) {
+    if (error_message) *error_message = NULL;
+    if (out_first) *out_first = db ? db->count : 0;
+    if (!db || !path) return 0;
+
+    /* The delta is small: read it whole so records may span lines, and copy the fields out. */
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        if (error_message) {
+            size_t len = strlen(path) + 64;
+            *error_message = (char *)checked_malloc(len);
+            snprintf(*error_message, len, "Failed to open CSV file: %s", path);
+        }
+        return 0;
+    }
+    size_t size = 0;
+    size_t capacity = 64 * 1024;
+    char *buffer = (char *)checked_malloc(capacity);
+    size_t n;
+    while ((n = fread(buffer + size, 1, capacity - size - 1, fp)) > 0) {
+        size += n;
+        if (capacity - size - 1 == 0) {
+            capacity *= 2;
+            char *grown = (char *)realloc(buffer, capacity);
+            if (!grown) {
+                free(buffer);
+                fclose(fp);
+                if (error_message) *error_message = string_duplicate("Out of memory while reading CSV file.");
+                return 0;
+            }
+            buffer = grown;
+        }
+    }
+    fclose(fp);
+    buffer[size] = '\0';
+
+    size_t first = db->count;
+    char *cursor = buffer;
+    CsvColumnMap map;
+    size_t loaded = 0;
+    if (csv_parse_header(&cursor, &map, error_message)) {
+        loaded = movie_db_parse_records(db, cursor, &map, 1, error_message);
+        if (loaded == 0 && error_message && !*error_message) {
+            *error_message = string_duplicate("No movie records were found in the CSV file.");
+        }
     }
+    free(buffer);
+
+    /* Nothing was added: keep the generation, and with it the caches built on this catalog. */
+    if (loaded == 0) return 0;
+    movie_db_index_rows(db, first);
+    return 1;
+}
+
+void movie_db_free(MovieDatabase *db) {
+    if (!db) return;
+    movie_columns_free(&db->columns);
+    person_index_free(&db->people);
+    arena_free(&db->arena);
     free(db->movies);
+#ifdef MOVIE_HAVE_MMAP
+    if (db->mapped_data) munmap(db->mapped_data, db->mapped_length);
+#endif
+    db->mapped_data = NULL;
+    db->mapped_length = 0;
     db->movies = NULL;
     db->count = 0;
     db->capacity = 0;
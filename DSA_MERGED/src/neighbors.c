@@ -0,0 +1,262 @@
+#include "neighbors.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+#include "recommendation.h"
+
+#define NEIGHBOR_GRAPH_MAGIC "MOVNBRS"
+#define NEIGHBOR_GRAPH_ENDIAN_TAG 0x01020304u
+
+/*
+ * File layout:
+ *   NeighborGraphHeader
+ *   uint64_t offsets[movie_count + 1]
+ *   uint64_t keys[edge_count]
+ *   uint32_t neighbors[edge_count]
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;
+    uint64_t movie_count;
+    uint64_t k;
+    uint64_t edge_count;
+    uint64_t fingerprint; /* of the catalog the graph was built for */
+    uint64_t checksum;    /* over every byte after the header */
+} NeighborGraphHeader;
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static void set_error(char **error_message, const char *message, const char *path) {
+    if (!error_message) return;
+    size_t len = strlen(message) + strlen(path) + 4;
+    *error_message = (char *)checked_malloc(len);
+    snprintf(*error_message, len, "%s: %s", message, path);
+}
+
+void neighbor_graph_init(NeighborGraph *graph) {
+    if (!graph) return;
+    graph->movie_count = 0;
+    graph->k = 0;
+    graph->generation = 0;
+    graph->offsets = NULL;
+    graph->neighbors = NULL;
+    graph->keys = NULL;
+}
+
+void neighbor_graph_free(NeighborGraph *graph) {
+    if (!graph) return;
+    free(graph->offsets);
+    free(graph->neighbors);
+    free(graph->keys);
+    neighbor_graph_init(graph);
+}
+
+int neighbor_graph_covers(const NeighborGraph *graph, const MovieDatabase *db, size_t k) {
+    if (!graph || !db || !graph->offsets || graph->generation == 0) return 0;
+    if (graph->generation != db->generation || graph->movie_count != db->count) return 0;
+    /* A movie can have fewer than k neighbors only when the catalog has fewer movies. */
+    return k <= graph->k || graph->k >= db->count - 1;
+}
+
+/* ---- building ---- */
+
+typedef struct {
+    const MovieDatabase *db;
+    NeighborGraph *graph;
+    size_t per_movie;
+    unsigned char *failed; /* one flag per worker */
+} NeighborBuild;
+
+/* Every movie has exactly per_movie neighbors, so movie i owns slots [i * per_movie, (i + 1) * per_movie). */
+static void neighbor_build_task(void *ctx, size_t worker, size_t workers) {
+    NeighborBuild *build = (NeighborBuild *)ctx;
+    for (size_t i = worker; i < build->db->count; i += workers) {
+        Recommendation *list = NULL;
+        size_t count = 0;
+        if (!recommendation_generate_top(build->db, i, build->per_movie, &list, &count) || count != build->per_movie) {
+            free(list);
+            build->failed[worker] = 1;
+            return;
+        }
+        size_t first = i * build->per_movie;
+        for (size_t j = 0; j < count; ++j) {
+            build->graph->neighbors[first + j] = (uint32_t)list[j].movie_index;
+            build->graph->keys[first + j] = recommendation_key_pack(&list[j]);
+        }
+        free(list);
+    }
+}
+
+int neighbor_graph_build(NeighborGraph *graph, const MovieDatabase *db, size_t k, size_t threads) {
+    if (!graph || !db || k == 0 || db->count < 2 || db->count > UINT32_MAX) return 0;
+    neighbor_graph_free(graph);
+    size_t per_movie = k < db->count - 1 ? k : db->count - 1;
+    size_t edges = db->count * per_movie;
+    graph->offsets = (uint64_t *)checked_malloc((db->count + 1) * sizeof(uint64_t));
+    graph->neighbors = (uint32_t *)checked_malloc(edges * sizeof(uint32_t));
+    graph->keys = (uint64_t *)checked_malloc(edges * sizeof(uint64_t));
+    for (size_t i = 0; i <= db->count; ++i) graph->offsets[i] = (uint64_t)(i * per_movie);
+
+    if (threads == 0) threads = 1;
+    if (threads > db->count) threads = db->count;
+    NeighborBuild build = {db, graph, per_movie, (unsigned char *)calloc(threads, 1)};
+    if (!build.failed) {
+        neighbor_graph_free(graph);
+        return 0;
+    }
+    parallel_run(threads, neighbor_build_task, &build);
+    int failed = 0;
+    for (size_t w = 0; w < threads; ++w) failed |= build.failed[w];
+    free(build.failed);
+    if (failed) {
+        neighbor_graph_free(graph);
+        return 0;
+    }
+    graph->movie_count = db->count;
+    graph->k = k;
+    graph->generation = db->generation;
+    return 1;
+}
+
+/* ---- file ---- */
+
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+static uint64_t fnv_update(uint64_t hash, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/* What the scores depend on: every movie's title, director, genres and release year, in order. */
+static uint64_t catalog_fingerprint(const MovieDatabase *db) {
+    uint64_t hash = fnv_update(FNV_OFFSET, &db->count, sizeof(db->count));
+    for (size_t i = 0; i < db->count; ++i) {
+        const Movie *movie = &db->movies[i];
+        const char *title = movie->title_lower ? movie->title_lower : "";
+        const char *director = movie->director_lower ? movie->director_lower : "";
+        hash = fnv_update(hash, title, strlen(title) + 1);
+        hash = fnv_update(hash, director, strlen(director) + 1);
+        for (size_t g = 0; g < movie->genre_count; ++g) {
+            hash = fnv_update(hash, movie->genres[g], strlen(movie->genres[g]) + 1);
+        }
+        int64_t year = movie->release_year_num;
+        hash = fnv_update(hash, &year, sizeof(year));
+    }
+    return hash;
+}
+
+static uint64_t graph_checksum(const NeighborGraph *graph, size_t edges) {
+    uint64_t hash = fnv_update(FNV_OFFSET, graph->offsets, (graph->movie_count + 1) * sizeof(uint64_t));
+    hash = fnv_update(hash, graph->keys, edges * sizeof(uint64_t));
+    return fnv_update(hash, graph->neighbors, edges * sizeof(uint32_t));
+}
+
+int neighbor_graph_write(const char *path, const NeighborGraph *graph, const MovieDatabase *db, char **error_message) {
+    if (error_message) *error_message = NULL;
+    if (!path || !graph || !db || !graph->offsets) return 0;
+    size_t edges = (size_t)graph->offsets[graph->movie_count];
+    NeighborGraphHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, NEIGHBOR_GRAPH_MAGIC, sizeof(NEIGHBOR_GRAPH_MAGIC));
+    header.version = NEIGHBOR_GRAPH_VERSION;
+    header.endian_tag = NEIGHBOR_GRAPH_ENDIAN_TAG;
+    header.movie_count = graph->movie_count;
+    header.k = graph->k;
+    header.edge_count = edges;
+    header.fingerprint = catalog_fingerprint(db);
+    header.checksum = graph_checksum(graph, edges);
+
+    size_t tmp_len = strlen(path) + 8;
+    char *tmp_path = (char *)checked_malloc(tmp_len);
+    snprintf(tmp_path, tmp_len, "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "wb");
+    int failed = fp == NULL;
+    if (!failed) {
+        failed = fwrite(&header, sizeof(header), 1, fp) != 1 ||
+                 fwrite(graph->offsets, sizeof(uint64_t), graph->movie_count + 1, fp) != graph->movie_count + 1 ||
+                 fwrite(graph->keys, sizeof(uint64_t), edges, fp) != edges ||
+                 fwrite(graph->neighbors, sizeof(uint32_t), edges, fp) != edges;
+        if (fclose(fp) != 0) failed = 1;
+    }
+    if (failed || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        free(tmp_path);
+        set_error(error_message, "Failed to write neighbor graph", path);
+        return 0;
+    }
+    free(tmp_path);
+    return 1;
+}
+
+int neighbor_graph_load(const char *path, NeighborGraph *graph, const MovieDatabase *db, char **error_message) {
+    if (error_message) *error_message = NULL;
+    if (!path || !graph || !db) return 0;
+    neighbor_graph_free(graph);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        set_error(error_message, "Neighbor graph not found", path);
+        return 0;
+    }
+    NeighborGraphHeader header;
+    const char *problem = NULL;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, NEIGHBOR_GRAPH_MAGIC, sizeof(header.magic)) != 0 ||
+        header.endian_tag != NEIGHBOR_GRAPH_ENDIAN_TAG) {
+        problem = "Not a neighbor graph";
+    } else if (header.version != NEIGHBOR_GRAPH_VERSION) {
+        problem = "Neighbor graph was written by another version";
+    } else if (header.movie_count != db->count || header.fingerprint != catalog_fingerprint(db)) {
+        problem = "Neighbor graph was built for another catalog";
+    } else if (header.k == 0 || header.k > header.movie_count || header.edge_count > header.movie_count * header.k) {
+        problem = "Neighbor graph header is invalid";
+    }
+    if (!problem) {
+        size_t edges = (size_t)header.edge_count;
+        graph->movie_count = (size_t)header.movie_count;
+        graph->offsets = (uint64_t *)checked_malloc((graph->movie_count + 1) * sizeof(uint64_t));
+        graph->keys = (uint64_t *)checked_malloc((edges > 0 ? edges : 1) * sizeof(uint64_t));
+        graph->neighbors = (uint32_t *)checked_malloc((edges > 0 ? edges : 1) * sizeof(uint32_t));
+        if (fread(graph->offsets, sizeof(uint64_t), graph->movie_count + 1, fp) != graph->movie_count + 1 ||
+            fread(graph->keys, sizeof(uint64_t), edges, fp) != edges ||
+            fread(graph->neighbors, sizeof(uint32_t), edges, fp) != edges) {
+            problem = "Neighbor graph is truncated";
+        } else if (graph_checksum(graph, edges) != header.checksum) {
+            problem = "Neighbor graph checksum mismatch";
+        } else {
+            /* Offsets must step forward within the edges, and every neighbor be a movie. */
+            for (size_t i = 0; i < graph->movie_count && !problem; ++i) {
+                if (graph->offsets[i] > graph->offsets[i + 1]) problem = "Neighbor graph offsets are invalid";
+            }
+            if (!problem && (graph->offsets[0] != 0 || graph->offsets[graph->movie_count] != edges)) {
+                problem = "Neighbor graph offsets are invalid";
+            }
+            for (size_t e = 0; e < edges && !problem; ++e) {
+                if (graph->neighbors[e] >= graph->movie_count) problem = "Neighbor graph refers to missing movies";
+            }
+        }
+    }
+    fclose(fp);
+    if (problem) {
+        neighbor_graph_free(graph);
+        set_error(error_message, problem, path);
+        return 0;
+    }
+    graph->k = (size_t)header.k;
+    graph->generation = db->generation;
+    return 1;
+}
@@ -0,0 +1,83 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "parallel.h"
+
+#include <stdlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PARALLEL_HAVE_PTHREADS 1
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef PARALLEL_HAVE_PTHREADS
+
+typedef struct {
+    ParallelTask task;
+    void *ctx;
+    size_t worker;
+    size_t workers;
+} ParallelWorker;
+
+static void *parallel_thread_main(void *arg) {
+    ParallelWorker *w = (ParallelWorker *)arg;
+    w->task(w->ctx, w->worker, w->workers);
+    return NULL;
+}
+
+void parallel_run(size_t workers, ParallelTask task, void *ctx) {
+    if (!task || workers == 0) return;
+    if (workers == 1) {
+        task(ctx, 0, 1);
+        return;
+    }
+
+    ParallelWorker *slots = (ParallelWorker *)malloc(workers * sizeof(ParallelWorker));
+    pthread_t *threads = (pthread_t *)malloc(workers * sizeof(pthread_t));
+    int *started = (int *)calloc(workers, sizeof(int));
+    if (!slots || !threads || !started) {
+        free(slots);
+        free(threads);
+        free(started);
+        for (size_t i = 0; i < workers; ++i) task(ctx, i, workers);
+        return;
+    }
+
+    for (size_t i = 1; i < workers; ++i) {
+        slots[i].task = task;
+        slots[i].ctx = ctx;
+        slots[i].worker = i;
+        slots[i].workers = workers;
+        started[i] = pthread_create(&threads[i], NULL, parallel_thread_main, &slots[i]) == 0;
+    }
+    task(ctx, 0, workers);
+    for (size_t i = 1; i < workers; ++i) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            task(ctx, i, workers);
+        }
+    }
+
+    free(slots);
+    free(threads);
+    free(started);
+}
+
+size_t parallel_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1u;
+}
+
+#else
+
+void parallel_run(size_t workers, ParallelTask task, void *ctx) {
+    if (!task) return;
+    for (size_t i = 0; i < workers; ++i) task(ctx, i, workers);
+}
+
+size_t parallel_cpu_count(void) {
+    return 1;
+}
+
+#endif /* PARALLEL_HAVE_PTHREADS */
@@ -0,0 +1,294 @@
+#include "people.h"
+#include "casefold.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Names up to this length are folded on the stack before the dictionary lookup. */
+#define PERSON_NAME_SCRATCH 256
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static void person_postings_init(PersonPostings *postings) {
+    postings->offsets = NULL;
+    postings->postings = NULL;
+    postings->base_people = 0;
+    postings->delta = NULL;
+    postings->delta_count = 0;
+    postings->pending = NULL;
+    postings->pending_count = 0;
+    postings->pending_capacity = 0;
+    postings->borrowed = 0;
+}
+
+static void person_postings_free(PersonPostings *postings) {
+    if (!postings->borrowed) {
+        free(postings->offsets);
+        free(postings->postings);
+        free(postings->delta);
+    }
+    free(postings->pending);
+    person_postings_init(postings);
+}
+
+void person_index_init(PersonIndex *index) {
+    if (!index) return;
+    string_dictionary_init(&index->names);
+    arena_init(&index->arena);
+    for (size_t r = 0; r < PERSON_ROLE_COUNT; ++r) {
+        person_postings_init(&index->roles[r]);
+    }
+    text_blob_init(&index->name_text);
+}
+
+void person_index_free(PersonIndex *index) {
+    if (!index) return;
+    string_dictionary_free(&index->names);
+    arena_free(&index->arena);
+    for (size_t r = 0; r < PERSON_ROLE_COUNT; ++r) {
+        person_postings_free(&index->roles[r]);
+    }
+    text_blob_free(&index->name_text);
+}
+
+static void person_postings_push(PersonPostings *postings, uint32_t person, uint32_t movie) {
+    if (postings->pending_count == postings->pending_capacity) {
+        size_t new_capacity = postings->pending_capacity == 0 ? 256 : postings->pending_capacity * 2;
+        uint64_t *grown = (uint64_t *)realloc(postings->pending, new_capacity * sizeof(uint64_t));
+        if (!grown) {
+            fprintf(stderr, "Error: Out of memory while building person index\n");
+            exit(EXIT_FAILURE);
+        }
+        postings->pending = grown;
+        postings->pending_capacity = new_capacity;
+    }
+    postings->pending[postings->pending_count++] = (uint64_t)person << 32 | movie;
+}
+
+static uint32_t person_index_intern(PersonIndex *index, const char *name, size_t n) {
+    char scratch[PERSON_NAME_SCRATCH];
+    char *lowered = n < sizeof(scratch) ? scratch : (char *)checked_malloc(n + 1);
+    /* Fold like every other key, so a folded query finds the name. */
+    n = casefold(lowered, name, n, CASEFOLD_KEYS);
+    size_t hash = string_dictionary_hash(lowered);
+
+    uint32_t id = string_dictionary_find_hashed(&index->names, lowered, hash);
+    if (id == COLUMNS_NOT_FOUND) {
+        id = string_dictionary_intern_hashed(&index->names, arena_strndup(&index->arena, lowered, n), hash);
+    }
+    if (lowered != scratch) free(lowered);
+    return id;
+}
+
+static void person_index_add_field(PersonIndex *index, PersonRole role, uint32_t movie, const char *field) {
+    if (!field) return;
+    const char *p = field;
+    while (*p) {
+        const char *end = strchr(p, ',');
+        if (!end) end = p + strlen(p);
+        const char *start = p;
+        const char *stop = end;
+        while (start < stop && isspace((unsigned char)*start)) start++;
+        while (stop > start && isspace((unsigned char)stop[-1])) stop--;
+        if (stop > start) {
+            uint32_t person = person_index_intern(index, start, (size_t)(stop - start));
+            person_postings_push(&index->roles[role], person, movie);
+        }
+        p = *end ? end + 1 : end;
+    }
+}
+
+void person_index_add_movie(PersonIndex *index, size_t movie_index, const char *directors, const char *cast) {
+    if (!index) return;
+    person_index_add_field(index, PERSON_ROLE_DIRECTOR, (uint32_t)movie_index, directors);
+    person_index_add_field(index, PERSON_ROLE_CAST, (uint32_t)movie_index, cast);
+}
+
+/* Counting sort of the pending keys into the CSR arrays. */
+static void person_postings_build_base(PersonPostings *postings, size_t person_count) {
+    size_t *offsets = (size_t *)calloc(person_count + 1, sizeof(size_t));
+    if (!offsets) {
+        fprintf(stderr, "Error: Out of memory while building person index\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < postings->pending_count; ++i) {
+        offsets[(postings->pending[i] >> 32) + 1]++;
+    }
+    for (size_t p = 0; p < person_count; ++p) {
+        offsets[p + 1] += offsets[p];
+    }
+    /* Keys arrive in movie order, so each person's list comes out ascending. */
+    uint32_t *sorted = (uint32_t *)checked_malloc((postings->pending_count > 0 ? postings->pending_count : 1) * sizeof(uint32_t));
+    size_t *cursor = (size_t *)checked_malloc((person_count > 0 ? person_count : 1) * sizeof(size_t));
+    if (person_count > 0) memcpy(cursor, offsets, person_count * sizeof(size_t));
+    for (size_t i = 0; i < postings->pending_count; ++i) {
+        uint64_t key = postings->pending[i];
+        sorted[cursor[key >> 32]++] = (uint32_t)key;
+    }
+
+    /* A name listed twice in one field leaves adjacent duplicates; keep one. */
+    size_t out = 0;
+    for (size_t p = 0; p < person_count; ++p) {
+        size_t first = offsets[p];
+        offsets[p] = out;
+        for (size_t i = first; i < cursor[p]; ++i) {
+            if (out > offsets[p] && sorted[out - 1] == sorted[i]) continue;
+            sorted[out++] = sorted[i];
+        }
+    }
+    offsets[person_count] = out;
+    free(cursor);
+
+    postings->offsets = offsets;
+    postings->postings = sorted;
+    postings->base_people = person_count;
+}
+
+static int compare_key(const void *lhs, const void *rhs) {
+    uint64_t a = *(const uint64_t *)lhs;
+    uint64_t b = *(const uint64_t *)rhs;
+    return (a > b) - (a < b);
+}
+
+static void *copy_array(const void *data, size_t bytes) {
+    void *copy = checked_malloc(bytes > 0 ? bytes : 1);
+    if (bytes > 0) memcpy(copy, data, bytes);
+    return copy;
+}
+
+/* Copy the arrays a snapshot lent the postings, so the delta can be rewritten. */
+static void person_postings_take_ownership(PersonPostings *postings) {
+    if (postings->offsets) {
+        size_t base_count = postings->offsets[postings->base_people];
+        postings->offsets = (size_t *)copy_array(postings->offsets, (postings->base_people + 1) * sizeof(size_t));
+        postings->postings = (uint32_t *)copy_array(postings->postings, base_count * sizeof(uint32_t));
+    }
+    postings->delta = (uint64_t *)copy_array(postings->delta, postings->delta_count * sizeof(uint64_t));
+    postings->borrowed = 0;
+}
+
+/* Sort the pending keys and merge them into the delta, dropping duplicates. */
+static void person_postings_merge_delta(PersonPostings *postings) {
+    qsort(postings->pending, postings->pending_count, sizeof(uint64_t), compare_key);
+    uint64_t *merged = (uint64_t *)checked_malloc((postings->delta_count + postings->pending_count) * sizeof(uint64_t));
+    size_t i = 0;
+    size_t j = 0;
+    size_t out = 0;
+    while (i < postings->delta_count || j < postings->pending_count) {
+        uint64_t key;
+        if (j == postings->pending_count || (i < postings->delta_count && postings->delta[i] <= postings->pending[j])) {
+            key = postings->delta[i++];
+        } else {
+            key = postings->pending[j++];
+        }
+        if (out == 0 || merged[out - 1] != key) merged[out++] = key;
+    }
+    free(postings->delta);
+    postings->delta = merged;
+    postings->delta_count = out;
+}
+
+void person_index_finish(PersonIndex *index) {
+    if (!index) return;
+    for (size_t r = 0; r < PERSON_ROLE_COUNT; ++r) {
+        PersonPostings *postings = &index->roles[r];
+        if (postings->borrowed && postings->pending_count > 0) person_postings_take_ownership(postings);
+        if (!postings->offsets) {
+            person_postings_build_base(postings, index->names.count);
+        } else if (postings->pending_count > 0) {
+            person_postings_merge_delta(postings);
+        }
+        free(postings->pending);
+        postings->pending = NULL;
+        postings->pending_count = 0;
+        postings->pending_capacity = 0;
+    }
+    for (size_t id = index->name_text.count; id < index->names.count; ++id) {
+        text_blob_add(&index->name_text, index->names.names[id]);
+    }
+}
+
+uint32_t person_index_find(const PersonIndex *index, const char *name_lower) {
+    if (!index) return COLUMNS_NOT_FOUND;
+    return string_dictionary_find(&index->names, name_lower);
+}
+
+/* First delta key of person, and how many follow it. */
+static size_t person_postings_delta_range(const PersonPostings *postings, uint32_t person, size_t *out_count) {
+    size_t lo = 0;
+    size_t hi = postings->delta_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((postings->delta[mid] >> 32) < person) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t end = lo;
+    while (end < postings->delta_count && (postings->delta[end] >> 32) == person) end++;
+    *out_count = end - lo;
+    return lo;
+}
+
+size_t person_index_posting_count(const PersonIndex *index, uint32_t person, PersonRole role) {
+    if (!index || person >= index->names.count || role >= PERSON_ROLE_COUNT) return 0;
+    const PersonPostings *postings = &index->roles[role];
+    size_t count = 0;
+    if (postings->offsets && person < postings->base_people) {
+        count = postings->offsets[person + 1] - postings->offsets[person];
+    }
+    size_t delta_count = 0;
+    person_postings_delta_range(postings, person, &delta_count);
+    return count + delta_count;
+}
+
+int person_index_collect(const PersonIndex *index, uint32_t person, PersonRole role,
+                         size_t **buffer, size_t *count, size_t *capacity) {
+    size_t total = person_index_posting_count(index, person, role);
+    if (total == 0) return 1;
+    if (*count + total > *capacity) {
+        size_t new_capacity = *capacity == 0 ? 16 : *capacity;
+        while (new_capacity < *count + total) new_capacity *= 2;
+        size_t *grown = (size_t *)realloc(*buffer, new_capacity * sizeof(size_t));
+        if (!grown) return 0;
+        *buffer = grown;
+        *capacity = new_capacity;
+    }
+
+    /* Appended movies come after every base movie, so base then delta stays ascending. */
+    const PersonPostings *postings = &index->roles[role];
+    if (postings->offsets && person < postings->base_people) {
+        for (size_t i = postings->offsets[person]; i < postings->offsets[person + 1]; ++i) {
+            (*buffer)[(*count)++] = postings->postings[i];
+        }
+    }
+    size_t delta_count = 0;
+    size_t first = person_postings_delta_range(postings, person, &delta_count);
+    for (size_t i = 0; i < delta_count; ++i) {
+        (*buffer)[(*count)++] = (uint32_t)postings->delta[first + i];
+    }
+    return 1;
+}
+
+void person_index_postings(const PersonIndex *index, uint32_t person, PersonRole role, PersonPostingRuns *out) {
+    if (!out) return;
+    out->base = NULL;
+    out->base_count = 0;
+    out->delta = NULL;
+    out->delta_count = 0;
+    if (!index || person >= index->names.count || role >= PERSON_ROLE_COUNT) return;
+    const PersonPostings *postings = &index->roles[role];
+    if (postings->offsets && person < postings->base_people) {
+        out->base = postings->postings + postings->offsets[person];
+        out->base_count = postings->offsets[person + 1] - postings->offsets[person];
+    }
+    size_t first = person_postings_delta_range(postings, person, &out->delta_count);
+    if (out->delta_count > 0) out->delta = postings->delta + first;
+}
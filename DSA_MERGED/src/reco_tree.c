@@ -15,17 +15,17 @@ void reco_tree_free(RecommendationTree *rt) {
     rt->source_index = 0;
 }
 
-int reco_tree_update_from_source(RecommendationTree *rt, const MovieDatabase *db, size_t source_index, size_t topn) {
+int reco_tree_update_from_source(RecommendationTree *rt, const MovieDatabase *db, const NeighborGraph *graph,
+                                 size_t source_index, size_t topn, size_t threads) {
     if (!rt || !db || source_index >= db->count) return 0;
     Recommendation *list = NULL;
     size_t count = 0;
-    if (!recommendation_generate(db, source_index, &list, &count)) {
+    if (!recommendation_lookup(db, graph, source_index, topn == 0 ? db->count : topn, threads, &list, &count)) {
         free(list);
         return 0;
     }
-    if (topn == 0 || topn > count) topn = count;
-    /* Insert topn recommendations into splay tree; splay on each insert so most-recent high-score moves near root */
-    for (size_t i = 0; i < topn; ++i) {
+    /* Insert the recommendations into splay tree; splay on each insert so most-recent high-score moves near root */
+    for (size_t i = 0; i < count; ++i) {
         splay_insert(&rt->tree, list[i].score, list[i].movie_index);
     }
     rt->has_source = 1;
@@ -1,9 +1,22 @@
 #include "recommendation.h"
 
+#include <ctype.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "parallel.h"
+
+/* AVX2 is compiled per function and only run when CPUID reports it, as in substring.c. */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && GENRE_SET_WORDS == 2
+#define RECO_AVX2 1
+#include <immintrin.h>
+#endif
+
+/* Movies scored per kernel call by the scans. */
+#define RECO_BLOCK 256
+
 static int genre_overlap_count(const Movie *a, const Movie *b) {
     int count = 0;
     for (size_t i = 0; i < a->genre_count; ++i) {
@@ -17,57 +30,773 @@ static int genre_overlap_count(const Movie *a, const Movie *b) {
     return count;
 }
 
-static int recommendation_compare(const void *lhs, const void *rhs) {
-    const Recommendation *a = (const Recommendation *)lhs;
-    const Recommendation *b = (const Recommendation *)rhs;
-    if (a->score != b->score) return (b->score - a->score);
-    if (a->genre_overlap != b->genre_overlap) return (b->genre_overlap - a->genre_overlap);
-    if (a->director_match != b->director_match) return (b->director_match - a->director_match);
-    return (a->year_diff - b->year_diff);
+/*
+ * Ranking packed into one integer, larger is better: score (biased to be
+ * unsigned), then genre overlap, then director match, then the inverted
+ * year difference. Comparing two candidates is a single compare.
+ */
+#define RECO_OVERLAP_BITS 12
+#define RECO_YEAR_BITS 19
+#define RECO_OVERLAP_MAX ((1u << RECO_OVERLAP_BITS) - 1)
+#define RECO_YEAR_MAX ((1u << RECO_YEAR_BITS) - 1)
+
+static uint64_t recommendation_key(int score, int overlap, int director_match, int year_diff) {
+    uint64_t biased = (uint64_t)((int64_t)score - (int64_t)INT32_MIN);
+    uint64_t genres = (uint64_t)(overlap > (int)RECO_OVERLAP_MAX ? RECO_OVERLAP_MAX : (unsigned)overlap);
+    uint64_t years = (uint64_t)(year_diff > (int)RECO_YEAR_MAX ? RECO_YEAR_MAX : (unsigned)year_diff);
+    return biased << 32 | genres << (RECO_YEAR_BITS + 1) | (uint64_t)(director_match != 0) << RECO_YEAR_BITS |
+           (RECO_YEAR_MAX - years);
+}
+
+uint64_t recommendation_key_pack(const Recommendation *r) {
+    return recommendation_key(r->score, r->genre_overlap, r->director_match, r->year_diff);
+}
+
+void recommendation_key_unpack(uint64_t key, size_t movie_index, Recommendation *out) {
+    out->movie_index = movie_index;
+    out->score = (int)((int64_t)(key >> 32) + (int64_t)INT32_MIN);
+    out->genre_overlap = (int)((key >> (RECO_YEAR_BITS + 1)) & RECO_OVERLAP_MAX);
+    out->director_match = (int)((key >> RECO_YEAR_BITS) & 1u);
+    out->year_diff = (int)(RECO_YEAR_MAX - (key & RECO_YEAR_MAX));
+}
+
+typedef struct {
+    uint64_t key;
+    size_t movie_index;
+} RankedMovie;
+
+/* Among equal keys the higher movie index ranks lower, whatever order movies are offered in. */
+static int ranked_worse(const RankedMovie *a, const RankedMovie *b) {
+    return a->key < b->key || (a->key == b->key && a->movie_index > b->movie_index);
+}
+
+/* Restore the min-heap (worst on top) below slot i. */
+static void ranked_sift_down(RankedMovie *heap, size_t count, size_t i) {
+    RankedMovie item = heap[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= count) break;
+        if (child + 1 < count && ranked_worse(&heap[child + 1], &heap[child])) child++;
+        if (!ranked_worse(&heap[child], &item)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = item;
+}
+
+static void ranked_sift_up(RankedMovie *heap, size_t i) {
+    RankedMovie item = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!ranked_worse(&item, &heap[parent])) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = item;
 }
 
 int recommendation_generate(const MovieDatabase *db, size_t source_index, Recommendation **out_list, size_t *out_count) {
+    if (!db) {
+        if (out_list) *out_list = NULL;
+        if (out_count) *out_count = 0;
+        return 0;
+    }
+    return recommendation_generate_top(db, source_index, db->count, out_list, out_count);
+}
+
+int recommendation_generate_parallel(const MovieDatabase *db, size_t source_index, size_t threads,
+                                     Recommendation **out_list, size_t *out_count) {
+    if (!db) {
+        if (out_list) *out_list = NULL;
+        if (out_count) *out_count = 0;
+        return 0;
+    }
+    return recommendation_generate_top_parallel(db, source_index, db->count, threads, out_list, out_count);
+}
+
+/* A bounded min-heap of the k best so far; the root is the one to beat. */
+typedef struct {
+    RankedMovie *heap;
+    size_t count;
+    size_t k;
+} RankedTop;
+
+static void ranked_offer(RankedTop *top, uint64_t key, size_t movie_index) {
+    if (top->count < top->k) {
+        top->heap[top->count].key = key;
+        top->heap[top->count].movie_index = movie_index;
+        ranked_sift_up(top->heap, top->count++);
+    } else if (key > top->heap[0].key || (key == top->heap[0].key && movie_index < top->heap[0].movie_index)) {
+        top->heap[0].key = key;
+        top->heap[0].movie_index = movie_index;
+        ranked_sift_down(top->heap, top->count, 0);
+    }
+}
+
+/* Whether nothing scoring at most score can enter any more. */
+static int ranked_closed_above(const RankedTop *top, int score) {
+    if (top->count < top->k) return 0;
+    return (int64_t)(top->heap[0].key >> 32) + (int64_t)INT32_MIN > (int64_t)score;
+}
+
+/* What every candidate is scored against. */
+typedef struct {
+    const MovieDatabase *db;
+    const Movie *movie;
+    size_t index;
+    const GenreSet *genres;
+    uint32_t director;
+    int year;
+} RecoSource;
+
+static void reco_source_init(RecoSource *source, const MovieDatabase *db, size_t source_index) {
+    const MovieColumns *columns = &db->columns;
+    source->db = db;
+    source->movie = &db->movies[source_index];
+    source->index = source_index;
+    source->genres = &columns->genre_set[source_index];
+    source->director = columns->director_id[source_index];
+    source->year = columns->release_year[source_index];
+}
+
+/* Packed key of movie i against the source; *related is set when it shares a genre or the director. */
+static uint64_t reco_score(const RecoSource *source, size_t i, int *related) {
+    const MovieColumns *columns = &source->db->columns;
+    /* Score from the column store; strings are only compared when genres overflow the set. */
+    int overlap = columns->genre_overflow
+        ? genre_overlap_count(source->movie, &source->db->movies[i])
+        : genre_set_overlap(source->genres, &columns->genre_set[i]);
+    int director_match = source->director != COLUMNS_NO_DIRECTOR && columns->director_id[i] == source->director;
+    int candidate_year = columns->release_year[i];
+    int year_diff;
+    if (source->year > 0 && candidate_year > 0) {
+        year_diff = abs(source->year - candidate_year);
+    } else {
+        year_diff = 1000;
+    }
+    int score = overlap * 100 + (director_match ? 50 : 0) - year_diff;
+    if (related) *related = overlap > 0 || director_match;
+    return recommendation_key(score, overlap, director_match, year_diff);
+}
+
+/* ---- scoring kernels ---- */
+
+typedef void (*RecoScoreFn)(const RecoSource *source, size_t begin, size_t count, uint64_t *keys);
+
+static void score_block_scalar(const RecoSource *source, size_t begin, size_t count, uint64_t *keys) {
+    for (size_t j = 0; j < count; ++j) keys[j] = reco_score(source, begin + j, NULL);
+}
+
+#ifdef RECO_AVX2
+/*
+ * Eight movies per step straight from the columns: genre overlap is a
+ * popcount of the ANDed masks (nibble lookup, then a byte sum per movie),
+ * and the director bonus and year difference are lane compares, so there is
+ * no branch per movie. Packs the same key as recommendation_key. Genre sets
+ * must be complete (no genre_overflow).
+ */
+__attribute__((target("avx2")))
+static void score_block_avx2(const RecoSource *source, size_t begin, size_t count, uint64_t *keys) {
+    const MovieColumns *columns = &source->db->columns;
+    const __m256i genres = _mm256_set_epi64x((long long)source->genres->words[1], (long long)source->genres->words[0],
+                                             (long long)source->genres->words[1], (long long)source->genres->words[0]);
+    const __m256i nibble_bits = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+    const __m256i first_dword = _mm256_setr_epi32(-1, 0, 0, 0, -1, 0, 0, 0);
+    const __m256i movie_order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i hundred = _mm256_set1_epi32(100);
+    /* No director or no year on the source side means no match and 1000 years for every movie. */
+    const __m256i director = _mm256_set1_epi32((int)source->director);
+    const __m256i bonus = _mm256_set1_epi32(source->director != COLUMNS_NO_DIRECTOR ? 50 : 0);
+    const __m256i director_bit = _mm256_set1_epi32(source->director != COLUMNS_NO_DIRECTOR ? 1 << RECO_YEAR_BITS : 0);
+    const __m256i year = _mm256_set1_epi32(source->year);
+    const __m256i unknown_diff = _mm256_set1_epi32(1000);
+    const __m256i year_max = _mm256_set1_epi32((int)RECO_YEAR_MAX);
+    const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+    const int source_dated = source->year > 0;
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        size_t i = begin + j;
+        /* Two movies per register; each 128-bit half ends up holding its movie's count in the low dword. */
+        __m256i overlap = zero;
+        for (int pair = 0; pair < 4; ++pair) {
+            __m256i shared = _mm256_and_si256(
+                _mm256_loadu_si256((const __m256i *)(const void *)&columns->genre_set[i + 2 * (size_t)pair]), genres);
+            __m256i bits = _mm256_add_epi8(
+                _mm256_shuffle_epi8(nibble_bits, _mm256_and_si256(shared, low_nibble)),
+                _mm256_shuffle_epi8(nibble_bits, _mm256_and_si256(_mm256_srli_epi16(shared, 4), low_nibble)));
+            __m256i sums = _mm256_sad_epu8(bits, zero);
+            sums = _mm256_and_si256(_mm256_add_epi64(sums, _mm256_srli_si256(sums, 8)), first_dword);
+            switch (pair) {
+            case 0: overlap = sums; break;
+            case 1: overlap = _mm256_or_si256(overlap, _mm256_slli_si256(sums, 4)); break;
+            case 2: overlap = _mm256_or_si256(overlap, _mm256_slli_si256(sums, 8)); break;
+            default: overlap = _mm256_or_si256(overlap, _mm256_slli_si256(sums, 12)); break;
+            }
+        }
+        /* Dwords hold movies 0 2 4 6 | 1 3 5 7; put them back in order. */
+        overlap = _mm256_permutevar8x32_epi32(overlap, movie_order);
+
+        __m256i match = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(const void *)&columns->director_id[i]), director);
+        __m256i years = _mm256_loadu_si256((const __m256i *)(const void *)&columns->release_year[i]);
+        __m256i diff = unknown_diff;
+        if (source_dated) {
+            __m256i dated = _mm256_cmpgt_epi32(years, zero);
+            diff = _mm256_blendv_epi8(unknown_diff, _mm256_abs_epi32(_mm256_sub_epi32(year, years)), dated);
+        }
+        __m256i score = _mm256_sub_epi32(
+            _mm256_add_epi32(_mm256_mullo_epi32(overlap, hundred), _mm256_and_si256(match, bonus)), diff);
+        __m256i low = _mm256_or_si256(
+            _mm256_or_si256(_mm256_slli_epi32(overlap, RECO_YEAR_BITS + 1), _mm256_and_si256(match, director_bit)),
+            _mm256_sub_epi32(year_max, _mm256_min_epi32(diff, year_max)));
+        __m256i high = _mm256_xor_si256(score, sign);
+        __m256i first = _mm256_unpacklo_epi32(low, high);  /* keys 0 1 | 4 5 */
+        __m256i second = _mm256_unpackhi_epi32(low, high); /* keys 2 3 | 6 7 */
+        _mm256_storeu_si256((__m256i *)(void *)&keys[j], _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i *)(void *)&keys[j + 4], _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    score_block_scalar(source, begin + j, count - j, keys + j);
+}
+#endif
+
+static RecommendationKernel active_kernel = RECOMMENDATION_KERNEL_AUTO;
+static RecoScoreFn active_score_fn = NULL;
+
+static int kernel_supported(RecommendationKernel kernel) {
+    switch (kernel) {
+    case RECOMMENDATION_KERNEL_SCALAR:
+        return 1;
+    case RECOMMENDATION_KERNEL_AVX2:
+#ifdef RECO_AVX2
+        return __builtin_cpu_supports("avx2") != 0;
+#else
+        return 0;
+#endif
+    case RECOMMENDATION_KERNEL_AUTO:
+        break;
+    }
+    return 0;
+}
+
+int recommendation_set_kernel(RecommendationKernel kernel) {
+    if (kernel == RECOMMENDATION_KERNEL_AUTO) {
+        kernel = RECOMMENDATION_KERNEL_SCALAR;
+        if (kernel_supported(RECOMMENDATION_KERNEL_AVX2)) kernel = RECOMMENDATION_KERNEL_AVX2;
+    } else if (!kernel_supported(kernel)) {
+        return 0;
+    }
+#ifdef RECO_AVX2
+    active_score_fn = kernel == RECOMMENDATION_KERNEL_AVX2 ? score_block_avx2 : score_block_scalar;
+#else
+    active_score_fn = score_block_scalar;
+#endif
+    active_kernel = kernel;
+    return 1;
+}
+
+RecommendationKernel recommendation_active_kernel(void) {
+    if (!active_score_fn) recommendation_set_kernel(RECOMMENDATION_KERNEL_AUTO);
+    return active_kernel;
+}
+
+const char *recommendation_kernel_name(RecommendationKernel kernel) {
+    switch (kernel) {
+    case RECOMMENDATION_KERNEL_SCALAR:
+        return "scalar";
+    case RECOMMENDATION_KERNEL_AVX2:
+        return "avx2";
+    case RECOMMENDATION_KERNEL_AUTO:
+        break;
+    }
+    return "auto";
+}
+
+/* Keys of movies [begin, begin + count) with the active kernel; strings need the scalar path. */
+static void score_block(const RecoSource *source, size_t begin, size_t count, uint64_t *keys) {
+    /* The dispatch is idempotent, so threads racing here store the same pointer. */
+    if (!active_score_fn) recommendation_set_kernel(RECOMMENDATION_KERNEL_AUTO);
+    if (source->db->columns.genre_overflow) {
+        score_block_scalar(source, begin, count, keys);
+    } else {
+        active_score_fn(source, begin, count, keys);
+    }
+}
+
+void recommendation_score_block(const MovieDatabase *db, size_t source_index, size_t begin, size_t count,
+                                uint64_t *keys) {
+    if (!db || !keys || source_index >= db->count || begin > db->count || count > db->count - begin) return;
+    RecoSource source;
+    reco_source_init(&source, db, source_index);
+    score_block(&source, begin, count, keys);
+}
+
+/* Movies [begin, end), a kernel block at a time. */
+static void rank_range(const RecoSource *source, RankedTop *top, size_t begin, size_t end) {
+    uint64_t keys[RECO_BLOCK];
+    for (size_t at = begin; at < end; at += RECO_BLOCK) {
+        size_t count = end - at < RECO_BLOCK ? end - at : RECO_BLOCK;
+        score_block(source, at, count, keys);
+        for (size_t j = 0; j < count; ++j) {
+            if (at + j != source->index) ranked_offer(top, keys[j], at + j);
+        }
+    }
+}
+
+/* Every movie, in index order. */
+static void rank_all(const RecoSource *source, RankedTop *top) {
+    rank_range(source, top, 0, source->db->count);
+}
+
+/* One ascending posting list being merged: a genre's movies, or the director's. */
+typedef struct {
+    ResultSetIterator it;          /* genre lists */
+    PersonPostingRuns runs;        /* the director's list */
+    int is_person;
+    size_t buffer[64];
+    size_t length;
+    size_t position;
+} CandidateStream;
+
+/* The stream's next movie, or SIZE_MAX once it is exhausted. */
+static size_t candidate_head(CandidateStream *stream) {
+    if (stream->position == stream->length) {
+        stream->position = 0;
+        stream->length = 0;
+        if (!stream->is_person) {
+            stream->length = result_set_iterator_next(&stream->it, stream->buffer, 64);
+        } else {
+            PersonPostingRuns *runs = &stream->runs;
+            while (stream->length < 64 && (runs->base_count > 0 || runs->delta_count > 0)) {
+                if (runs->base_count > 0) {
+                    stream->buffer[stream->length++] = *runs->base++;
+                    runs->base_count--;
+                } else {
+                    stream->buffer[stream->length++] = (size_t)(uint32_t)*runs->delta++;
+                    runs->delta_count--;
+                }
+            }
+        }
+        if (stream->length == 0) return SIZE_MAX;
+    }
+    return stream->buffer[stream->position];
+}
+
+/*
+ * The person index id of the source's first director, or COLUMNS_NOT_FOUND.
+ * Every movie with the same director field lists that person too.
+ */
+static uint32_t reco_first_director(const RecoSource *source) {
+    const char *name = source->movie->director_lower;
+    while (isspace((unsigned char)*name)) name++;
+    size_t len = strcspn(name, ",");
+    while (len > 0 && isspace((unsigned char)name[len - 1])) len--;
+    char first[256];
+    if (len == 0 || len >= sizeof(first)) return COLUMNS_NOT_FOUND;
+    memcpy(first, name, len);
+    first[len] = '\0';
+    return person_index_find(&source->db->people, first);
+}
+
+/*
+ * Score the movies sharing a genre or the director with the source: the
+ * union of the source's genre lists and its first director's list, merged
+ * in index order. Returns 0 when the lists cannot be found, so that the
+ * caller ranks everything instead.
+ */
+static int rank_candidates(const RecoSource *source, RankedTop *top) {
+    const MovieColumns *columns = &source->db->columns;
+    const Movie *movie = source->movie;
+    size_t stream_count = movie->genre_count + 1;
+    CandidateStream *streams = (CandidateStream *)malloc(stream_count * sizeof(CandidateStream));
+    if (!streams) return 0;
+    size_t used = 0;
+    for (size_t g = 0; g < movie->genre_count; ++g) {
+        uint32_t id = string_dictionary_find(&columns->genres, movie->genres[g]);
+        if (id == COLUMNS_NOT_FOUND || id >= columns->genre_movies_count) {
+            free(streams);
+            return 0;
+        }
+        result_set_iterator_init(&streams[used].it, &columns->genre_movies[id]);
+        streams[used].is_person = 0;
+        streams[used].length = 0;
+        streams[used].position = 0;
+        used++;
+    }
+    if (source->director != COLUMNS_NO_DIRECTOR) {
+        uint32_t person = reco_first_director(source);
+        if (person == COLUMNS_NOT_FOUND) {
+            free(streams);
+            return 0;
+        }
+        person_index_postings(&source->db->people, person, PERSON_ROLE_DIRECTOR, &streams[used].runs);
+        streams[used].is_person = 1;
+        streams[used].length = 0;
+        streams[used].position = 0;
+        used++;
+    }
+
+    for (;;) {
+        size_t next = SIZE_MAX;
+        for (size_t s = 0; s < used; ++s) {
+            size_t head = candidate_head(&streams[s]);
+            if (head < next) next = head;
+        }
+        if (next == SIZE_MAX) break;
+        for (size_t s = 0; s < used; ++s) {
+            if (streams[s].position < streams[s].length && streams[s].buffer[streams[s].position] == next) {
+                streams[s].position++;
+            }
+        }
+        if (next == source->index || next >= source->db->count) continue;
+        /* Co-directed movies can share the first director without matching; the fill pass takes them. */
+        int related;
+        uint64_t key = reco_score(source, next, &related);
+        if (related) ranked_offer(top, key, next);
+    }
+    free(streams);
+    return 1;
+}
+
+static void rank_unrelated_in(const RecoSource *source, RankedTop *top, const ResultSet *set) {
+    ResultSetIterator it;
+    size_t batch[64];
+    size_t got;
+    result_set_iterator_init(&it, set);
+    while ((got = result_set_iterator_next(&it, batch, 64)) > 0) {
+        for (size_t b = 0; b < got; ++b) {
+            int related;
+            uint64_t key = reco_score(source, batch[b], &related);
+            if (!related && batch[b] != source->index) ranked_offer(top, key, batch[b]);
+        }
+    }
+}
+
+/*
+ * Fill in the movies sharing nothing with the source. They score
+ * -year_diff, so they are visited by year outward from the source's
+ * release year, and only until none of them could still place.
+ */
+static void rank_unrelated(const RecoSource *source, RankedTop *top) {
+    const MovieColumns *columns = &source->db->columns;
+    if (ranked_closed_above(top, 0)) return;
+    if (source->year <= 0) {
+        /* Every year difference is 1000; no order to exploit. */
+        if (ranked_closed_above(top, -1000)) return;
+        uint64_t keys[RECO_BLOCK];
+        for (size_t at = 0; at < source->db->count; at += RECO_BLOCK) {
+            size_t count = source->db->count - at < RECO_BLOCK ? source->db->count - at : RECO_BLOCK;
+            score_block(source, at, count, keys);
+            for (size_t j = 0; j < count; ++j) {
+                /* Unrelated: no genre overlap and no director bit in the key. */
+                int related = ((keys[j] >> RECO_YEAR_BITS) & ((uint64_t)RECO_OVERLAP_MAX << 1 | 1u)) != 0;
+                if (!related && at + j != source->index) ranked_offer(top, keys[j], at + j);
+            }
+        }
+        return;
+    }
+
+    int first = columns->year_first;
+    int last = columns->year_first + (int)columns->year_span - 1;
+    int reach = columns->year_span == 0 ? -1 : (source->year - first > last - source->year ? source->year - first : last - source->year);
+    int unknown_done = 0;
+    for (int diff = 0; diff <= reach || !unknown_done; ++diff) {
+        if (diff >= 1000 && !unknown_done) {
+            /* Movies without a release year count as 1000 years away. */
+            if (ranked_closed_above(top, -1000)) return;
+            for (size_t i = 0; i < source->db->count; ++i) {
+                if (columns->release_year[i] > 0) continue;
+                int related;
+                uint64_t key = reco_score(source, i, &related);
+                if (!related && i != source->index) ranked_offer(top, key, i);
+            }
+            unknown_done = 1;
+        }
+        if (diff > reach) continue;
+        if (ranked_closed_above(top, -diff)) return;
+        int below = source->year - diff;
+        int above = source->year + diff;
+        if (below >= first && below <= last) rank_unrelated_in(source, top, &columns->year_movies[below - first]);
+        if (diff > 0 && above >= first && above <= last) rank_unrelated_in(source, top, &columns->year_movies[above - first]);
+    }
+}
+
+/* Score the movies of set against the source, skipping the director's (already offered). */
+static void rank_set_without_director(const RecoSource *source, RankedTop *top, const ResultSet *set) {
+    const MovieColumns *columns = &source->db->columns;
+    ResultSetIterator it;
+    size_t batch[64];
+    size_t got;
+    result_set_iterator_init(&it, set);
+    while ((got = result_set_iterator_next(&it, batch, 64)) > 0) {
+        for (size_t b = 0; b < got; ++b) {
+            size_t i = batch[b];
+            if (i == source->index) continue;
+            if (source->director != COLUMNS_NO_DIRECTOR && columns->director_id[i] == source->director) continue;
+            ranked_offer(top, reco_score(source, i, NULL), i);
+        }
+    }
+}
+
+/*
+ * Fast path for a source with a release year and G genres: offer the
+ * director's movies, then the movies sharing all G genres (the AND of the
+ * genre lists) year by year outward. Unvisited movies of that tier score at
+ * most G * 100 - year_diff and every other movie at most (G - 1) * 100, so
+ * once the k-th best beats both bounds the result is exact. Returns 0 when
+ * it is not, leaving the caller to rank from scratch.
+ */
+static int rank_best_tier(const RecoSource *source, RankedTop *top) {
+    const MovieColumns *columns = &source->db->columns;
+    const Movie *movie = source->movie;
+    if (source->year <= 0 || columns->genre_overflow || columns->year_span == 0) return 0;
+    int genres = 0;
+    for (size_t w = 0; w < GENRE_SET_WORDS; ++w) genres += columns_popcount64(source->genres->words[w]);
+    if (genres == 0) return 0;
+
+    if (source->director != COLUMNS_NO_DIRECTOR) {
+        uint32_t person = reco_first_director(source);
+        if (person == COLUMNS_NOT_FOUND) return 0;
+        PersonPostingRuns runs;
+        person_index_postings(&source->db->people, person, PERSON_ROLE_DIRECTOR, &runs);
+        while (runs.base_count > 0 || runs.delta_count > 0) {
+            size_t i;
+            if (runs.base_count > 0) {
+                i = *runs.base++;
+                runs.base_count--;
+            } else {
+                i = (size_t)(uint32_t)*runs.delta++;
+                runs.delta_count--;
+            }
+            if (i != source->index && i < source->db->count && columns->director_id[i] == source->director) {
+                ranked_offer(top, reco_score(source, i, NULL), i);
+            }
+        }
+    }
+
+    ResultSet tier;
+    ResultSet scratch;
+    result_set_init(&tier);
+    result_set_init(&scratch);
+    int started = 0;
+    for (size_t g = 0; g < movie->genre_count; ++g) {
+        uint32_t id = string_dictionary_find(&columns->genres, movie->genres[g]);
+        if (id == COLUMNS_NOT_FOUND || id >= columns->genre_movies_count) {
+            result_set_free(&tier);
+            result_set_free(&scratch);
+            return 0;
+        }
+        if (!started) {
+            result_set_copy(&tier, &columns->genre_movies[id]);
+            started = 1;
+        } else {
+            result_set_and(&scratch, &tier, &columns->genre_movies[id]);
+            ResultSet swap = tier;
+            tier = scratch;
+            scratch = swap;
+        }
+    }
+
+    if (top->count + result_set_cardinality(&tier) < top->k) {
+        /* Cannot fill the k places, so cannot prove anything either. */
+        result_set_free(&tier);
+        result_set_free(&scratch);
+        return 0;
+    }
+
+    int first = columns->year_first;
+    int last = columns->year_first + (int)columns->year_span - 1;
+    int reach = source->year - first > last - source->year ? source->year - first : last - source->year;
+    int rest = (genres - 1) * 100;
+    int closed = 0;
+    for (int diff = 0;; ++diff) {
+        int bound = genres * 100 - (diff <= reach ? diff : 1000);
+        if (ranked_closed_above(top, bound > rest ? bound : rest)) {
+            closed = 1;
+            break;
+        }
+        if (diff > reach) break;
+        int below = source->year - diff;
+        int above = source->year + diff;
+        if (below >= first && below <= last) {
+            result_set_and(&scratch, &tier, &columns->year_movies[below - first]);
+            rank_set_without_director(source, top, &scratch);
+        }
+        if (diff > 0 && above >= first && above <= last) {
+            result_set_and(&scratch, &tier, &columns->year_movies[above - first]);
+            rank_set_without_director(source, top, &scratch);
+        }
+    }
+    result_set_free(&tier);
+    result_set_free(&scratch);
+    return closed;
+}
+
+/* One worker's slice of the catalog and the best of it. */
+typedef struct {
+    const RecoSource *source;
+    RankedTop *tops; /* one per worker */
+} RecoScan;
+
+/* Rank a contiguous slice, then sort the survivors best first in place. */
+static void reco_scan_task(void *ctx, size_t worker, size_t workers) {
+    RecoScan *scan = (RecoScan *)ctx;
+    RankedTop *top = &scan->tops[worker];
+    size_t count = scan->source->db->count;
+    size_t begin = count / workers * worker + (worker < count % workers ? worker : count % workers);
+    size_t end = begin + count / workers + (worker < count % workers ? 1 : 0);
+    rank_range(scan->source, top, begin, end);
+    for (size_t n = top->count; n > 1; --n) {
+        RankedMovie worst = top->heap[0];
+        top->heap[0] = top->heap[n - 1];
+        top->heap[n - 1] = worst;
+        ranked_sift_down(top->heap, n - 1, 0);
+    }
+}
+
+/*
+ * rank_all on threads workers, each keeping the best of a contiguous slice
+ * in its own heap, merged into list best first. The ranking is a total
+ * order (key, then index), so the merge gives exactly the serial result
+ * whatever the split. Returns 0 when the heaps cannot be allocated.
+ */
+static int rank_all_parallel(const RecoSource *source, size_t k, size_t threads, Recommendation *list, size_t *count) {
+    size_t movies = source->db->count;
+    if (threads > movies) threads = movies;
+    RankedTop *tops = (RankedTop *)malloc(threads * sizeof(RankedTop));
+    size_t *heads = (size_t *)calloc(threads, sizeof(size_t));
+    if (!tops || !heads) {
+        free(tops);
+        free(heads);
+        return 0;
+    }
+    size_t w = 0;
+    for (; w < threads; ++w) {
+        /* A worker never keeps more than its slice. */
+        size_t slice = movies / threads + 1;
+        tops[w].k = slice < k ? slice : k;
+        tops[w].count = 0;
+        tops[w].heap = (RankedMovie *)malloc(tops[w].k * sizeof(RankedMovie));
+        if (!tops[w].heap) break;
+    }
+    if (w < threads) {
+        while (w > 0) free(tops[--w].heap);
+        free(tops);
+        free(heads);
+        return 0;
+    }
+    RecoScan scan = {source, tops};
+    parallel_run(threads, reco_scan_task, &scan);
+
+    size_t taken = 0;
+    while (taken < k) {
+        const RankedMovie *best = NULL;
+        size_t from = 0;
+        for (w = 0; w < threads; ++w) {
+            if (heads[w] == tops[w].count) continue;
+            const RankedMovie *head = &tops[w].heap[heads[w]];
+            if (!best || ranked_worse(best, head)) {
+                best = head;
+                from = w;
+            }
+        }
+        if (!best) break;
+        recommendation_key_unpack(best->key, best->movie_index, &list[taken++]);
+        heads[from]++;
+    }
+    for (w = 0; w < threads; ++w) free(tops[w].heap);
+    free(tops);
+    free(heads);
+    *count = taken;
+    return 1;
+}
+
+int recommendation_generate_top(const MovieDatabase *db, size_t source_index, size_t k, Recommendation **out_list,
+                                size_t *out_count) {
+    return recommendation_generate_top_parallel(db, source_index, k, 1, out_list, out_count);
+}
+
+int recommendation_generate_top_parallel(const MovieDatabase *db, size_t source_index, size_t k, size_t threads,
+                                         Recommendation **out_list, size_t *out_count) {
     if (out_list) *out_list = NULL;
     if (out_count) *out_count = 0;
     if (!db || !out_list || !out_count || source_index >= db->count) return 0;
-    if (db->count <= 1) return 0;
+    if (db->count <= 1 || k == 0) return 0;
+    if (k > db->count - 1) k = db->count - 1;
 
-    const Movie *source = &db->movies[source_index];
-    Recommendation *list = (Recommendation *)malloc((db->count - 1) * sizeof(Recommendation));
-    if (!list) {
+    RankedTop top;
+    top.heap = (RankedMovie *)malloc(k * sizeof(RankedMovie));
+    top.count = 0;
+    top.k = k;
+    Recommendation *list = (Recommendation *)malloc(k * sizeof(Recommendation));
+    if (!top.heap || !list) {
         fprintf(stderr, "Error: Unable to allocate recommendation buffer\n");
+        free(top.heap);
+        free(list);
         return 0;
     }
 
-    size_t count = 0;
-    for (size_t i = 0; i < db->count; ++i) {
-        if (i == source_index) continue;
-        const Movie *candidate = &db->movies[i];
-        int overlap = genre_overlap_count(source, candidate);
-        int director_match = 0;
-        if (source->director_lower && candidate->director_lower &&
-            source->director_lower[0] && candidate->director_lower[0] &&
-            strcmp(source->director_lower, candidate->director_lower) == 0) {
-            director_match = 1;
-        }
-        int year_diff;
-        if (source->release_year_num > 0 && candidate->release_year_num > 0) {
-            year_diff = abs(source->release_year_num - candidate->release_year_num);
+    /*
+     * Related movies score at least 100 - year_diff and the rest exactly
+     * -year_diff, so the k best usually all come from the source's genre and
+     * director lists, and the rest of the catalog is only visited, nearest
+     * years first, while it could still place. Before that, the movies
+     * sharing every genre usually settle it on their own.
+     */
+    RecoSource source;
+    reco_source_init(&source, db, source_index);
+    if (!rank_best_tier(&source, &top)) {
+        top.count = 0;
+        /* Past the fast path the lists rarely prune much, so extra threads just split the catalog. */
+        size_t count = 0;
+        if (threads > 1 && rank_all_parallel(&source, k, threads, list, &count)) {
+            free(top.heap);
+            *out_list = list;
+            *out_count = count;
+            return 1;
+        }
+        if (rank_candidates(&source, &top)) {
+            rank_unrelated(&source, &top);
         } else {
-            year_diff = 1000;
+            rank_all(&source, &top);
         }
-        int score = overlap * 100 + (director_match ? 50 : 0) - year_diff;
+    }
 
-        list[count].movie_index = i;
-        list[count].score = score;
-        list[count].genre_overlap = overlap;
-        list[count].year_diff = year_diff;
-        list[count].director_match = director_match;
-        count++;
+    /* Popping the worst first fills the list from the back. */
+    for (size_t n = top.count; n > 0; --n) {
+        recommendation_key_unpack(top.heap[0].key, top.heap[0].movie_index, &list[n - 1]);
+        top.heap[0] = top.heap[n - 1];
+        ranked_sift_down(top.heap, n - 1, 0);
     }
+    size_t count = top.count;
+    free(top.heap);
 
-    qsort(list, count, sizeof(Recommendation), recommendation_compare);
+    *out_list = list;
+    *out_count = count;
+    return 1;
+}
 
+int recommendation_lookup(const MovieDatabase *db, const NeighborGraph *graph, size_t source_index, size_t k,
+                          size_t threads, Recommendation **out_list, size_t *out_count) {
+    if (!neighbor_graph_covers(graph, db, k) || source_index >= db->count) {
+        return recommendation_generate_top_parallel(db, source_index, k, threads, out_list, out_count);
+    }
+    if (out_list) *out_list = NULL;
+    if (out_count) *out_count = 0;
+    if (!out_list || !out_count || k == 0) return 0;
+    size_t first = (size_t)graph->offsets[source_index];
+    size_t count = (size_t)graph->offsets[source_index + 1] - first;
+    if (count > k) count = k;
+    if (count == 0) return 0;
+    Recommendation *list = (Recommendation *)malloc(count * sizeof(Recommendation));
+    if (!list) {
+        fprintf(stderr, "Error: Unable to allocate recommendation buffer\n");
+        return 0;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        recommendation_key_unpack(graph->keys[first + i], graph->neighbors[first + i], &list[i]);
+    }
     *out_list = list;
     *out_count = count;
     return 1;
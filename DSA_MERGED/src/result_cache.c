@@ -0,0 +1,251 @@
+#include "result_cache.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "casefold.h"
+#include "columns.h"
+
+#define RESULT_CACHE_LINE 1024
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static void set_error(char **error_message, const char *message, const char *path) {
+    if (!error_message) return;
+    size_t len = strlen(message) + strlen(path) + 4;
+    *error_message = (char *)checked_malloc(len);
+    snprintf(*error_message, len, "%s: %s", message, path);
+}
+
+static size_t result_cache_hash(int mode, const char *query) {
+    size_t hash = string_dictionary_hash(query);
+    return hash ^ ((size_t)(unsigned)mode * (size_t)0x9e3779b97f4a7c15ull);
+}
+
+void result_cache_init(ResultCache *cache, size_t max_entries, size_t max_bytes) {
+    if (!cache) return;
+    if (max_entries == 0) max_entries = 1;
+    if (max_entries >= RESULT_CACHE_NONE) max_entries = RESULT_CACHE_NONE - 1;
+    cache->max_entries = max_entries;
+    cache->max_bytes = max_bytes;
+    cache->entries = (ResultCacheEntry *)checked_malloc(max_entries * sizeof(ResultCacheEntry));
+    cache->bucket_count = 16;
+    while (cache->bucket_count < max_entries * 2) cache->bucket_count *= 2;
+    cache->buckets = (uint32_t *)checked_malloc(cache->bucket_count * sizeof(uint32_t));
+    memset(&cache->stats, 0, sizeof(cache->stats));
+    cache->generation = 0;
+    cache->count = 0;
+    cache->bytes = 0;
+    cache->newest = RESULT_CACHE_NONE;
+    cache->oldest = RESULT_CACHE_NONE;
+    cache->free_slot = RESULT_CACHE_NONE;
+    for (size_t i = max_entries; i-- > 0;) {
+        cache->entries[i].query = NULL;
+        cache->entries[i].indices = NULL;
+        cache->entries[i].chain = cache->free_slot;
+        cache->free_slot = (uint32_t)i;
+    }
+    for (size_t b = 0; b < cache->bucket_count; ++b) cache->buckets[b] = RESULT_CACHE_NONE;
+}
+
+void result_cache_clear(ResultCache *cache) {
+    if (!cache || !cache->entries) return;
+    for (uint32_t id = cache->newest; id != RESULT_CACHE_NONE;) {
+        ResultCacheEntry *entry = &cache->entries[id];
+        uint32_t next = entry->older;
+        free(entry->query);
+        free(entry->indices);
+        entry->query = NULL;
+        entry->indices = NULL;
+        entry->chain = cache->free_slot;
+        cache->free_slot = id;
+        id = next;
+    }
+    for (size_t b = 0; b < cache->bucket_count; ++b) cache->buckets[b] = RESULT_CACHE_NONE;
+    cache->count = 0;
+    cache->bytes = 0;
+    cache->newest = RESULT_CACHE_NONE;
+    cache->oldest = RESULT_CACHE_NONE;
+}
+
+void result_cache_free(ResultCache *cache) {
+    if (!cache) return;
+    result_cache_clear(cache);
+    free(cache->entries);
+    free(cache->buckets);
+    cache->entries = NULL;
+    cache->buckets = NULL;
+    cache->max_entries = 0;
+    cache->bucket_count = 0;
+    cache->free_slot = RESULT_CACHE_NONE;
+}
+
+size_t result_cache_normalize(const char *query, char *out, size_t size) {
+    if (!out || size == 0) return 0;
+    size_t len = 0;
+    int pending_space = 0;
+    for (const char *p = query ? query : ""; *p; ++p) {
+        unsigned char c = (unsigned char)*p;
+        if (isspace(c)) {
+            pending_space = len > 0;
+            continue;
+        }
+        if (pending_space && len + 1 < size) out[len++] = ' ';
+        pending_space = 0;
+        if (len + 1 < size) out[len++] = (char)c;
+    }
+    return casefold(out, out, len, CASEFOLD_KEYS);
+}
+
+/* Empty the cache when its results belong to another catalog generation. */
+static void result_cache_sync(ResultCache *cache, uint64_t generation) {
+    if (cache->generation == generation) return;
+    if (cache->count > 0) cache->stats.invalidations++;
+    result_cache_clear(cache);
+    cache->generation = generation;
+}
+
+static void unlink_recency(ResultCache *cache, uint32_t id) {
+    ResultCacheEntry *entry = &cache->entries[id];
+    if (entry->newer != RESULT_CACHE_NONE) cache->entries[entry->newer].older = entry->older;
+    else cache->newest = entry->older;
+    if (entry->older != RESULT_CACHE_NONE) cache->entries[entry->older].newer = entry->newer;
+    else cache->oldest = entry->newer;
+}
+
+static void link_newest(ResultCache *cache, uint32_t id) {
+    ResultCacheEntry *entry = &cache->entries[id];
+    entry->newer = RESULT_CACHE_NONE;
+    entry->older = cache->newest;
+    if (cache->newest != RESULT_CACHE_NONE) cache->entries[cache->newest].newer = id;
+    cache->newest = id;
+    if (cache->oldest == RESULT_CACHE_NONE) cache->oldest = id;
+}
+
+static uint32_t find_entry(const ResultCache *cache, size_t hash, int mode, const char *query) {
+    uint32_t id = cache->buckets[hash & (cache->bucket_count - 1)];
+    while (id != RESULT_CACHE_NONE) {
+        const ResultCacheEntry *entry = &cache->entries[id];
+        if (entry->hash == hash && entry->mode == mode && strcmp(entry->query, query) == 0) return id;
+        id = entry->chain;
+    }
+    return RESULT_CACHE_NONE;
+}
+
+static void remove_entry(ResultCache *cache, uint32_t id) {
+    ResultCacheEntry *entry = &cache->entries[id];
+    uint32_t *link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link != id) link = &cache->entries[*link].chain;
+    *link = entry->chain;
+    unlink_recency(cache, id);
+    cache->bytes -= entry->bytes;
+    cache->count--;
+    free(entry->query);
+    free(entry->indices);
+    entry->query = NULL;
+    entry->indices = NULL;
+    entry->chain = cache->free_slot;
+    cache->free_slot = id;
+}
+
+const ResultCacheEntry *result_cache_get(ResultCache *cache, uint64_t generation, int mode, const char *query) {
+    if (!cache || !cache->entries || !query) return NULL;
+    result_cache_sync(cache, generation);
+    uint32_t id = find_entry(cache, result_cache_hash(mode, query), mode, query);
+    if (id == RESULT_CACHE_NONE) {
+        cache->stats.misses++;
+        return NULL;
+    }
+    cache->stats.hits++;
+    unlink_recency(cache, id);
+    link_newest(cache, id);
+    return &cache->entries[id];
+}
+
+const ResultCacheEntry *result_cache_put(ResultCache *cache, uint64_t generation, int mode, const char *query,
+                                         const size_t *indices, size_t count, size_t total, int exact) {
+    if (!cache || !cache->entries || !query || (count > 0 && !indices)) return NULL;
+    result_cache_sync(cache, generation);
+    size_t hash = result_cache_hash(mode, query);
+    uint32_t id = find_entry(cache, hash, mode, query);
+    if (id != RESULT_CACHE_NONE) remove_entry(cache, id);
+
+    size_t query_len = strlen(query);
+    size_t bytes = sizeof(ResultCacheEntry) + query_len + 1 + count * sizeof(size_t);
+    if (bytes > cache->max_bytes) return NULL;
+    while (cache->oldest != RESULT_CACHE_NONE && (cache->count == cache->max_entries || cache->bytes + bytes > cache->max_bytes)) {
+        remove_entry(cache, cache->oldest);
+        cache->stats.evictions++;
+    }
+
+    id = cache->free_slot;
+    ResultCacheEntry *entry = &cache->entries[id];
+    cache->free_slot = entry->chain;
+    entry->query = (char *)checked_malloc(query_len + 1);
+    memcpy(entry->query, query, query_len + 1);
+    entry->mode = mode;
+    entry->hash = hash;
+    entry->indices = count > 0 ? (size_t *)checked_malloc(count * sizeof(size_t)) : NULL;
+    if (count > 0) memcpy(entry->indices, indices, count * sizeof(size_t));
+    entry->count = count;
+    entry->total = total;
+    entry->exact = exact;
+    entry->bytes = bytes;
+    size_t bucket = hash & (cache->bucket_count - 1);
+    entry->chain = cache->buckets[bucket];
+    cache->buckets[bucket] = id;
+    link_newest(cache, id);
+    cache->bytes += bytes;
+    cache->count++;
+    return entry;
+}
+
+int result_cache_save_keys(const ResultCache *cache, const char *path, char **error_message) {
+    if (error_message) *error_message = NULL;
+    if (!cache || !path) return 0;
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        set_error(error_message, "Failed to write history file", path);
+        return 0;
+    }
+    for (uint32_t id = cache->oldest; id != RESULT_CACHE_NONE; id = cache->entries[id].newer) {
+        fprintf(fp, "%d\t%s\n", cache->entries[id].mode, cache->entries[id].query);
+    }
+    if (fclose(fp) != 0) {
+        set_error(error_message, "Failed to write history file", path);
+        return 0;
+    }
+    return 1;
+}
+
+int result_cache_load_keys(const char *path, void (*replay)(void *ctx, int mode, const char *query), void *ctx,
+                           char **error_message) {
+    if (error_message) *error_message = NULL;
+    if (!path || !replay) return 0;
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        if (errno == ENOENT) return 1;
+        set_error(error_message, "Failed to read history file", path);
+        return 0;
+    }
+    char line[RESULT_CACHE_LINE];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *endptr = NULL;
+        long mode = strtol(line, &endptr, 10);
+        if (endptr == line || *endptr != '\t' || mode < 0 || mode > 1024 || endptr[1] == '\0') continue;
+        replay(ctx, (int)mode, endptr + 1);
+    }
+    fclose(fp);
+    return 1;
+}
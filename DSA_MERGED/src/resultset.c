@@ -0,0 +1,531 @@
+#include "resultset.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static void *checked_realloc(void *ptr, size_t size) {
+    void *grown = realloc(ptr, size);
+    if (!grown) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+static int popcount64(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    while (word) {
+        word &= word - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+static unsigned lowest_bit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(word);
+#else
+    unsigned i = 0;
+    while (!(word & 1u)) {
+        word >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+/* ---- containers ---- */
+
+static void container_free(ResultContainer *c) {
+    free(c->values);
+    free(c->words);
+    c->values = NULL;
+    c->words = NULL;
+    c->cardinality = 0;
+    c->capacity = 0;
+}
+
+static ResultContainer container_array(uint16_t key, uint32_t capacity) {
+    ResultContainer c;
+    c.key = key;
+    c.kind = RESULT_CONTAINER_ARRAY;
+    c.cardinality = 0;
+    c.capacity = capacity > 0 ? capacity : 4;
+    c.values = (uint16_t *)checked_malloc(c.capacity * sizeof(uint16_t));
+    c.words = NULL;
+    return c;
+}
+
+static ResultContainer container_bitmap(uint16_t key) {
+    ResultContainer c;
+    c.key = key;
+    c.kind = RESULT_CONTAINER_BITMAP;
+    c.cardinality = 0;
+    c.capacity = 0;
+    c.values = NULL;
+    c.words = (uint64_t *)calloc(RESULT_BITMAP_WORDS, sizeof(uint64_t));
+    if (!c.words) {
+        fprintf(stderr, "Error: Out of memory allocating a result bitmap\n");
+        exit(EXIT_FAILURE);
+    }
+    return c;
+}
+
+static int container_contains(const ResultContainer *c, uint16_t low) {
+    if (c->kind == RESULT_CONTAINER_BITMAP) return (c->words[low >> 6] >> (low & 63)) & 1u;
+    uint32_t lo = 0;
+    uint32_t hi = c->cardinality;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (c->values[mid] < low) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < c->cardinality && c->values[lo] == low;
+}
+
+static void container_to_bitmap(ResultContainer *c) {
+    ResultContainer bitmap = container_bitmap(c->key);
+    for (uint32_t i = 0; i < c->cardinality; ++i) {
+        bitmap.words[c->values[i] >> 6] |= (uint64_t)1 << (c->values[i] & 63);
+    }
+    bitmap.cardinality = c->cardinality;
+    container_free(c);
+    *c = bitmap;
+}
+
+/* Turn a bitmap that has become small back into an array. */
+static void container_shrink(ResultContainer *c) {
+    if (c->kind != RESULT_CONTAINER_BITMAP || c->cardinality > RESULT_ARRAY_MAX) return;
+    ResultContainer array = container_array(c->key, c->cardinality);
+    for (uint32_t w = 0; w < RESULT_BITMAP_WORDS; ++w) {
+        uint64_t word = c->words[w];
+        while (word) {
+            array.values[array.cardinality++] = (uint16_t)(w * 64 + lowest_bit(word));
+            word &= word - 1;
+        }
+    }
+    container_free(c);
+    *c = array;
+}
+
+static void container_add(ResultContainer *c, uint16_t low) {
+    if (c->kind == RESULT_CONTAINER_BITMAP) {
+        uint64_t bit = (uint64_t)1 << (low & 63);
+        if (!(c->words[low >> 6] & bit)) {
+            c->words[low >> 6] |= bit;
+            c->cardinality++;
+        }
+        return;
+    }
+    uint32_t pos = c->cardinality;
+    if (pos > 0 && c->values[pos - 1] >= low) {
+        /* Out of order: find the slot, unless the value is already there. */
+        uint32_t lo = 0;
+        uint32_t hi = c->cardinality;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (c->values[mid] < low) lo = mid + 1;
+            else hi = mid;
+        }
+        if (c->values[lo] == low) return;
+        pos = lo;
+    }
+    if (c->cardinality == RESULT_ARRAY_MAX) {
+        container_to_bitmap(c);
+        container_add(c, low);
+        return;
+    }
+    if (c->cardinality == c->capacity) {
+        c->capacity = c->capacity * 2 > RESULT_ARRAY_MAX ? RESULT_ARRAY_MAX : c->capacity * 2;
+        c->values = (uint16_t *)checked_realloc(c->values, c->capacity * sizeof(uint16_t));
+    }
+    memmove(c->values + pos + 1, c->values + pos, (c->cardinality - pos) * sizeof(uint16_t));
+    c->values[pos] = low;
+    c->cardinality++;
+}
+
+static ResultContainer container_copy(const ResultContainer *c) {
+    ResultContainer copy;
+    if (c->kind == RESULT_CONTAINER_BITMAP) {
+        copy = container_bitmap(c->key);
+        memcpy(copy.words, c->words, RESULT_BITMAP_WORDS * sizeof(uint64_t));
+    } else {
+        copy = container_array(c->key, c->cardinality);
+        memcpy(copy.values, c->values, c->cardinality * sizeof(uint16_t));
+    }
+    copy.cardinality = c->cardinality;
+    return copy;
+}
+
+/* Bitmap copy of any container, for the mixed and bitmap-only paths. */
+static ResultContainer container_as_bitmap(const ResultContainer *c) {
+    ResultContainer copy = container_copy(c);
+    if (copy.kind == RESULT_CONTAINER_ARRAY) container_to_bitmap(&copy);
+    return copy;
+}
+
+static uint32_t bitmap_count(const uint64_t *words) {
+    uint32_t count = 0;
+    for (size_t w = 0; w < RESULT_BITMAP_WORDS; ++w) count += (uint32_t)popcount64(words[w]);
+    return count;
+}
+
+static ResultContainer container_and(const ResultContainer *a, const ResultContainer *b) {
+    if (a->kind == RESULT_CONTAINER_ARRAY && b->kind == RESULT_CONTAINER_ARRAY) {
+        ResultContainer out = container_array(a->key, a->cardinality < b->cardinality ? a->cardinality : b->cardinality);
+        uint32_t i = 0;
+        uint32_t j = 0;
+        while (i < a->cardinality && j < b->cardinality) {
+            if (a->values[i] < b->values[j]) i++;
+            else if (a->values[i] > b->values[j]) j++;
+            else {
+                out.values[out.cardinality++] = a->values[i];
+                i++;
+                j++;
+            }
+        }
+        return out;
+    }
+    if (a->kind == RESULT_CONTAINER_ARRAY || b->kind == RESULT_CONTAINER_ARRAY) {
+        const ResultContainer *array = a->kind == RESULT_CONTAINER_ARRAY ? a : b;
+        const ResultContainer *bitmap = a->kind == RESULT_CONTAINER_ARRAY ? b : a;
+        ResultContainer out = container_array(a->key, array->cardinality);
+        for (uint32_t i = 0; i < array->cardinality; ++i) {
+            if (container_contains(bitmap, array->values[i])) out.values[out.cardinality++] = array->values[i];
+        }
+        return out;
+    }
+    ResultContainer out = container_bitmap(a->key);
+    for (size_t w = 0; w < RESULT_BITMAP_WORDS; ++w) out.words[w] = a->words[w] & b->words[w];
+    out.cardinality = bitmap_count(out.words);
+    container_shrink(&out);
+    return out;
+}
+
+static ResultContainer container_or(const ResultContainer *a, const ResultContainer *b) {
+    if (a->kind == RESULT_CONTAINER_ARRAY && b->kind == RESULT_CONTAINER_ARRAY &&
+        a->cardinality + b->cardinality <= RESULT_ARRAY_MAX) {
+        ResultContainer out = container_array(a->key, a->cardinality + b->cardinality);
+        uint32_t i = 0;
+        uint32_t j = 0;
+        while (i < a->cardinality || j < b->cardinality) {
+            uint16_t value;
+            if (j == b->cardinality || (i < a->cardinality && a->values[i] < b->values[j])) {
+                value = a->values[i++];
+            } else if (i == a->cardinality || b->values[j] < a->values[i]) {
+                value = b->values[j++];
+            } else {
+                value = a->values[i];
+                i++;
+                j++;
+            }
+            out.values[out.cardinality++] = value;
+        }
+        return out;
+    }
+    ResultContainer out = container_as_bitmap(a->kind == RESULT_CONTAINER_BITMAP ? a : b);
+    const ResultContainer *other = a->kind == RESULT_CONTAINER_BITMAP ? b : a;
+    if (other->kind == RESULT_CONTAINER_BITMAP) {
+        for (size_t w = 0; w < RESULT_BITMAP_WORDS; ++w) out.words[w] |= other->words[w];
+        out.cardinality = bitmap_count(out.words);
+    } else {
+        for (uint32_t i = 0; i < other->cardinality; ++i) container_add(&out, other->values[i]);
+    }
+    container_shrink(&out);
+    return out;
+}
+
+static ResultContainer container_andnot(const ResultContainer *a, const ResultContainer *b) {
+    if (a->kind == RESULT_CONTAINER_ARRAY) {
+        ResultContainer out = container_array(a->key, a->cardinality);
+        for (uint32_t i = 0; i < a->cardinality; ++i) {
+            if (!container_contains(b, a->values[i])) out.values[out.cardinality++] = a->values[i];
+        }
+        return out;
+    }
+    ResultContainer out = container_copy(a);
+    if (b->kind == RESULT_CONTAINER_BITMAP) {
+        for (size_t w = 0; w < RESULT_BITMAP_WORDS; ++w) out.words[w] &= ~b->words[w];
+    } else {
+        for (uint32_t i = 0; i < b->cardinality; ++i) {
+            out.words[b->values[i] >> 6] &= ~((uint64_t)1 << (b->values[i] & 63));
+        }
+    }
+    out.cardinality = bitmap_count(out.words);
+    container_shrink(&out);
+    return out;
+}
+
+/* ---- sets ---- */
+
+void result_set_init(ResultSet *set) {
+    if (!set) return;
+    set->containers = NULL;
+    set->count = 0;
+    set->capacity = 0;
+}
+
+void result_set_clear(ResultSet *set) {
+    if (!set) return;
+    for (size_t i = 0; i < set->count; ++i) container_free(&set->containers[i]);
+    set->count = 0;
+}
+
+void result_set_free(ResultSet *set) {
+    if (!set) return;
+    result_set_clear(set);
+    free(set->containers);
+    result_set_init(set);
+}
+
+/* Put a container at pos, shifting the later keys up. */
+static void result_set_insert(ResultSet *set, size_t pos, ResultContainer container) {
+    if (set->count == set->capacity) {
+        set->capacity = set->capacity == 0 ? 4 : set->capacity * 2;
+        set->containers = (ResultContainer *)checked_realloc(set->containers, set->capacity * sizeof(ResultContainer));
+    }
+    memmove(set->containers + pos + 1, set->containers + pos, (set->count - pos) * sizeof(ResultContainer));
+    set->containers[pos] = container;
+    set->count++;
+}
+
+/* Append a container, which must sort after every existing key; empty ones are dropped. */
+static void result_set_push(ResultSet *set, ResultContainer container) {
+    if (container.cardinality == 0) {
+        container_free(&container);
+        return;
+    }
+    result_set_insert(set, set->count, container);
+}
+
+/* Position of key, or where it would be inserted. */
+static size_t result_set_find(const ResultSet *set, uint16_t key) {
+    size_t lo = 0;
+    size_t hi = set->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (set->containers[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void result_set_add(ResultSet *set, uint32_t value) {
+    if (!set) return;
+    uint16_t key = (uint16_t)(value >> 16);
+    size_t pos = set->count;
+    if (pos > 0 && set->containers[pos - 1].key == key) {
+        pos--;
+    } else if (pos > 0 && set->containers[pos - 1].key > key) {
+        pos = result_set_find(set, key);
+        if (set->containers[pos].key != key) result_set_insert(set, pos, container_array(key, 0));
+    } else {
+        result_set_insert(set, pos, container_array(key, 0));
+    }
+    container_add(&set->containers[pos], (uint16_t)value);
+}
+
+void result_set_append_container(ResultSet *set, uint16_t key, uint16_t kind, uint32_t cardinality, const void *data) {
+    if (!set) return;
+    ResultContainer c;
+    if (kind == RESULT_CONTAINER_BITMAP) {
+        c = container_bitmap(key);
+        memcpy(c.words, data, RESULT_BITMAP_WORDS * sizeof(uint64_t));
+    } else {
+        c = container_array(key, cardinality);
+        if (cardinality > 0) memcpy(c.values, data, cardinality * sizeof(uint16_t));
+    }
+    c.cardinality = cardinality;
+    result_set_push(set, c);
+}
+
+static int compare_size(const void *lhs, const void *rhs) {
+    size_t a = *(const size_t *)lhs;
+    size_t b = *(const size_t *)rhs;
+    return (a > b) - (a < b);
+}
+
+void result_set_from_indices(ResultSet *set, const size_t *indices, size_t count) {
+    if (!set) return;
+    result_set_clear(set);
+    if (!indices || count == 0) return;
+    int ascending = 1;
+    for (size_t i = 1; i < count && ascending; ++i) ascending = indices[i - 1] <= indices[i];
+    if (ascending) {
+        for (size_t i = 0; i < count; ++i) result_set_add(set, (uint32_t)indices[i]);
+        return;
+    }
+    size_t *sorted = (size_t *)checked_malloc(count * sizeof(size_t));
+    memcpy(sorted, indices, count * sizeof(size_t));
+    qsort(sorted, count, sizeof(size_t), compare_size);
+    for (size_t i = 0; i < count; ++i) result_set_add(set, (uint32_t)sorted[i]);
+    free(sorted);
+}
+
+void result_set_copy(ResultSet *out, const ResultSet *set) {
+    if (!out || !set) return;
+    result_set_clear(out);
+    for (size_t i = 0; i < set->count; ++i) result_set_push(out, container_copy(&set->containers[i]));
+}
+
+size_t result_set_cardinality(const ResultSet *set) {
+    if (!set) return 0;
+    size_t total = 0;
+    for (size_t i = 0; i < set->count; ++i) total += set->containers[i].cardinality;
+    return total;
+}
+
+int result_set_contains(const ResultSet *set, uint32_t value) {
+    if (!set) return 0;
+    size_t pos = result_set_find(set, (uint16_t)(value >> 16));
+    return pos < set->count && set->containers[pos].key == (uint16_t)(value >> 16) &&
+           container_contains(&set->containers[pos], (uint16_t)value);
+}
+
+void result_set_and(ResultSet *out, const ResultSet *a, const ResultSet *b) {
+    if (!out || !a || !b) return;
+    result_set_clear(out);
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a->count && j < b->count) {
+        uint16_t ka = a->containers[i].key;
+        uint16_t kb = b->containers[j].key;
+        if (ka < kb) i++;
+        else if (kb < ka) j++;
+        else result_set_push(out, container_and(&a->containers[i++], &b->containers[j++]));
+    }
+}
+
+void result_set_or(ResultSet *out, const ResultSet *a, const ResultSet *b) {
+    if (!out || !a || !b) return;
+    result_set_clear(out);
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a->count || j < b->count) {
+        if (j == b->count || (i < a->count && a->containers[i].key < b->containers[j].key)) {
+            result_set_push(out, container_copy(&a->containers[i++]));
+        } else if (i == a->count || b->containers[j].key < a->containers[i].key) {
+            result_set_push(out, container_copy(&b->containers[j++]));
+        } else {
+            result_set_push(out, container_or(&a->containers[i++], &b->containers[j++]));
+        }
+    }
+}
+
+void result_set_andnot(ResultSet *out, const ResultSet *a, const ResultSet *b) {
+    if (!out || !a || !b) return;
+    result_set_clear(out);
+    size_t j = 0;
+    for (size_t i = 0; i < a->count; ++i) {
+        const ResultContainer *c = &a->containers[i];
+        while (j < b->count && b->containers[j].key < c->key) j++;
+        if (j < b->count && b->containers[j].key == c->key) {
+            result_set_push(out, container_andnot(c, &b->containers[j]));
+        } else {
+            result_set_push(out, container_copy(c));
+        }
+    }
+}
+
+void result_set_not(ResultSet *out, const ResultSet *set, size_t universe) {
+    if (!out || !set) return;
+    result_set_clear(out);
+    if (universe == 0) return;
+    /* Complement each block against a full bitmap clipped to the universe. */
+    size_t blocks = (universe + 65535) / 65536;
+    size_t j = 0;
+    for (size_t block = 0; block < blocks; ++block) {
+        ResultContainer full = container_bitmap((uint16_t)block);
+        size_t bits = block + 1 < blocks ? 65536 : universe - block * 65536;
+        for (size_t w = 0; w < bits / 64; ++w) full.words[w] = ~(uint64_t)0;
+        if (bits % 64) full.words[bits / 64] = ((uint64_t)1 << (bits % 64)) - 1;
+        full.cardinality = (uint32_t)bits;
+        while (j < set->count && set->containers[j].key < block) j++;
+        if (j < set->count && set->containers[j].key == block) {
+            result_set_push(out, container_andnot(&full, &set->containers[j]));
+            container_free(&full);
+        } else {
+            container_shrink(&full);
+            result_set_push(out, full);
+        }
+    }
+}
+
+int result_set_to_indices(const ResultSet *set, size_t **out_indices, size_t *out_count) {
+    if (out_indices) *out_indices = NULL;
+    if (out_count) *out_count = 0;
+    if (!set || !out_indices || !out_count) return 0;
+    size_t total = result_set_cardinality(set);
+    if (total == 0) return 0;
+
+    size_t *results = (size_t *)checked_malloc(total * sizeof(size_t));
+    size_t count = 0;
+    for (size_t i = 0; i < set->count; ++i) {
+        const ResultContainer *c = &set->containers[i];
+        size_t high = (size_t)c->key << 16;
+        if (c->kind == RESULT_CONTAINER_ARRAY) {
+            for (uint32_t v = 0; v < c->cardinality; ++v) results[count++] = high | c->values[v];
+            continue;
+        }
+        for (size_t w = 0; w < RESULT_BITMAP_WORDS; ++w) {
+            uint64_t word = c->words[w];
+            while (word) {
+                results[count++] = high | (w * 64 + lowest_bit(word));
+                word &= word - 1;
+            }
+        }
+    }
+    *out_indices = results;
+    *out_count = count;
+    return 1;
+}
+
+void result_set_iterator_init(ResultSetIterator *it, const ResultSet *set) {
+    if (!it) return;
+    it->set = set;
+    it->container = 0;
+    it->position = 0;
+}
+
+size_t result_set_iterator_next(ResultSetIterator *it, size_t *out, size_t max) {
+    if (!it || !it->set || !out) return 0;
+    size_t count = 0;
+    while (count < max && it->container < it->set->count) {
+        const ResultContainer *c = &it->set->containers[it->container];
+        size_t high = (size_t)c->key << 16;
+        if (c->kind == RESULT_CONTAINER_ARRAY) {
+            while (count < max && it->position < c->cardinality) out[count++] = high | c->values[it->position++];
+            if (it->position < c->cardinality) break;
+        } else {
+            while (count < max && it->position < RESULT_BITMAP_WORDS * 64) {
+                uint32_t w = it->position / 64;
+                uint64_t word = c->words[w] & (~0ull << (it->position % 64));
+                if (!word) {
+                    it->position = (w + 1) * 64;
+                    continue;
+                }
+                uint32_t bit = w * 64 + lowest_bit(word);
+                out[count++] = high | bit;
+                it->position = bit + 1;
+            }
+            if (it->position < RESULT_BITMAP_WORDS * 64) break;
+        }
+        it->container++;
+        it->position = 0;
+    }
+    return count;
+}
@@ -1,10 +1,19 @@
 #include "search.h"
+#include "parallel.h"
 
 #include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Control bytes are compared a whole group at a time with SSE2 where available. */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TITLE_INDEX_SSE2 1
+#include <emmintrin.h>
+#endif
+
 static void *checked_malloc(size_t size) {
     void *ptr = malloc(size);
     if (!ptr) {
@@ -22,41 +31,88 @@ static char *string_duplicate(const char *src) {
     return copy;
 }
 
+/* Movies per shard below which a parallel index build is not worth it. */
+#define TITLE_INDEX_MIN_SHARD 4096
+
+#define TITLE_NOT_FOUND ((size_t)-1)
+
 static size_t next_power_of_two(size_t value) {
     size_t v = 1;
     while (v < value) v <<= 1;
     return v;
 }
 
+/* Bit i set when control byte i of the group equals byte. */
+static unsigned title_group_match(const unsigned char *group, unsigned char byte) {
+#ifdef TITLE_INDEX_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)(const void *)group);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < TITLE_GROUP_WIDTH; ++i) {
+        if (group[i] == byte) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+/* Bit i set when slot i of the group is unused. */
+static unsigned title_group_empty(const unsigned char *group) {
+#ifdef TITLE_INDEX_SSE2
+    /* Tags are below 0x80, so only empty slots have the top bit set. */
+    return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(const void *)group));
+#else
+    return title_group_match(group, TITLE_CTRL_EMPTY);
+#endif
+}
+
+static unsigned lowest_bit_index(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned i = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+static unsigned char title_tag(size_t hash) {
+    return (unsigned char)(hash & 0x7fu);
+}
+
+/* First group to probe; the low 7 bits are the tag, so start from the rest. */
+static size_t title_home_group(const TitleIndex *index, size_t hash) {
+    return (hash >> 7) & (index->capacity / TITLE_GROUP_WIDTH - 1);
+}
+
 void title_index_init(TitleIndex *index) {
     if (!index) return;
     index->entries = NULL;
-    index->capacity = 0;
     index->size = 0;
-}
-
-static void title_index_entry_free(TitleIndexEntry *entry) {
-    if (!entry || !entry->occupied) return;
-    free(entry->key_lower);
-    free(entry->indices);
-    entry->key_lower = NULL;
-    entry->indices = NULL;
-    entry->count = 0;
-    entry->capacity = 0;
-    entry->occupied = 0;
+    index->entry_capacity = 0;
+    index->groups = NULL;
+    index->capacity = 0;
+    index->borrowed = 0;
+    trigram_index_init(&index->trigrams);
+    text_blob_init(&index->key_text);
 }
 
 void title_index_free(TitleIndex *index) {
     if (!index) return;
-    if (index->entries) {
-        for (size_t i = 0; i < index->capacity; ++i) {
-            title_index_entry_free(&index->entries[i]);
+    if (!index->borrowed) {
+        for (size_t i = 0; i < index->size; ++i) {
+            free(index->entries[i].key_lower);
+            free(index->entries[i].indices);
         }
-        free(index->entries);
+        free(index->groups);
     }
-    index->entries = NULL;
-    index->capacity = 0;
-    index->size = 0;
+    free(index->entries);
+    trigram_index_free(&index->trigrams);
+    text_blob_free(&index->key_text);
+    title_index_init(index);
 }
 
 static int title_index_entry_append(TitleIndexEntry *entry, size_t movie_index) {
@@ -71,52 +127,141 @@ static int title_index_entry_append(TitleIndexEntry *entry, size_t movie_index)
     return 1;
 }
 
-static int title_index_insert(TitleIndex *index, const char *key_lower, size_t movie_index) {
-    if (index->size * 100u / index->capacity >= 80u) {
-        fprintf(stderr, "Warning: Title index load factor exceeded 80%%. Consider rebuilding with higher capacity.\n");
+static size_t title_hash(const char *key_lower) {
+    uint64_t hash = 5381u;
+    for (const unsigned char *p = (const unsigned char *)key_lower; *p; ++p) {
+        hash = ((hash << 5) + hash) + (uint64_t)(*p);
     }
+    /* djb2 leaves short keys with poor high and low bits; mix before they pick groups and tags. */
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return (size_t)hash;
+}
 
-    size_t hash = 5381u;
-    for (const unsigned char *p = (const unsigned char *)key_lower; *p; ++p) {
-        hash = ((hash << 5) + hash) + (size_t)(*p);
-    }
-
-    size_t idx = hash & (index->capacity - 1);
-    size_t start = idx;
-    while (1) {
-        TitleIndexEntry *entry = &index->entries[idx];
-        if (!entry->occupied) {
-            entry->occupied = 1;
-            entry->key_lower = string_duplicate(key_lower);
-            entry->indices = NULL;
-            entry->count = 0;
-            entry->capacity = 0;
-            index->size++;
+/* Key id of key_lower, or TITLE_NOT_FOUND. strcmp only runs on tag and hash matches. */
+static size_t title_index_find(const TitleIndex *index, size_t hash, const char *key_lower) {
+    if (index->capacity == 0) return TITLE_NOT_FOUND;
+    size_t group_mask = index->capacity / TITLE_GROUP_WIDTH - 1;
+    size_t group = title_home_group(index, hash);
+    unsigned char tag = title_tag(hash);
+    for (size_t step = 1;; ++step) {
+        const TitleIndexGroup *g = &index->groups[group];
+        unsigned match = title_group_match(g->ctrl, tag);
+        while (match) {
+            size_t id = g->ids[lowest_bit_index(match)];
+            const TitleIndexEntry *entry = &index->entries[id];
+            if (entry->hash == hash && strcmp(entry->key_lower, key_lower) == 0) return id;
+            match &= match - 1;
         }
-        if (strcmp(entry->key_lower, key_lower) == 0) {
-            return title_index_entry_append(entry, movie_index);
+        /* Nothing is ever removed, so a group with a free slot ends the probe sequence. */
+        if (title_group_empty(g->ctrl)) return TITLE_NOT_FOUND;
+        group = (group + step) & group_mask;
+    }
+}
+
+/* Put key id into the first free slot of its probe sequence. */
+static void title_index_place(TitleIndex *index, size_t hash, size_t id) {
+    size_t group_mask = index->capacity / TITLE_GROUP_WIDTH - 1;
+    size_t group = title_home_group(index, hash);
+    for (size_t step = 1;; ++step) {
+        TitleIndexGroup *g = &index->groups[group];
+        unsigned empty = title_group_empty(g->ctrl);
+        if (empty) {
+            unsigned slot = lowest_bit_index(empty);
+            g->ctrl[slot] = title_tag(hash);
+            g->ids[slot] = (uint32_t)id;
+            return;
         }
-        idx = (idx + 1) & (index->capacity - 1);
-        if (idx == start) {
+        group = (group + step) & group_mask;
+    }
+}
+
+/* Rebuild the groups with capacity slots from the stored hashes; keys are never compared. */
+static void title_index_rehash(TitleIndex *index, size_t capacity) {
+    size_t group_count = capacity / TITLE_GROUP_WIDTH;
+    TitleIndexGroup *groups = (TitleIndexGroup *)checked_malloc(group_count * sizeof(TitleIndexGroup));
+    for (size_t i = 0; i < group_count; ++i) {
+        memset(groups[i].ctrl, TITLE_CTRL_EMPTY, sizeof(groups[i].ctrl));
+        memset(groups[i].ids, 0, sizeof(groups[i].ids)); /* keeps snapshots byte-for-byte reproducible */
+    }
+    free(index->groups);
+    index->groups = groups;
+    index->capacity = capacity;
+    for (size_t id = 0; id < index->size; ++id) {
+        title_index_place(index, index->entries[id].hash, id);
+    }
+}
+
+/* Slots needed to hold keys at no more than 7/8 load. */
+static size_t title_index_capacity_for(size_t keys) {
+    size_t capacity = next_power_of_two(keys + keys / 7 + 1);
+    return capacity < TITLE_GROUP_WIDTH ? TITLE_GROUP_WIDTH : capacity;
+}
+
+/* Add a new key (taking ownership of key_lower) with no postings; grows the table as needed. */
+static size_t title_index_add_key(TitleIndex *index, size_t hash, char *key_lower) {
+    if (index->size >= UINT32_MAX) return TITLE_NOT_FOUND;
+    if (title_index_capacity_for(index->size + 1) > index->capacity) {
+        title_index_rehash(index, index->capacity * 2 > TITLE_GROUP_WIDTH ? index->capacity * 2 : TITLE_GROUP_WIDTH);
+    }
+    if (index->size == index->entry_capacity) {
+        size_t new_capacity = index->entry_capacity == 0 ? 16 : index->entry_capacity * 2;
+        TitleIndexEntry *grown = (TitleIndexEntry *)realloc(index->entries, new_capacity * sizeof(TitleIndexEntry));
+        if (!grown) return TITLE_NOT_FOUND;
+        index->entries = grown;
+        index->entry_capacity = new_capacity;
+    }
+    size_t id = index->size++;
+    TitleIndexEntry *entry = &index->entries[id];
+    entry->key_lower = key_lower;
+    entry->hash = hash;
+    entry->indices = NULL;
+    entry->count = 0;
+    entry->capacity = 0;
+    title_index_place(index, hash, id);
+    return id;
+}
+
+static int title_index_insert_hashed(TitleIndex *index, size_t hash, const char *key_lower, size_t movie_index) {
+    size_t id = title_index_find(index, hash, key_lower);
+    if (id == TITLE_NOT_FOUND) {
+        char *key = string_duplicate(key_lower);
+        id = title_index_add_key(index, hash, key);
+        if (id == TITLE_NOT_FOUND) {
+            free(key);
             return 0;
         }
     }
+    return title_index_entry_append(&index->entries[id], movie_index);
 }
 
-int title_index_build(TitleIndex *index, const MovieDatabase *db) {
-    if (!index || !db) return 0;
-    title_index_free(index);
-    size_t desired = db->count == 0 ? 16 : db->count * 2;
-    size_t capacity = next_power_of_two(desired);
-    if (capacity < 16) capacity = 16;
+static int title_index_insert(TitleIndex *index, const char *key_lower, size_t movie_index) {
+    return title_index_insert_hashed(index, title_hash(key_lower), key_lower, movie_index);
+}
 
-    index->entries = (TitleIndexEntry *)calloc(capacity, sizeof(TitleIndexEntry));
-    if (!index->entries) {
-        fprintf(stderr, "Error: Out of memory while building title index\n");
-        return 0;
+/* Make keys [first_key, size) visible to partial searches. */
+static void title_index_index_trigrams(TitleIndex *index, size_t first_key) {
+    for (size_t id = first_key; id < index->size; ++id) {
+        trigram_index_add(&index->trigrams, (uint32_t)id, index->entries[id].key_lower);
+        text_blob_add(&index->key_text, index->entries[id].key_lower);
     }
-    index->capacity = capacity;
+    trigram_index_finish(&index->trigrams);
+}
+
+/* Size the slot arrays for up to movie_count distinct titles. */
+static int title_index_allocate(TitleIndex *index, size_t movie_count) {
     index->size = 0;
+    title_index_rehash(index, title_index_capacity_for(movie_count));
+    return 1;
+}
+
+int title_index_build(TitleIndex *index, const MovieDatabase *db) {
+    if (!index || !db) return 0;
+    title_index_free(index);
+    if (!title_index_allocate(index, db->count)) return 0;
 
     for (size_t i = 0; i < db->count; ++i) {
         const Movie *movie = &db->movies[i];
@@ -125,31 +270,135 @@ int title_index_build(TitleIndex *index, const MovieDatabase *db) {
             fprintf(stderr, "Warning: Failed to insert movie title into index: %s\n", movie->title);
         }
     }
+    title_index_index_trigrams(index, 0);
     return 1;
 }
 
-static int title_index_find_entry(const TitleIndex *index, const char *key_lower, TitleIndexEntry **out_entry) {
-    if (!index || !index->entries || index->capacity == 0) return 0;
-
-    size_t hash = 5381u;
-    for (const unsigned char *p = (const unsigned char *)key_lower; *p; ++p) {
-        hash = ((hash << 5) + hash) + (size_t)(*p);
+/*
+ * A shard indexes one contiguous range of movies. Its dense entries are in
+ * insertion order, so merging shard after shard inserts every key in the order
+ * of its first occurrence, exactly like the serial build.
+ */
+typedef struct {
+    const MovieDatabase *db;
+    TitleIndex *shards;
+} TitleIndexShardBuild;
+
+static void title_index_build_shard(void *ctx, size_t worker, size_t workers) {
+    TitleIndexShardBuild *build = (TitleIndexShardBuild *)ctx;
+    TitleIndex *shard = &build->shards[worker];
+    size_t begin = build->db->count / workers * worker;
+    size_t end = worker + 1 == workers ? build->db->count : build->db->count / workers * (worker + 1);
+
+    title_index_init(shard);
+    title_index_allocate(shard, end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        const Movie *movie = &build->db->movies[i];
+        if (!movie->title_lower || movie->title_lower[0] == '\0') continue;
+        if (!title_index_insert(shard, movie->title_lower, i)) {
+            fprintf(stderr, "Warning: Failed to insert movie title into index: %s\n", movie->title);
+        }
     }
+}
 
-    size_t idx = hash & (index->capacity - 1);
-    size_t start = idx;
-    while (1) {
-        TitleIndexEntry *entry = &index->entries[idx];
-        if (!entry->occupied) {
-            return 0;
+/* Move the shard's entries into index; keys and posting arrays are handed over, not copied. */
+static int title_index_merge_shard(TitleIndex *index, TitleIndex *shard) {
+    int ok = 1;
+    for (size_t i = 0; i < shard->size; ++i) {
+        TitleIndexEntry *from = &shard->entries[i];
+        size_t id = title_index_find(index, from->hash, from->key_lower);
+        if (id == TITLE_NOT_FOUND) {
+            id = title_index_add_key(index, from->hash, from->key_lower);
+            if (id == TITLE_NOT_FOUND) {
+                ok = 0;
+                continue;
+            }
+            TitleIndexEntry *to = &index->entries[id];
+            to->indices = from->indices;
+            to->count = from->count;
+            to->capacity = from->capacity;
+            from->key_lower = NULL;
+            from->indices = NULL;
+            continue;
         }
-        if (strcmp(entry->key_lower, key_lower) == 0) {
-            if (out_entry) *out_entry = entry;
-            return 1;
+        for (size_t j = 0; j < from->count; ++j) {
+            if (!title_index_entry_append(&index->entries[id], from->indices[j])) ok = 0;
         }
-        idx = (idx + 1) & (index->capacity - 1);
-        if (idx == start) return 0;
     }
+    title_index_free(shard);
+    return ok;
+}
+
+int title_index_build_parallel(TitleIndex *index, const MovieDatabase *db, size_t threads) {
+    if (!index || !db) return 0;
+    if (threads <= 1 || db->count < threads * TITLE_INDEX_MIN_SHARD) return title_index_build(index, db);
+
+    title_index_free(index);
+    if (!title_index_allocate(index, db->count)) return 0;
+
+    TitleIndexShardBuild build;
+    build.db = db;
+    build.shards = (TitleIndex *)checked_malloc(threads * sizeof(TitleIndex));
+    parallel_run(threads, title_index_build_shard, &build);
+
+    int ok = 1;
+    for (size_t i = 0; i < threads; ++i) {
+        if (!title_index_merge_shard(index, &build.shards[i])) ok = 0;
+    }
+    free(build.shards);
+    if (!ok) {
+        fprintf(stderr, "Warning: Failed to merge some titles into the index\n");
+    }
+    title_index_index_trigrams(index, 0);
+    return 1;
+}
+
+/* Copy the keys, postings and groups a snapshot lent the index, so they can be modified. */
+static void title_index_take_ownership(TitleIndex *index) {
+    for (size_t i = 0; i < index->size; ++i) {
+        TitleIndexEntry *entry = &index->entries[i];
+        entry->key_lower = string_duplicate(entry->key_lower);
+        size_t *indices = (size_t *)checked_malloc((entry->count > 0 ? entry->count : 1) * sizeof(size_t));
+        if (entry->count > 0) memcpy(indices, entry->indices, entry->count * sizeof(size_t));
+        entry->indices = indices;
+        entry->capacity = entry->count;
+    }
+    size_t group_bytes = index->capacity / TITLE_GROUP_WIDTH * sizeof(TitleIndexGroup);
+    TitleIndexGroup *groups = (TitleIndexGroup *)checked_malloc(group_bytes);
+    memcpy(groups, index->groups, group_bytes);
+    index->groups = groups;
+    index->entry_capacity = index->size;
+    index->borrowed = 0;
+}
+
+int title_index_append(TitleIndex *index, const MovieDatabase *db, size_t first) {
+    if (!index || !db || first > db->count) return 0;
+    if (index->capacity == 0) {
+        title_index_free(index);
+        if (!title_index_allocate(index, db->count - first)) return 0;
+    } else if (index->borrowed) {
+        title_index_take_ownership(index);
+    }
+
+    size_t first_key = index->size;
+    for (size_t i = first; i < db->count; ++i) {
+        const Movie *movie = &db->movies[i];
+        if (!movie->title_lower || movie->title_lower[0] == '\0') continue;
+        if (!title_index_insert(index, movie->title_lower, i)) {
+            fprintf(stderr, "Warning: Failed to insert movie title into index: %s\n", movie->title);
+        }
+    }
+    title_index_index_trigrams(index, first_key);
+    return 1;
+}
+
+static int title_index_find_entry(const TitleIndex *index, const char *key_lower, const TitleIndexEntry **out_entry) {
+    if (!index || index->capacity == 0) return 0;
+
+    size_t id = title_index_find(index, title_hash(key_lower), key_lower);
+    if (id == TITLE_NOT_FOUND) return 0;
+    if (out_entry) *out_entry = &index->entries[id];
+    return 1;
 }
 
 static int allocate_result_copy(const TitleIndexEntry *entry, size_t **out_indices, size_t *out_count) {
@@ -161,62 +410,82 @@ static int allocate_result_copy(const TitleIndexEntry *entry, size_t **out_indic
     return 1;
 }
 
+int title_index_key_weight(const TitleIndex *index, size_t key_id, const MovieDatabase *db) {
+    if (!index || !db || key_id >= index->size) return 0;
+    const TitleIndexEntry *entry = &index->entries[key_id];
+    int weight = 0;
+    for (size_t i = 0; i < entry->count; ++i) {
+        size_t movie = entry->indices[i];
+        if (movie < db->count && db->movies[movie].release_year_num > weight) {
+            weight = db->movies[movie].release_year_num;
+        }
+    }
+    return weight;
+}
+
+const TitleIndexEntry *title_index_entry(const TitleIndex *index, const char *title_lower) {
+    const TitleIndexEntry *entry = NULL;
+    if (!title_lower || !title_index_find_entry(index, title_lower, &entry)) return NULL;
+    return entry;
+}
+
 int title_index_lookup(const TitleIndex *index, const char *title_lower, size_t **out_indices, size_t *out_count) {
     if (out_indices) *out_indices = NULL;
     if (out_count) *out_count = 0;
     if (!index || !title_lower || !out_indices || !out_count) return 0;
 
-    TitleIndexEntry *entry = NULL;
+    const TitleIndexEntry *entry = NULL;
     if (!title_index_find_entry(index, title_lower, &entry)) {
         return 0;
     }
     return allocate_result_copy(entry, out_indices, out_count);
 }
 
+/* Append the movies of key id to results (sized by the caller). */
+static void title_index_emit(const TitleIndex *index, size_t id, size_t *results, size_t *count) {
+    const TitleIndexEntry *entry = &index->entries[id];
+    memcpy(results + *count, entry->indices, entry->count * sizeof(size_t));
+    *count += entry->count;
+}
+
+/*
+ * Candidate keys come from the trigram index and are verified one by one;
+ * needles too short to have a trigram scan the packed key text in one pass. Each movie sits under
+ * exactly one key, so results need no deduplication.
+ */
 int title_index_partial_search(const TitleIndex *index, const char *needle_lower, size_t **out_indices, size_t *out_count) {
     if (out_indices) *out_indices = NULL;
     if (out_count) *out_count = 0;
     if (!index || !needle_lower || !out_indices || !out_count) return 0;
 
-    size_t capacity = 16;
-    size_t count = 0;
-    size_t *results = NULL;
-
-    for (size_t i = 0; i < index->capacity; ++i) {
-        const TitleIndexEntry *entry = &index->entries[i];
-        if (!entry->occupied) continue;
-        if (strstr(entry->key_lower, needle_lower)) {
-            for (size_t j = 0; j < entry->count; ++j) {
-                size_t movie_index = entry->indices[j];
-                int duplicate = 0;
-                for (size_t k = 0; k < count; ++k) {
-                    if (results[k] == movie_index) {
-                        duplicate = 1;
-                        break;
-                    }
-                }
-                if (duplicate) continue;
-                if (count == capacity) {
-                    capacity *= 2;
-                    size_t *grown = (size_t *)realloc(results, capacity * sizeof(size_t));
-                    if (!grown) {
-                        free(results);
-                        return 0;
-                    }
-                    results = grown;
-                }
-                if (!results) {
-                    results = (size_t *)checked_malloc(capacity * sizeof(size_t));
-                }
-                results[count++] = movie_index;
-            }
+    size_t needle_len = strlen(needle_lower);
+    uint32_t *matches = NULL;
+    size_t match_count = 0;
+    if (trigram_index_candidates(&index->trigrams, needle_lower, &matches, &match_count)) {
+        size_t kept = 0;
+        for (size_t i = 0; i < match_count; ++i) {
+            const char *key = index->entries[matches[i]].key_lower;
+            if (substring_find(key, strlen(key), needle_lower, needle_len)) matches[kept++] = matches[i];
         }
+        match_count = kept;
+    } else {
+        text_blob_search(&index->key_text, needle_lower, &matches, &match_count);
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < match_count; ++i) {
+        total += index->entries[matches[i]].count;
     }
 
-    if (count == 0) {
-        free(results);
+    if (total == 0) {
+        free(matches);
         return 0;
     }
+    size_t *results = (size_t *)checked_malloc(total * sizeof(size_t));
+    size_t count = 0;
+    for (size_t i = 0; i < match_count; ++i) {
+        title_index_emit(index, matches[i], results, &count);
+    }
+    free(matches);
 
     *out_indices = results;
     *out_count = count;
@@ -235,34 +504,107 @@ static int append_index(size_t **buffer, size_t *count, size_t *capacity, size_t
     return 1;
 }
 
-int search_by_director(const MovieDatabase *db, const char *director_lower, size_t **out_indices, size_t *out_count) {
-    if (out_indices) *out_indices = NULL;
-    if (out_count) *out_count = 0;
-    if (!db || !director_lower || !out_indices || !out_count) return 0;
+/* Hand the collected matches to the caller; an empty result is reported as "not found". */
+static int finish_results(size_t *results, size_t count, size_t **out_indices, size_t *out_count) {
+    if (count == 0) {
+        free(results);
+        return 0;
+    }
+    *out_indices = results;
+    *out_count = count;
+    return 1;
+}
 
+/* Movies whose director id is flagged in wanted (indexed by director id). */
+static int collect_by_director_ids(const MovieDatabase *db, const unsigned char *wanted, size_t **out_indices, size_t *out_count) {
+    const MovieColumns *columns = &db->columns;
     size_t *results = NULL;
     size_t count = 0;
     size_t capacity = 0;
 
-    for (size_t i = 0; i < db->count; ++i) {
-        const Movie *movie = &db->movies[i];
-        if (!movie->director_lower) continue;
-        if (strcmp(movie->director_lower, director_lower) == 0) {
+    for (size_t i = 0; i < columns->count; ++i) {
+        uint32_t id = columns->director_id[i];
+        if (id != COLUMNS_NO_DIRECTOR && wanted[id]) {
             if (!append_index(&results, &count, &capacity, i)) {
                 free(results);
                 return 0;
             }
         }
     }
+    return finish_results(results, count, out_indices, out_count);
+}
 
-    if (count == 0) {
+static int compare_size(const void *lhs, const void *rhs) {
+    size_t a = *(const size_t *)lhs;
+    size_t b = *(const size_t *)rhs;
+    return (a > b) - (a < b);
+}
+
+/* Copy one person's posting list out as the caller-owned result array. */
+static int person_to_results(const PersonIndex *people, uint32_t person, PersonRole role, size_t **out_indices, size_t *out_count) {
+    size_t *results = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    if (!person_index_collect(people, person, role, &results, &count, &capacity)) {
         free(results);
         return 0;
     }
+    return finish_results(results, count, out_indices, out_count);
+}
 
-    *out_indices = results;
-    *out_count = count;
-    return 1;
+/* Union of the role postings of every person whose name contains needle, ascending. */
+static int collect_people_partial(const MovieDatabase *db, PersonRole role, const char *needle, size_t **out_indices, size_t *out_count) {
+    const PersonIndex *people = &db->people;
+    size_t *results = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t lists = 0;
+    uint32_t *ids = NULL;
+    size_t id_count = 0;
+
+    text_blob_search(&people->name_text, needle, &ids, &id_count);
+    for (size_t i = 0; i < id_count; ++i) {
+        size_t before = count;
+        if (!person_index_collect(people, ids[i], role, &results, &count, &capacity)) {
+            free(ids);
+            free(results);
+            return 0;
+        }
+        if (count > before) lists++;
+    }
+    free(ids);
+
+    if (lists > 1) {
+        qsort(results, count, sizeof(size_t), compare_size);
+        size_t unique = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (unique == 0 || results[unique - 1] != results[i]) results[unique++] = results[i];
+        }
+        count = unique;
+    }
+    return finish_results(results, count, out_indices, out_count);
+}
+
+int search_by_director(const MovieDatabase *db, const char *director_lower, size_t **out_indices, size_t *out_count) {
+    if (out_indices) *out_indices = NULL;
+    if (out_count) *out_count = 0;
+    if (!db || !director_lower || !out_indices || !out_count) return 0;
+
+    uint32_t person = person_index_find(&db->people, director_lower);
+    if (person_index_posting_count(&db->people, person, PERSON_ROLE_DIRECTOR) > 0) {
+        return person_to_results(&db->people, person, PERSON_ROLE_DIRECTOR, out_indices, out_count);
+    }
+    if (!strchr(director_lower, ',')) return 0;
+
+    /* A whole multi-director field: match it against the director column. */
+    uint32_t target = string_dictionary_find(&db->columns.directors, director_lower);
+    if (target == COLUMNS_NOT_FOUND) return 0;
+    unsigned char *wanted = (unsigned char *)calloc(db->columns.directors.count, 1);
+    if (!wanted) return 0;
+    wanted[target] = 1;
+    int found = collect_by_director_ids(db, wanted, out_indices, out_count);
+    free(wanted);
+    return found;
 }
 
 int search_by_director_partial(const MovieDatabase *db, const char *director_substr_lower, size_t **out_indices, size_t *out_count) {
@@ -270,60 +612,98 @@ int search_by_director_partial(const MovieDatabase *db, const char *director_sub
     if (out_count) *out_count = 0;
     if (!db || !director_substr_lower || !out_indices || !out_count) return 0;
 
-    size_t *results = NULL;
-    size_t count = 0;
-    size_t capacity = 0;
+    if (!strchr(director_substr_lower, ',')) {
+        return collect_people_partial(db, PERSON_ROLE_DIRECTOR, director_substr_lower, out_indices, out_count);
+    }
 
-    for (size_t i = 0; i < db->count; ++i) {
-        const Movie *movie = &db->movies[i];
-        if (!movie->director_lower) continue;
-        if (strstr(movie->director_lower, director_substr_lower) != NULL) {
-            if (!append_index(&results, &count, &capacity, i)) {
-                free(results);
-                return 0;
-            }
+    /* The needle spans several names, so match it against whole director fields. */
+    const StringDictionary *directors = &db->columns.directors;
+    if (directors->count == 0) return 0;
+    unsigned char *wanted = (unsigned char *)calloc(directors->count, 1);
+    if (!wanted) return 0;
+    int any = 0;
+    size_t needle_len = strlen(director_substr_lower);
+    for (size_t id = 0; id < directors->count; ++id) {
+        if (substring_find(directors->names[id], strlen(directors->names[id]), director_substr_lower, needle_len) != NULL) {
+            wanted[id] = 1;
+            any = 1;
         }
     }
+    int found = any ? collect_by_director_ids(db, wanted, out_indices, out_count) : 0;
+    free(wanted);
+    return found;
+}
 
-    if (count == 0) {
-        free(results);
-        return 0;
-    }
+int search_by_cast(const MovieDatabase *db, const char *actor_lower, size_t **out_indices, size_t *out_count) {
+    if (out_indices) *out_indices = NULL;
+    if (out_count) *out_count = 0;
+    if (!db || !actor_lower || !out_indices || !out_count) return 0;
 
-    *out_indices = results;
-    *out_count = count;
-    return 1;
+    uint32_t person = person_index_find(&db->people, actor_lower);
+    return person_to_results(&db->people, person, PERSON_ROLE_CAST, out_indices, out_count);
 }
-int search_by_genre(const MovieDatabase *db, const char *genre_lower, size_t **out_indices, size_t *out_count) {
+
+int search_by_cast_partial(const MovieDatabase *db, const char *actor_substr_lower, size_t **out_indices, size_t *out_count) {
     if (out_indices) *out_indices = NULL;
     if (out_count) *out_count = 0;
-    if (!db || !genre_lower || !out_indices || !out_count) return 0;
+    if (!db || !actor_substr_lower || !out_indices || !out_count) return 0;
 
-    size_t *results = NULL;
-    size_t count = 0;
-    size_t capacity = 0;
+    return collect_people_partial(db, PERSON_ROLE_CAST, actor_substr_lower, out_indices, out_count);
+}
 
-    for (size_t i = 0; i < db->count; ++i) {
-        const Movie *movie = &db->movies[i];
-        for (size_t j = 0; j < movie->genre_count; ++j) {
-            if (strcmp(movie->genres[j], genre_lower) == 0) {
-                if (!append_index(&results, &count, &capacity, i)) {
-                    free(results);
-                    return 0;
-                }
-                break;
-            }
-        }
+/* OR of the movie sets of every genre whose name contains needle. */
+static void collect_genres(const MovieDatabase *db, const char *needle, ResultSet *out) {
+    const MovieColumns *columns = &db->columns;
+    ResultSet merged;
+    result_set_init(&merged);
+    result_set_clear(out);
+    size_t needle_len = strlen(needle);
+    for (size_t id = 0; id < columns->genres.count && id < columns->genre_movies_count; ++id) {
+        const char *name = columns->genres.names[id];
+        if (substring_find(name, strlen(name), needle, needle_len) == NULL) continue;
+        result_set_or(&merged, out, &columns->genre_movies[id]);
+        ResultSet swap = *out;
+        *out = merged;
+        merged = swap;
     }
+    result_set_free(&merged);
+}
 
-    if (count == 0) {
-        free(results);
-        return 0;
+/* OR of the movie sets of the release years in [from, to]; the range may reach past the catalog's years. */
+static void collect_years(const MovieDatabase *db, int from, int to, ResultSet *out) {
+    const MovieColumns *columns = &db->columns;
+    result_set_clear(out);
+    if (columns->year_span == 0) return;
+    int last = columns->year_first + (int)(columns->year_span - 1);
+    if (from < columns->year_first) from = columns->year_first;
+    if (to > last) to = last;
+    ResultSet merged;
+    result_set_init(&merged);
+    for (int year = from; year <= to; ++year) {
+        const ResultSet *movies = movie_columns_find_year(&db->columns, year);
+        if (!movies || movies->count == 0) continue;
+        result_set_or(&merged, out, movies);
+        ResultSet swap = *out;
+        *out = merged;
+        merged = swap;
     }
+    result_set_free(&merged);
+}
 
-    *out_indices = results;
-    *out_count = count;
-    return 1;
+static int set_to_results(ResultSet *set, size_t **out_indices, size_t *out_count) {
+    int found = result_set_to_indices(set, out_indices, out_count);
+    result_set_free(set);
+    return found;
+}
+
+int search_by_genre(const MovieDatabase *db, const char *genre_lower, size_t **out_indices, size_t *out_count) {
+    if (out_indices) *out_indices = NULL;
+    if (out_count) *out_count = 0;
+    if (!db || !genre_lower || !out_indices || !out_count) return 0;
+
+    uint32_t target = string_dictionary_find(&db->columns.genres, genre_lower);
+    if (target == COLUMNS_NOT_FOUND || target >= db->columns.genre_movies_count) return 0;
+    return result_set_to_indices(&db->columns.genre_movies[target], out_indices, out_count);
 }
 
 int search_by_genre_partial(const MovieDatabase *db, const char *genre_substr_lower, size_t **out_indices, size_t *out_count) {
@@ -331,58 +711,213 @@ int search_by_genre_partial(const MovieDatabase *db, const char *genre_substr_lo
     if (out_count) *out_count = 0;
     if (!db || !genre_substr_lower || !out_indices || !out_count) return 0;
 
-    size_t *results = NULL;
-    size_t count = 0;
-    size_t capacity = 0;
+    ResultSet movies;
+    result_set_init(&movies);
+    collect_genres(db, genre_substr_lower, &movies);
+    return set_to_results(&movies, out_indices, out_count);
+}
 
-    for (size_t i = 0; i < db->count; ++i) {
-        const Movie *movie = &db->movies[i];
-        for (size_t j = 0; j < movie->genre_count; ++j) {
-            if (strstr(movie->genres[j], genre_substr_lower) != NULL) {
-                if (!append_index(&results, &count, &capacity, i)) {
-                    free(results);
-                    return 0;
-                }
-                break;
-            }
-        }
-    }
+int search_by_release_year(const MovieDatabase *db, int year, size_t **out_indices, size_t *out_count) {
+    if (out_indices) *out_indices = NULL;
+    if (out_count) *out_count = 0;
+    if (!db || year <= 0 || !out_indices || !out_count) return 0;
 
-    if (count == 0) {
-        free(results);
-        return 0;
-    }
+    const ResultSet *movies = movie_columns_find_year(&db->columns, year);
+    return movies ? result_set_to_indices(movies, out_indices, out_count) : 0;
+}
 
+/* Copy up to limit movies of slice out as result indices, newest (last) first when reverse. */
+static int order_to_results(const MovieOrder *order, const int *values, MovieOrderSlice *slice, size_t limit,
+                            int reverse, size_t **out_indices, size_t *out_count) {
+    size_t count = movie_order_slice_count(slice);
+    if (count > limit) count = limit;
+    if (count == 0) return 0;
+    size_t *results = (size_t *)malloc(count * sizeof(size_t));
+    if (!results) return 0;
+    if (reverse) movie_order_take_last(order, values, slice, results, count);
+    else movie_order_take(order, values, slice, results, count);
     *out_indices = results;
     *out_count = count;
     return 1;
 }
-int search_by_release_year(const MovieDatabase *db, int year, size_t **out_indices, size_t *out_count) {
+
+int search_by_release_year_range(const MovieDatabase *db, int from, int to, size_t **out_indices, size_t *out_count) {
     if (out_indices) *out_indices = NULL;
     if (out_count) *out_count = 0;
-    if (!db || year <= 0 || !out_indices || !out_count) return 0;
+    if (!db || from > to || to <= 0 || !out_indices || !out_count) return 0;
 
-    size_t *results = NULL;
-    size_t count = 0;
-    size_t capacity = 0;
+    const MovieColumns *columns = &db->columns;
+    MovieOrderSlice slice;
+    movie_order_range(&columns->year_order, columns->release_year, from, to, &slice);
+    return order_to_results(&columns->year_order, columns->release_year, &slice, SIZE_MAX, 0, out_indices, out_count);
+}
 
-    for (size_t i = 0; i < db->count; ++i) {
-        const Movie *movie = &db->movies[i];
-        if (movie->release_year_num == year) {
-            if (!append_index(&results, &count, &capacity, i)) {
-                free(results);
-                return 0;
-            }
+int search_by_nearest_year(const MovieDatabase *db, int year, size_t k, size_t **out_indices, size_t *out_count) {
+    if (out_indices) *out_indices = NULL;
+    if (out_count) *out_count = 0;
+    if (!db || k == 0 || !out_indices || !out_count) return 0;
+
+    const MovieColumns *columns = &db->columns;
+    const MovieOrder *order = &columns->year_order;
+    const int *years = columns->release_year;
+    size_t total = movie_order_count(order);
+    if (total == 0) return 0;
+    if (k > total) k = total;
+    size_t *results = (size_t *)malloc(k * sizeof(size_t));
+    if (!results) return 0;
+
+    /* Walk outwards from year. Each side is taken a whole year at a time, so
+     * a year's movies stay in index order and an equal distance favours the
+     * earlier year. */
+    MovieOrderSlice older;
+    MovieOrderSlice newer;
+    movie_order_range(order, years, year, INT_MAX, &newer);
+    movie_order_all(order, &older);
+    older.base_hi = newer.base_lo;
+    older.delta_hi = newer.delta_lo;
+    size_t count = 0;
+    while (count < k) {
+        int left_year = 0;
+        int right_year = 0;
+        int have_left = movie_order_last_value(order, years, &older, &left_year);
+        int have_right = movie_order_first_value(order, years, &newer, &right_year);
+        int take_left = have_left && (!have_right || (long)year - left_year <= (long)right_year - year);
+        int y = take_left ? left_year : right_year;
+        MovieOrderSlice same;
+        movie_order_range(order, years, y, y, &same);
+        if (take_left) {
+            older.base_hi = same.base_lo;
+            older.delta_hi = same.delta_lo;
+        } else {
+            newer.base_lo = same.base_hi;
+            newer.delta_lo = same.delta_hi;
         }
+        count += movie_order_take(order, years, &same, results + count, k - count);
     }
-
-    if (count == 0) {
-        free(results);
-        return 0;
-    }
-
     *out_indices = results;
     *out_count = count;
     return 1;
 }
 
+int search_by_date_added_range(const MovieDatabase *db, int from_days, int to_days, size_t **out_indices, size_t *out_count) {
+    if (out_indices) *out_indices = NULL;
+    if (out_count) *out_count = 0;
+    if (!db || from_days > to_days || !out_indices || !out_count) return 0;
+
+    const MovieColumns *columns = &db->columns;
+    MovieOrderSlice slice;
+    movie_order_range(&columns->added_order, columns->date_added, from_days, to_days, &slice);
+    return order_to_results(&columns->added_order, columns->date_added, &slice, SIZE_MAX, 0, out_indices, out_count);
+}
+
+int search_added_within_days(const MovieDatabase *db, int days, size_t **out_indices, size_t *out_count) {
+    if (out_indices) *out_indices = NULL;
+    if (out_count) *out_count = 0;
+    if (!db || days <= 0 || !out_indices || !out_count) return 0;
+
+    const MovieColumns *columns = &db->columns;
+    MovieOrderSlice slice;
+    movie_order_all(&columns->added_order, &slice);
+    int newest = 0;
+    if (!movie_order_last_value(&columns->added_order, columns->date_added, &slice, &newest)) return 0;
+    movie_order_range(&columns->added_order, columns->date_added, newest - (days - 1), INT_MAX, &slice);
+    return order_to_results(&columns->added_order, columns->date_added, &slice, SIZE_MAX, 1, out_indices, out_count);
+}
+
+int search_recently_added(const MovieDatabase *db, size_t offset, size_t limit, size_t **out_indices, size_t *out_count) {
+    if (out_indices) *out_indices = NULL;
+    if (out_count) *out_count = 0;
+    if (!db || limit == 0 || !out_indices || !out_count) return 0;
+
+    const MovieColumns *columns = &db->columns;
+    MovieOrderSlice slice;
+    movie_order_all(&columns->added_order, &slice);
+    if (movie_order_take_last(&columns->added_order, columns->date_added, &slice, NULL, offset) < offset) return 0;
+    return order_to_results(&columns->added_order, columns->date_added, &slice, limit, 1, out_indices, out_count);
+}
+
+void search_query_init(SearchQuery *query) {
+    if (!query) return;
+    query->title_substr_lower = NULL;
+    query->director_substr_lower = NULL;
+    query->genre_substr_lower = NULL;
+    query->exclude_genre_substr_lower = NULL;
+    query->year_from = 0;
+    query->year_to = 0;
+}
+
+static int query_text_set(const char *text) {
+    return text && text[0] != '\0';
+}
+
+/* Intersect out with set, or start out from set for the first predicate; set is emptied. */
+static void narrow_results(ResultSet *out, int *applied, ResultSet *set) {
+    if (!*applied) {
+        result_set_free(out);
+        *out = *set;
+        result_set_init(set);
+        *applied = 1;
+        return;
+    }
+    ResultSet narrowed;
+    result_set_init(&narrowed);
+    result_set_and(&narrowed, out, set);
+    result_set_free(out);
+    *out = narrowed;
+    result_set_clear(set);
+}
+
+int search_query_run(const MovieDatabase *db, const TitleIndex *titles, const SearchQuery *query, ResultSet *out) {
+    if (!db || !query || !out) return 0;
+    result_set_clear(out);
+
+    /* Each predicate becomes a set and the sets are intersected. */
+    int applied = 0;
+    ResultSet set;
+    result_set_init(&set);
+
+    if (query_text_set(query->genre_substr_lower)) {
+        collect_genres(db, query->genre_substr_lower, &set);
+        narrow_results(out, &applied, &set);
+    }
+    if (query->year_from > 0 || query->year_to > 0) {
+        int from = query->year_from > 0 ? query->year_from : db->columns.year_first;
+        int to = query->year_to > 0 ? query->year_to : db->columns.year_first + (int)db->columns.year_span - 1;
+        collect_years(db, from, to, &set);
+        narrow_results(out, &applied, &set);
+    }
+    if (query_text_set(query->director_substr_lower) && (!applied || out->count > 0)) {
+        size_t *indices = NULL;
+        size_t count = 0;
+        if (search_by_director_partial(db, query->director_substr_lower, &indices, &count)) {
+            result_set_from_indices(&set, indices, count);
+            free(indices);
+        }
+        narrow_results(out, &applied, &set);
+    }
+    if (query_text_set(query->title_substr_lower) && (!applied || out->count > 0)) {
+        size_t *indices = NULL;
+        size_t count = 0;
+        if (titles && title_index_partial_search(titles, query->title_substr_lower, &indices, &count)) {
+            result_set_from_indices(&set, indices, count);
+            free(indices);
+        }
+        narrow_results(out, &applied, &set);
+    }
+    if (!applied) {
+        /* Only exclusions, or nothing at all: start from the whole catalog. */
+        ResultSet none;
+        result_set_init(&none);
+        result_set_not(out, &none, db->count);
+    }
+    if (query_text_set(query->exclude_genre_substr_lower) && out->count > 0) {
+        collect_genres(db, query->exclude_genre_substr_lower, &set);
+        ResultSet kept;
+        result_set_init(&kept);
+        result_set_andnot(&kept, out, &set);
+        result_set_free(out);
+        *out = kept;
+    }
+    result_set_free(&set);
+    return result_set_cardinality(out) > 0;
+}
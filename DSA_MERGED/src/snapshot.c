@@ -0,0 +1,1078 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "snapshot.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SNAPSHOT_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SNAPSHOT_MAGIC "MOVSNAP"
+#define SNAPSHOT_ENDIAN_TAG 0x01020304u
+
+/*
+ * File layout, every section 8-byte aligned:
+ *   SnapshotHeader
+ *   SnapshotMovie[movie_count]
+ *   uint64_t genre string offsets[genre_count]
+ *   SnapshotKey[key_count]            title index keys, in key id order
+ *   uint64_t postings[posting_count]  movie indices of every key, back to back
+ *   TitleIndexGroup[slot_count / TITLE_GROUP_WIDTH]  title index hash slots
+ *   uint32_t grams[gram_count]        trigram codes of the title trigram index
+ *   uint64_t gram_offsets[gram_count + 1]
+ *   uint32_t gram_postings[gram_posting_count]  key ids, grouped by trigram
+ *   uint64_t gram_delta[gram_delta_count]       trigram << 32 | key id
+ *   char strings[strings_size]        NUL-terminated strings referenced by offset
+ *   sections[SNAPSHOT_SECTION_COUNT]  the finished columns, dictionaries, movie sets,
+ *                                     orders (base, then delta) and person index, each
+ *                                     at the offset and with the count the header
+ *                                     records, so a load only points into them
+ */
+
+/* Sections after the string blob, in file order. */
+enum {
+    SECTION_YEARS,           /* int32_t MovieColumns.release_year per movie */
+    SECTION_ADDED,           /* int32_t MovieColumns.date_added per movie */
+    SECTION_DIRECTOR_IDS,    /* uint32_t MovieColumns.director_id per movie */
+    SECTION_GENRE_SETS,      /* GenreSet per movie */
+    SECTION_TYPE_CODES,      /* unsigned char MOVIE_TYPE_* per movie */
+    SECTION_DIRECTOR_NAMES,  /* uint64_t string offset per director id */
+    SECTION_DIRECTOR_HASHES, /* uint64_t string_dictionary_hash per director id */
+    SECTION_DIRECTOR_SLOTS,  /* uint32_t director dictionary slots */
+    SECTION_GENRE_NAMES,
+    SECTION_GENRE_HASHES,
+    SECTION_GENRE_SLOTS,
+    SECTION_PERSON_NAMES,    /* uint64_t string offset per person id */
+    SECTION_PERSON_HASHES,
+    SECTION_PERSON_SLOTS,
+    SECTION_DIRECTED_OFFSETS,  /* uint64_t PersonPostings.offsets, base_people + 1 or none */
+    SECTION_DIRECTED_POSTINGS, /* uint32_t movie indices */
+    SECTION_DIRECTED_DELTA,    /* uint64_t person << 32 | movie */
+    SECTION_CAST_OFFSETS,
+    SECTION_CAST_POSTINGS,
+    SECTION_CAST_DELTA,
+    SECTION_SETS,            /* SnapshotSet: the year movie sets, then the genre movie sets */
+    SECTION_CONTAINERS,      /* SnapshotContainer, in set order */
+    SECTION_SET_VALUES,      /* uint16_t low halves of the array containers */
+    SECTION_SET_WORDS,       /* uint64_t words of the bitmap containers */
+    SECTION_YEAR_ORDER,      /* uint32_t MovieColumns.year_order base */
+    SECTION_YEAR_DELTA,      /* uint32_t MovieColumns.year_order delta */
+    SECTION_ADDED_ORDER,     /* uint32_t MovieColumns.added_order base */
+    SECTION_ADDED_DELTA,     /* uint32_t MovieColumns.added_order delta */
+    SNAPSHOT_SECTION_COUNT
+};
+
+/* First postings section of a role; offsets, postings and delta follow in that order. */
+#define SECTION_ROLE_FIRST(role) (SECTION_DIRECTED_OFFSETS + 3 * (size_t)(role))
+
+static const size_t snapshot_section_sizes[SNAPSHOT_SECTION_COUNT] = {
+    sizeof(int32_t), sizeof(int32_t), sizeof(uint32_t), sizeof(GenreSet), sizeof(unsigned char),
+    sizeof(uint64_t), sizeof(uint64_t), sizeof(uint32_t),
+    sizeof(uint64_t), sizeof(uint64_t), sizeof(uint32_t),
+    sizeof(uint64_t), sizeof(uint64_t), sizeof(uint32_t),
+    sizeof(uint64_t), sizeof(uint32_t), sizeof(uint64_t),
+    sizeof(uint64_t), sizeof(uint32_t), sizeof(uint64_t),
+    2 * sizeof(uint64_t), 2 * sizeof(uint64_t), sizeof(uint16_t), sizeof(uint64_t),
+    sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t),
+};
+
+typedef struct {
+    uint64_t offset;
+    uint64_t count;
+} SnapshotSection;
+
+typedef struct {
+    uint64_t first; /* first container */
+    uint64_t count;
+} SnapshotSet;
+
+typedef struct {
+    uint16_t key;
+    uint16_t kind;        /* RESULT_CONTAINER_* */
+    uint32_t cardinality;
+    uint64_t data;        /* first value, or first word of a bitmap */
+} SnapshotContainer;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t movie_count;
+    uint64_t genre_count;
+    uint64_t slot_count;
+    uint64_t key_count;
+    uint64_t posting_count;
+    uint64_t gram_count;
+    uint64_t gram_posting_count;
+    uint64_t gram_delta_count;
+    uint64_t strings_size;
+    uint64_t movies_offset;
+    uint64_t genres_offset;
+    uint64_t keys_offset;
+    uint64_t postings_offset;
+    uint64_t groups_offset;
+    uint64_t grams_offset;
+    uint64_t gram_offsets_offset;
+    uint64_t gram_postings_offset;
+    uint64_t gram_delta_offset;
+    uint64_t strings_offset;
+    uint64_t genre_overflow;
+    int64_t year_first;
+    uint64_t year_span;    /* the first year_span sets are the year movie sets */
+    SnapshotSection sections[SNAPSHOT_SECTION_COUNT];
+    uint64_t file_size;
+    uint64_t checksum; /* over every byte after the header */
+} SnapshotHeader;
+
+#define SNAPSHOT_FIELD_COUNT 14
+
+static const size_t snapshot_fields[SNAPSHOT_FIELD_COUNT] = {
+    offsetof(Movie, show_id),
+    offsetof(Movie, type),
+    offsetof(Movie, title),
+    offsetof(Movie, title_lower),
+    offsetof(Movie, director),
+    offsetof(Movie, director_lower),
+    offsetof(Movie, cast),
+    offsetof(Movie, country),
+    offsetof(Movie, date_added),
+    offsetof(Movie, release_year),
+    offsetof(Movie, rating),
+    offsetof(Movie, duration),
+    offsetof(Movie, listed_in),
+    offsetof(Movie, description),
+};
+
+#define SNAPSHOT_TITLE_LOWER_FIELD 3
+#define SNAPSHOT_DIRECTOR_LOWER_FIELD 5
+
+typedef struct {
+    uint64_t fields[SNAPSHOT_FIELD_COUNT]; /* string offsets, in snapshot_fields order */
+    uint64_t genre_first;
+    uint64_t genre_count;
+    int64_t release_year_num;
+    int64_t date_added_days;
+} SnapshotMovie;
+
+typedef struct {
+    uint64_t key; /* string offset */
+    uint64_t hash;
+    uint64_t first;
+    uint64_t count;
+} SnapshotKey;
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static void set_error(char **error_message, const char *message, const char *path) {
+    if (!error_message) return;
+    size_t len = strlen(message) + (path ? strlen(path) : 0) + 4;
+    *error_message = (char *)checked_malloc(len);
+    snprintf(*error_message, len, "%s%s%s", message, path ? ": " : "", path ? path : "");
+}
+
+static char **movie_field(Movie *movie, size_t field) {
+    return (char **)((char *)movie + snapshot_fields[field]);
+}
+
+static const char *movie_field_const(const Movie *movie, size_t field) {
+    return *(char *const *)((const char *)movie + snapshot_fields[field]);
+}
+
+/* ---- checksum: four 64-bit multiply/rotate lanes over 32-byte blocks ---- */
+
+#define CHECKSUM_P1 0x9E3779B185EBCA87ull
+#define CHECKSUM_P2 0xC2B2AE3D27D4EB4Full
+
+typedef struct {
+    uint64_t lanes[4];
+    unsigned char pending[32];
+    size_t pending_len;
+    uint64_t total;
+} SnapshotChecksum;
+
+static uint64_t rotl64(uint64_t v, unsigned r) {
+    return (v << r) | (v >> (64u - r));
+}
+
+static uint64_t read_u64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void checksum_init(SnapshotChecksum *c) {
+    c->lanes[0] = CHECKSUM_P1 + CHECKSUM_P2;
+    c->lanes[1] = CHECKSUM_P2;
+    c->lanes[2] = 0;
+    c->lanes[3] = (uint64_t)0 - CHECKSUM_P1;
+    c->pending_len = 0;
+    c->total = 0;
+}
+
+static void checksum_block(SnapshotChecksum *c, const unsigned char *block) {
+    for (size_t i = 0; i < 4; ++i) {
+        c->lanes[i] = rotl64(c->lanes[i] + read_u64(block + i * 8) * CHECKSUM_P2, 31) * CHECKSUM_P1;
+    }
+}
+
+static void checksum_update(SnapshotChecksum *c, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    c->total += len;
+    if (c->pending_len > 0) {
+        size_t take = 32 - c->pending_len;
+        if (take > len) take = len;
+        memcpy(c->pending + c->pending_len, p, take);
+        c->pending_len += take;
+        p += take;
+        len -= take;
+        if (c->pending_len < 32) return;
+        checksum_block(c, c->pending);
+        c->pending_len = 0;
+    }
+    while (len >= 32) {
+        checksum_block(c, p);
+        p += 32;
+        len -= 32;
+    }
+    memcpy(c->pending, p, len);
+    c->pending_len = len;
+}
+
+static uint64_t checksum_final(const SnapshotChecksum *c) {
+    uint64_t h = rotl64(c->lanes[0], 1) + rotl64(c->lanes[1], 7) + rotl64(c->lanes[2], 12) + rotl64(c->lanes[3], 18);
+    h ^= c->total * CHECKSUM_P1;
+    for (size_t i = 0; i < c->pending_len; ++i) {
+        h = rotl64(h ^ (uint64_t)c->pending[i] * CHECKSUM_P2, 11) * CHECKSUM_P1;
+    }
+    h ^= h >> 33;
+    h *= CHECKSUM_P2;
+    h ^= h >> 29;
+    return h;
+}
+
+/* ---- writing ---- */
+
+typedef struct {
+    FILE *fp;
+    SnapshotChecksum checksum;
+    int failed;
+} SnapshotWriter;
+
+static void writer_put(SnapshotWriter *w, const void *data, size_t len) {
+    if (w->failed || len == 0) return;
+    if (fwrite(data, 1, len, w->fp) != len) {
+        w->failed = 1;
+        return;
+    }
+    checksum_update(&w->checksum, data, len);
+}
+
+static uint64_t align8(uint64_t value) {
+    return (value + 7u) & ~(uint64_t)7u;
+}
+
+/* Strings appended to the end of the blob, for names no movie field holds verbatim. */
+typedef struct {
+    const char **items;
+    size_t count;
+} SnapshotStrings;
+
+static uint64_t strings_append(SnapshotStrings *extra, uint64_t *strings_size, const char *value) {
+    uint64_t offset = *strings_size;
+    extra->items[extra->count++] = value;
+    *strings_size += strlen(value) + 1;
+    return offset;
+}
+
+/* Fill the name offsets of dict the movies left unset (UINT64_MAX) and copy its hashes to 64 bits. */
+static uint64_t *dictionary_sections(const StringDictionary *dict, uint64_t *names, SnapshotStrings *extra,
+                                     uint64_t *strings_size) {
+    uint64_t *hashes = (uint64_t *)checked_malloc((dict->count + 1) * sizeof(uint64_t));
+    for (size_t id = 0; id < dict->count; ++id) {
+        if (names[id] == UINT64_MAX) names[id] = strings_append(extra, strings_size, dict->names[id]);
+        hashes[id] = (uint64_t)dict->hashes[id];
+    }
+    return hashes;
+}
+
+static uint64_t *widen(const size_t *values, size_t count) {
+    uint64_t *wide = (uint64_t *)checked_malloc((count + 1) * sizeof(uint64_t));
+    for (size_t i = 0; i < count; ++i) wide[i] = (uint64_t)values[i];
+    return wide;
+}
+
+static uint64_t *unset_offsets(size_t count) {
+    uint64_t *offsets = (uint64_t *)checked_malloc((count + 1) * sizeof(uint64_t));
+    for (size_t i = 0; i < count; ++i) offsets[i] = UINT64_MAX;
+    return offsets;
+}
+
+/* The year and genre movie sets of the columns, flattened container by container. */
+typedef struct {
+    SnapshotSet *sets;
+    SnapshotContainer *containers;
+    uint16_t *values;
+    uint64_t *words;
+    size_t set_count;
+    size_t container_count;
+    size_t value_count;
+    size_t word_count;
+} SnapshotSets;
+
+static const ResultSet *column_set(const MovieColumns *columns, size_t i) {
+    return i < columns->year_span ? &columns->year_movies[i] : &columns->genre_movies[i - columns->year_span];
+}
+
+static void snapshot_sets_build(SnapshotSets *out, const MovieColumns *columns) {
+    memset(out, 0, sizeof(*out));
+    out->set_count = columns->year_span + columns->genre_movies_count;
+    for (size_t i = 0; i < out->set_count; ++i) {
+        const ResultSet *set = column_set(columns, i);
+        out->container_count += set->count;
+        for (size_t c = 0; c < set->count; ++c) {
+            const ResultContainer *container = &set->containers[c];
+            if (container->kind == RESULT_CONTAINER_BITMAP) out->word_count += RESULT_BITMAP_WORDS;
+            else out->value_count += container->cardinality;
+        }
+    }
+    out->sets = (SnapshotSet *)checked_malloc((out->set_count + 1) * sizeof(SnapshotSet));
+    out->containers = (SnapshotContainer *)checked_malloc((out->container_count + 1) * sizeof(SnapshotContainer));
+    out->values = (uint16_t *)checked_malloc((out->value_count + 1) * sizeof(uint16_t));
+    out->words = (uint64_t *)checked_malloc((out->word_count + 1) * sizeof(uint64_t));
+    size_t containers = 0;
+    size_t values = 0;
+    size_t words = 0;
+    for (size_t i = 0; i < out->set_count; ++i) {
+        const ResultSet *set = column_set(columns, i);
+        out->sets[i].first = containers;
+        out->sets[i].count = set->count;
+        for (size_t c = 0; c < set->count; ++c) {
+            const ResultContainer *container = &set->containers[c];
+            SnapshotContainer *record = &out->containers[containers++];
+            record->key = container->key;
+            record->kind = container->kind;
+            record->cardinality = container->cardinality;
+            if (container->kind == RESULT_CONTAINER_BITMAP) {
+                record->data = words;
+                memcpy(out->words + words, container->words, RESULT_BITMAP_WORDS * sizeof(uint64_t));
+                words += RESULT_BITMAP_WORDS;
+            } else {
+                record->data = values;
+                memcpy(out->values + values, container->values, container->cardinality * sizeof(uint16_t));
+                values += container->cardinality;
+            }
+        }
+    }
+}
+
+static void snapshot_sets_free(SnapshotSets *sets) {
+    free(sets->sets);
+    free(sets->containers);
+    free(sets->values);
+    free(sets->words);
+}
+
+static int source_stat(const char *source_path, uint64_t *out_size, int64_t *out_mtime) {
+#ifdef SNAPSHOT_HAVE_MMAP
+    struct stat st;
+    if (!source_path || stat(source_path, &st) != 0) return 0;
+    *out_size = (uint64_t)st.st_size;
+    *out_mtime = (int64_t)st.st_mtime;
+    return 1;
+#else
+    (void)source_path;
+    (void)out_size;
+    (void)out_mtime;
+    return 0;
+#endif
+}
+
+int snapshot_write(const char *path, const MovieDatabase *db, const TitleIndex *index,
+                   const char *source_path, char **error_message) {
+    if (error_message) *error_message = NULL;
+    if (!path || !db || !index) return 0;
+    const MovieColumns *columns = &db->columns;
+    if (columns->count != db->count) {
+        set_error(error_message, "Snapshot needs the catalog columns built", path);
+        return 0;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.endian_tag = SNAPSHOT_ENDIAN_TAG;
+    source_stat(source_path, &header.source_size, &header.source_mtime);
+
+    /* Lay out the string blob: movie fields and genres in movie order. */
+    SnapshotMovie *records = (SnapshotMovie *)checked_malloc((db->count + 1) * sizeof(SnapshotMovie));
+    uint64_t strings_size = 0;
+    uint64_t genre_count = 0;
+    for (size_t i = 0; i < db->count; ++i) {
+        const Movie *movie = &db->movies[i];
+        SnapshotMovie *record = &records[i];
+        for (size_t f = 0; f < SNAPSHOT_FIELD_COUNT; ++f) {
+            const char *value = movie_field_const(movie, f);
+            record->fields[f] = strings_size;
+            strings_size += (value ? strlen(value) : 0) + 1;
+        }
+        record->genre_first = genre_count;
+        record->genre_count = movie->genre_count;
+        record->release_year_num = movie->release_year_num;
+        record->date_added_days = movie->date_added_days;
+        genre_count += movie->genre_count;
+    }
+    uint64_t *genre_offsets = (uint64_t *)checked_malloc((genre_count + 1) * sizeof(uint64_t));
+    genre_count = 0;
+    for (size_t i = 0; i < db->count; ++i) {
+        const Movie *movie = &db->movies[i];
+        for (size_t g = 0; g < movie->genre_count; ++g) {
+            genre_offsets[genre_count++] = strings_size;
+            strings_size += strlen(movie->genres[g]) + 1;
+        }
+    }
+
+    /* Dictionary names share the strings of the movies they were interned from;
+     * the folded person names have no such string and all go to the end. */
+    const PersonIndex *people = &db->people;
+    SnapshotStrings extra;
+    extra.items = (const char **)checked_malloc(
+        (columns->directors.count + columns->genres.count + people->names.count + 1) * sizeof(char *));
+    extra.count = 0;
+    uint64_t *director_names = unset_offsets(columns->directors.count);
+    uint64_t *genre_names = unset_offsets(columns->genres.count);
+    genre_count = 0;
+    for (size_t i = 0; i < db->count; ++i) {
+        const Movie *movie = &db->movies[i];
+        uint32_t director = columns->director_id[i];
+        if (director < columns->directors.count && director_names[director] == UINT64_MAX) {
+            director_names[director] = records[i].fields[SNAPSHOT_DIRECTOR_LOWER_FIELD];
+        }
+        for (size_t g = 0; g < movie->genre_count; ++g, ++genre_count) {
+            uint32_t id = string_dictionary_find(&columns->genres, movie->genres[g]);
+            if (id != COLUMNS_NOT_FOUND && genre_names[id] == UINT64_MAX) genre_names[id] = genre_offsets[genre_count];
+        }
+    }
+    uint64_t *director_hashes = dictionary_sections(&columns->directors, director_names, &extra, &strings_size);
+    uint64_t *genre_hashes = dictionary_sections(&columns->genres, genre_names, &extra, &strings_size);
+    uint64_t *person_names = unset_offsets(people->names.count);
+    uint64_t *person_hashes = dictionary_sections(&people->names, person_names, &extra, &strings_size);
+    const PersonPostings *directed = &people->roles[PERSON_ROLE_DIRECTOR];
+    const PersonPostings *cast = &people->roles[PERSON_ROLE_CAST];
+    size_t directed_offsets = directed->offsets ? directed->base_people + 1 : 0;
+    size_t cast_offsets = cast->offsets ? cast->base_people + 1 : 0;
+    uint64_t *directed_wide = widen(directed->offsets, directed_offsets);
+    uint64_t *cast_wide = widen(cast->offsets, cast_offsets);
+    SnapshotSets sets;
+    snapshot_sets_build(&sets, columns);
+
+    const void *section_data[SNAPSHOT_SECTION_COUNT] = {
+        columns->release_year, columns->date_added, columns->director_id, columns->genre_set, columns->type_code,
+        director_names, director_hashes, columns->directors.slots,
+        genre_names, genre_hashes, columns->genres.slots,
+        person_names, person_hashes, people->names.slots,
+        directed_wide, directed->postings, directed->delta,
+        cast_wide, cast->postings, cast->delta,
+        sets.sets, sets.containers, sets.values, sets.words,
+        columns->year_order.base, columns->year_order.delta, columns->added_order.base, columns->added_order.delta,
+    };
+    const size_t section_counts[SNAPSHOT_SECTION_COUNT] = {
+        columns->count, columns->count, columns->count, columns->count, columns->count,
+        columns->directors.count, columns->directors.count, columns->directors.slot_count,
+        columns->genres.count, columns->genres.count, columns->genres.slot_count,
+        people->names.count, people->names.count, people->names.slot_count,
+        directed_offsets, directed_offsets > 0 ? directed->offsets[directed->base_people] : 0, directed->delta_count,
+        cast_offsets, cast_offsets > 0 ? cast->offsets[cast->base_people] : 0, cast->delta_count,
+        sets.set_count, sets.container_count, sets.value_count, sets.word_count,
+        columns->year_order.base_count, columns->year_order.delta_count,
+        columns->added_order.base_count, columns->added_order.delta_count,
+    };
+
+    const TrigramIndex *trigrams = &index->trigrams;
+    uint64_t posting_count = 0;
+    for (size_t i = 0; i < index->size; ++i) {
+        posting_count += index->entries[i].count;
+    }
+
+    header.movie_count = db->count;
+    header.genre_count = genre_count;
+    header.slot_count = index->capacity;
+    header.key_count = index->size;
+    header.posting_count = posting_count;
+    header.gram_count = trigrams->gram_count;
+    header.gram_posting_count = trigrams->posting_count;
+    header.gram_delta_count = trigrams->delta_count;
+    header.strings_size = strings_size;
+    header.movies_offset = align8(sizeof(SnapshotHeader));
+    header.genres_offset = header.movies_offset + header.movie_count * sizeof(SnapshotMovie);
+    header.keys_offset = header.genres_offset + header.genre_count * sizeof(uint64_t);
+    header.postings_offset = header.keys_offset + header.key_count * sizeof(SnapshotKey);
+    header.groups_offset = header.postings_offset + header.posting_count * sizeof(uint64_t);
+    header.grams_offset = header.groups_offset + header.slot_count / TITLE_GROUP_WIDTH * sizeof(TitleIndexGroup);
+    header.gram_offsets_offset = align8(header.grams_offset + header.gram_count * sizeof(uint32_t));
+    header.gram_postings_offset = header.gram_offsets_offset + (header.gram_count + 1) * sizeof(uint64_t);
+    header.gram_delta_offset = align8(header.gram_postings_offset + header.gram_posting_count * sizeof(uint32_t));
+    header.strings_offset = header.gram_delta_offset + header.gram_delta_count * sizeof(uint64_t);
+    header.genre_overflow = (uint64_t)columns->genre_overflow;
+    header.year_first = columns->year_first;
+    header.year_span = columns->year_span;
+    uint64_t section_offset = align8(header.strings_offset + header.strings_size);
+    for (size_t s = 0; s < SNAPSHOT_SECTION_COUNT; ++s) {
+        header.sections[s].offset = section_offset;
+        header.sections[s].count = section_counts[s];
+        section_offset = align8(section_offset + section_counts[s] * snapshot_section_sizes[s]);
+    }
+    header.file_size = section_offset;
+
+    size_t tmp_len = strlen(path) + 8;
+    char *tmp_path = (char *)checked_malloc(tmp_len);
+    snprintf(tmp_path, tmp_len, "%s.tmp", path);
+
+    SnapshotWriter w;
+    w.fp = fopen(tmp_path, "wb");
+    w.failed = w.fp == NULL;
+    checksum_init(&w.checksum);
+
+    if (!w.failed) {
+        unsigned char padding[8] = {0};
+        if (fwrite(&header, sizeof(header), 1, w.fp) != 1) w.failed = 1;
+        if (!w.failed && header.movies_offset > sizeof(header)) {
+            if (fwrite(padding, 1, header.movies_offset - sizeof(header), w.fp) != header.movies_offset - sizeof(header)) {
+                w.failed = 1;
+            }
+        }
+
+        writer_put(&w, records, db->count * sizeof(SnapshotMovie));
+        writer_put(&w, genre_offsets, (size_t)genre_count * sizeof(uint64_t));
+
+        uint64_t first = 0;
+        for (size_t i = 0; i < index->size; ++i) {
+            const TitleIndexEntry *entry = &index->entries[i];
+            SnapshotKey key;
+            /* Keys equal the title_lower of their first movie, so share that string. */
+            key.key = records[entry->indices[0]].fields[SNAPSHOT_TITLE_LOWER_FIELD];
+            key.hash = (uint64_t)entry->hash;
+            key.first = first;
+            key.count = entry->count;
+            first += entry->count;
+            writer_put(&w, &key, sizeof(key));
+        }
+        for (size_t i = 0; i < index->size; ++i) {
+            const TitleIndexEntry *entry = &index->entries[i];
+            for (size_t j = 0; j < entry->count; ++j) {
+                uint64_t value = entry->indices[j];
+                writer_put(&w, &value, sizeof(value));
+            }
+        }
+        writer_put(&w, index->groups, index->capacity / TITLE_GROUP_WIDTH * sizeof(TitleIndexGroup));
+        writer_put(&w, trigrams->grams, trigrams->gram_count * sizeof(uint32_t));
+        writer_put(&w, padding, (size_t)(header.gram_offsets_offset - header.grams_offset - header.gram_count * sizeof(uint32_t)));
+        for (size_t i = 0; i <= trigrams->gram_count; ++i) {
+            uint64_t value = trigrams->offsets ? trigrams->offsets[i] : 0;
+            writer_put(&w, &value, sizeof(value));
+        }
+        writer_put(&w, trigrams->postings, trigrams->posting_count * sizeof(uint32_t));
+        writer_put(&w, padding, (size_t)(header.gram_delta_offset - header.gram_postings_offset - header.gram_posting_count * sizeof(uint32_t)));
+        writer_put(&w, trigrams->delta, trigrams->delta_count * sizeof(uint64_t));
+
+        for (size_t i = 0; i < db->count; ++i) {
+            const Movie *movie = &db->movies[i];
+            for (size_t f = 0; f < SNAPSHOT_FIELD_COUNT; ++f) {
+                const char *value = movie_field_const(movie, f);
+                writer_put(&w, value ? value : "", (value ? strlen(value) : 0) + 1);
+            }
+        }
+        for (size_t i = 0; i < db->count; ++i) {
+            const Movie *movie = &db->movies[i];
+            for (size_t g = 0; g < movie->genre_count; ++g) {
+                writer_put(&w, movie->genres[g], strlen(movie->genres[g]) + 1);
+            }
+        }
+        for (size_t i = 0; i < extra.count; ++i) {
+            writer_put(&w, extra.items[i], strlen(extra.items[i]) + 1);
+        }
+        writer_put(&w, padding, (size_t)(header.sections[0].offset - header.strings_offset - header.strings_size));
+        for (size_t s = 0; s < SNAPSHOT_SECTION_COUNT; ++s) {
+            uint64_t bytes = header.sections[s].count * snapshot_section_sizes[s];
+            uint64_t next = s + 1 < SNAPSHOT_SECTION_COUNT ? header.sections[s + 1].offset : header.file_size;
+            writer_put(&w, section_data[s], (size_t)bytes);
+            writer_put(&w, padding, (size_t)(next - header.sections[s].offset - bytes));
+        }
+
+        header.checksum = checksum_final(&w.checksum);
+        if (!w.failed && (fseek(w.fp, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, w.fp) != 1)) {
+            w.failed = 1;
+        }
+    }
+    if (w.fp && fclose(w.fp) != 0) w.failed = 1;
+
+    free(records);
+    free(genre_offsets);
+    free(extra.items);
+    free(director_names);
+    free(director_hashes);
+    free(genre_names);
+    free(genre_hashes);
+    free(person_names);
+    free(person_hashes);
+    free(directed_wide);
+    free(cast_wide);
+    snapshot_sets_free(&sets);
+
+    if (w.failed || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        free(tmp_path);
+        set_error(error_message, "Failed to write snapshot", path);
+        return 0;
+    }
+    free(tmp_path);
+    return 1;
+}
+
+/* ---- loading ---- */
+
+#ifdef SNAPSHOT_HAVE_MMAP
+
+static int section_fits(uint64_t offset, uint64_t count, uint64_t item_size, uint64_t file_size) {
+    if (offset % 8 != 0 || offset > file_size) return 0;
+    if (item_size != 0 && count > (file_size - offset) / item_size) return 0;
+    return 1;
+}
+
+static int snapshot_header_valid(const SnapshotHeader *h, uint64_t file_size) {
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) return 0;
+    if (h->endian_tag != SNAPSHOT_ENDIAN_TAG || h->file_size != file_size) return 0;
+    if (h->slot_count != 0 && ((h->slot_count & (h->slot_count - 1)) != 0 || h->slot_count < TITLE_GROUP_WIDTH)) return 0;
+    if (h->key_count > h->slot_count) return 0;
+    for (size_t s = 0; s < SNAPSHOT_SECTION_COUNT; ++s) {
+        if (!section_fits(h->sections[s].offset, h->sections[s].count, snapshot_section_sizes[s], file_size)) return 0;
+    }
+    return section_fits(h->movies_offset, h->movie_count, sizeof(SnapshotMovie), file_size) &&
+           section_fits(h->genres_offset, h->genre_count, sizeof(uint64_t), file_size) &&
+           section_fits(h->keys_offset, h->key_count, sizeof(SnapshotKey), file_size) &&
+           section_fits(h->postings_offset, h->posting_count, sizeof(uint64_t), file_size) &&
+           section_fits(h->groups_offset, h->slot_count / TITLE_GROUP_WIDTH, sizeof(TitleIndexGroup), file_size) &&
+           section_fits(h->grams_offset, h->gram_count, sizeof(uint32_t), file_size) &&
+           h->gram_count < UINT64_MAX / sizeof(uint64_t) &&
+           section_fits(h->gram_offsets_offset, h->gram_count + 1, sizeof(uint64_t), file_size) &&
+           section_fits(h->gram_postings_offset, h->gram_posting_count, sizeof(uint32_t), file_size) &&
+           section_fits(h->gram_delta_offset, h->gram_delta_count, sizeof(uint64_t), file_size) &&
+           section_fits(h->strings_offset, h->strings_size, 1, file_size) &&
+           h->movies_offset >= sizeof(SnapshotHeader);
+}
+
+/* The names, hashes and slots sections starting at first describe a probe-able dictionary. */
+static int dictionary_sections_valid(const SnapshotHeader *h, size_t first, const unsigned char *base) {
+    uint64_t count = h->sections[first].count;
+    uint64_t slot_count = h->sections[first + 2].count;
+    if (h->sections[first + 1].count != count || count >= UINT32_MAX) return 0;
+    if (slot_count == 0 ? count != 0 : ((slot_count & (slot_count - 1)) != 0 || count >= slot_count)) return 0;
+    const uint64_t *names = (const uint64_t *)(base + h->sections[first].offset);
+    const uint32_t *slots = (const uint32_t *)(base + h->sections[first + 2].offset);
+    for (size_t i = 0; i < count; ++i) {
+        if (names[i] >= h->strings_size) return 0;
+    }
+    for (size_t i = 0; i < slot_count; ++i) {
+        if (slots[i] > count) return 0;
+    }
+    return 1;
+}
+
+/* The postings sections of role hold sorted CSR lists and delta keys of known people and movies. */
+static int postings_sections_valid(const SnapshotHeader *h, PersonRole role, const unsigned char *base) {
+    size_t first = SECTION_ROLE_FIRST(role);
+    uint64_t people = h->sections[SECTION_PERSON_NAMES].count;
+    uint64_t offset_count = h->sections[first].count;
+    uint64_t posting_count = h->sections[first + 1].count;
+    const uint64_t *offsets = (const uint64_t *)(base + h->sections[first].offset);
+    const uint32_t *postings = (const uint32_t *)(base + h->sections[first + 1].offset);
+    const uint64_t *delta = (const uint64_t *)(base + h->sections[first + 2].offset);
+    if (offset_count == 0 ? posting_count != 0 : offset_count - 1 > people) return 0;
+    if (offset_count > 0 && (offsets[0] != 0 || offsets[offset_count - 1] != posting_count)) return 0;
+    for (size_t i = 1; i < offset_count; ++i) {
+        if (offsets[i] < offsets[i - 1]) return 0;
+    }
+    for (size_t i = 0; i < posting_count; ++i) {
+        if (postings[i] >= h->movie_count) return 0;
+    }
+    for (size_t i = 0; i < h->sections[first + 2].count; ++i) {
+        if ((delta[i] >> 32) >= people || (uint32_t)delta[i] >= h->movie_count) return 0;
+        if (i > 0 && delta[i] <= delta[i - 1]) return 0;
+    }
+    return 1;
+}
+
+/* Every set lists in-range containers by ascending key, holding movies below movie_count. */
+static int sets_sections_valid(const SnapshotHeader *h, const unsigned char *base) {
+    const SnapshotSet *sets = (const SnapshotSet *)(base + h->sections[SECTION_SETS].offset);
+    const SnapshotContainer *containers = (const SnapshotContainer *)(base + h->sections[SECTION_CONTAINERS].offset);
+    const uint16_t *values = (const uint16_t *)(base + h->sections[SECTION_SET_VALUES].offset);
+    const uint64_t *words = (const uint64_t *)(base + h->sections[SECTION_SET_WORDS].offset);
+    uint64_t container_count = h->sections[SECTION_CONTAINERS].count;
+    uint64_t value_count = h->sections[SECTION_SET_VALUES].count;
+    uint64_t word_count = h->sections[SECTION_SET_WORDS].count;
+    if (h->year_span > h->sections[SECTION_SETS].count || h->year_first < INT32_MIN || h->year_first > INT32_MAX) return 0;
+    for (size_t i = 0; i < h->sections[SECTION_SETS].count; ++i) {
+        if (sets[i].first > container_count || sets[i].count > container_count - sets[i].first) return 0;
+        for (size_t c = sets[i].first; c < sets[i].first + sets[i].count; ++c) {
+            const SnapshotContainer *container = &containers[c];
+            uint64_t low = (uint64_t)container->key << 16;
+            if (c > sets[i].first && container->key <= containers[c - 1].key) return 0;
+            if (container->cardinality == 0 || low >= h->movie_count) return 0;
+            if (container->kind == RESULT_CONTAINER_BITMAP) {
+                if (container->data > word_count || word_count - container->data < RESULT_BITMAP_WORDS) return 0;
+                /* No bit past the last movie. */
+                for (uint64_t bit = h->movie_count - low; bit < 65536; ++bit) {
+                    if (words[container->data + bit / 64] >> (bit % 64) & 1u) return 0;
+                }
+            } else if (container->kind == RESULT_CONTAINER_ARRAY) {
+                if (container->cardinality > RESULT_ARRAY_MAX || container->data > value_count ||
+                    value_count - container->data < container->cardinality) {
+                    return 0;
+                }
+                const uint16_t *run = values + container->data;
+                for (size_t v = 1; v < container->cardinality; ++v) {
+                    if (run[v] <= run[v - 1]) return 0;
+                }
+                if (low + run[container->cardinality - 1] >= h->movie_count) return 0;
+            } else {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* An order section lists movies by nondecreasing value, as movie_columns_lower_bound expects. */
+static int order_section_valid(const SnapshotHeader *h, size_t section, size_t value_section,
+                               const unsigned char *base) {
+    const uint32_t *order = (const uint32_t *)(base + h->sections[section].offset);
+    const int32_t *values = (const int32_t *)(base + h->sections[value_section].offset);
+    if (h->sections[section].count > h->movie_count) return 0;
+    for (size_t i = 0; i < h->sections[section].count; ++i) {
+        if (order[i] >= h->movie_count) return 0;
+        if (i > 0 && values[order[i]] < values[order[i - 1]]) return 0;
+    }
+    return 1;
+}
+
+/* Point an order at its base section and the delta section after it. */
+static void load_order(MovieOrder *order, const SnapshotHeader *h, size_t section, const unsigned char *base) {
+    order->base_count = (size_t)h->sections[section].count;
+    order->base = order->base_count > 0 ? (uint32_t *)(base + h->sections[section].offset) : NULL;
+    order->delta_count = (size_t)h->sections[section + 1].count;
+    order->delta = order->delta_count > 0 ? (uint32_t *)(base + h->sections[section + 1].offset) : NULL;
+}
+
+/* Copy sets [first, first + count) out of their sections. */
+static ResultSet *load_sets(const SnapshotHeader *h, size_t first, size_t count, const unsigned char *base) {
+    if (count == 0) return NULL;
+    const SnapshotSet *sets = (const SnapshotSet *)(base + h->sections[SECTION_SETS].offset);
+    const SnapshotContainer *containers = (const SnapshotContainer *)(base + h->sections[SECTION_CONTAINERS].offset);
+    const uint16_t *values = (const uint16_t *)(base + h->sections[SECTION_SET_VALUES].offset);
+    const uint64_t *words = (const uint64_t *)(base + h->sections[SECTION_SET_WORDS].offset);
+    ResultSet *out = (ResultSet *)checked_malloc(count * sizeof(ResultSet));
+    for (size_t i = 0; i < count; ++i) {
+        const SnapshotSet *set = &sets[first + i];
+        result_set_init(&out[i]);
+        for (size_t c = set->first; c < set->first + set->count; ++c) {
+            const SnapshotContainer *container = &containers[c];
+            const void *data = container->kind == RESULT_CONTAINER_BITMAP
+                ? (const void *)(words + container->data)
+                : (const void *)(values + container->data);
+            result_set_append_container(&out[i], container->key, container->kind, container->cardinality, data);
+        }
+    }
+    return out;
+}
+
+/* Copy a dictionary out of its sections; the names stay in the string blob. */
+static void load_dictionary(StringDictionary *dict, const SnapshotHeader *h, size_t first, const unsigned char *base,
+                            const char *strings) {
+    size_t count = (size_t)h->sections[first].count;
+    size_t slot_count = (size_t)h->sections[first + 2].count;
+    const uint64_t *names = (const uint64_t *)(base + h->sections[first].offset);
+    string_dictionary_free(dict);
+    if (count > 0) {
+        dict->names = (const char **)checked_malloc(count * sizeof(char *));
+        dict->hashes = (size_t *)checked_malloc(count * sizeof(size_t));
+        for (size_t i = 0; i < count; ++i) dict->names[i] = strings + names[i];
+        memcpy(dict->hashes, base + h->sections[first + 1].offset, count * sizeof(size_t));
+    }
+    if (slot_count > 0) {
+        dict->slots = (uint32_t *)checked_malloc(slot_count * sizeof(uint32_t));
+        memcpy(dict->slots, base + h->sections[first + 2].offset, slot_count * sizeof(uint32_t));
+    }
+    dict->count = count;
+    dict->capacity = count;
+    dict->slot_count = slot_count;
+}
+
+int snapshot_load(const char *path, const char *source_path, MovieDatabase *db, TitleIndex *index,
+                  char **error_message) {
+    if (error_message) *error_message = NULL;
+    if (!path || !db || !index) return 0;
+    if (db->count != 0 || db->mapped_data) {
+        set_error(error_message, "Snapshot can only be loaded into an empty movie database", NULL);
+        return 0;
+    }
+    if (sizeof(size_t) != sizeof(uint64_t) || sizeof(int) != sizeof(int32_t)) {
+        set_error(error_message, "Snapshots require a 64-bit build", NULL);
+        return 0;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        set_error(error_message, "Snapshot not found", path);
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        set_error(error_message, "Snapshot is truncated", path);
+        return 0;
+    }
+    size_t file_size = (size_t)st.st_size;
+    void *mapping = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        set_error(error_message, "Failed to map snapshot", path);
+        return 0;
+    }
+    const unsigned char *base = (const unsigned char *)mapping;
+
+    SnapshotHeader header;
+    memcpy(&header, base, sizeof(header));
+    const char *problem = NULL;
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 && header.version != SNAPSHOT_VERSION) {
+        problem = "Snapshot was written by another version";
+    } else if (!snapshot_header_valid(&header, file_size)) {
+        problem = "Snapshot header is invalid";
+    } else {
+        uint64_t source_size = 0;
+        int64_t source_mtime = 0;
+        if (source_stat(source_path, &source_size, &source_mtime) &&
+            (source_size != header.source_size || source_mtime != header.source_mtime)) {
+            problem = "Snapshot is stale";
+        }
+    }
+    if (!problem) {
+        SnapshotChecksum checksum;
+        checksum_init(&checksum);
+        checksum_update(&checksum, base + sizeof(SnapshotHeader), file_size - sizeof(SnapshotHeader));
+        if (checksum_final(&checksum) != header.checksum) problem = "Snapshot checksum mismatch";
+    }
+    if (!problem && header.strings_size > 0 && base[header.strings_offset + header.strings_size - 1] != '\0') {
+        problem = "Snapshot string table is not terminated";
+    }
+    if (problem) {
+        munmap(mapping, file_size);
+        set_error(error_message, problem, path);
+        return 0;
+    }
+
+    const SnapshotMovie *records = (const SnapshotMovie *)(base + header.movies_offset);
+    const uint64_t *genre_offsets = (const uint64_t *)(base + header.genres_offset);
+    const SnapshotKey *keys = (const SnapshotKey *)(base + header.keys_offset);
+    TitleIndexGroup *groups = (TitleIndexGroup *)(base + header.groups_offset);
+    size_t *postings = (size_t *)(base + header.postings_offset);
+    uint32_t *grams = (uint32_t *)(base + header.grams_offset);
+    size_t *gram_offsets = (size_t *)(base + header.gram_offsets_offset);
+    uint32_t *gram_postings = (uint32_t *)(base + header.gram_postings_offset);
+    uint64_t *gram_delta = (uint64_t *)(base + header.gram_delta_offset);
+    char *strings = (char *)(base + header.strings_offset);
+
+    size_t movie_count = (size_t)header.movie_count;
+    if (movie_count > db->capacity) {
+        Movie *grown = (Movie *)realloc(db->movies, movie_count * sizeof(Movie));
+        if (!grown) {
+            munmap(mapping, file_size);
+            set_error(error_message, "Out of memory while loading snapshot", NULL);
+            return 0;
+        }
+        db->movies = grown;
+        db->capacity = movie_count;
+    }
+    char **genres = header.genre_count > 0
+        ? (char **)arena_alloc(&db->arena, (size_t)header.genre_count * sizeof(char *), sizeof(char *))
+        : NULL;
+
+    /* The string blob is read-only; the Movie fields are only ever read through these pointers. */
+    int valid = 1;
+    for (size_t g = 0; g < header.genre_count; ++g) {
+        if (genre_offsets[g] >= header.strings_size) valid = 0;
+        genres[g] = strings + (valid ? genre_offsets[g] : 0);
+    }
+    for (size_t i = 0; i < movie_count && valid; ++i) {
+        const SnapshotMovie *record = &records[i];
+        Movie *movie = &db->movies[i];
+        for (size_t f = 0; f < SNAPSHOT_FIELD_COUNT; ++f) {
+            if (record->fields[f] >= header.strings_size) valid = 0;
+            *movie_field(movie, f) = strings + (valid ? record->fields[f] : 0);
+        }
+        if (record->genre_count > header.genre_count - record->genre_first) valid = 0;
+        movie->genres = (valid && record->genre_count > 0) ? genres + record->genre_first : NULL;
+        movie->genre_count = valid ? (size_t)record->genre_count : 0;
+        movie->release_year_num = (int)record->release_year_num;
+        movie->date_added_days = (int)record->date_added_days;
+    }
+
+    title_index_free(index);
+    if (valid) {
+        index->entries = (TitleIndexEntry *)calloc(header.key_count > 0 ? (size_t)header.key_count : 1, sizeof(TitleIndexEntry));
+        if (!index->entries) valid = 0;
+    }
+    for (size_t i = 0; i < header.key_count && valid; ++i) {
+        const SnapshotKey *key = &keys[i];
+        if (key->count == 0 || key->key >= header.strings_size || key->first > header.posting_count ||
+            key->count > header.posting_count - key->first) {
+            valid = 0;
+            break;
+        }
+        TitleIndexEntry *entry = &index->entries[i];
+        entry->key_lower = strings + key->key;
+        entry->hash = (size_t)key->hash;
+        entry->indices = postings + key->first;
+        entry->count = (size_t)key->count;
+        entry->capacity = entry->count;
+    }
+    for (size_t i = 0; i < header.slot_count && valid; ++i) {
+        const TitleIndexGroup *group = &groups[i / TITLE_GROUP_WIDTH];
+        size_t slot = i % TITLE_GROUP_WIDTH;
+        if (!(group->ctrl[slot] & TITLE_CTRL_EMPTY) && group->ids[slot] >= header.key_count) valid = 0;
+    }
+    if (gram_offsets[0] != 0 || gram_offsets[header.gram_count] != header.gram_posting_count) valid = 0;
+    for (size_t i = 0; i < header.gram_count && valid; ++i) {
+        if (gram_offsets[i] > gram_offsets[i + 1]) valid = 0;
+    }
+    for (size_t i = 0; i < header.gram_posting_count && valid; ++i) {
+        if (gram_postings[i] >= header.key_count) valid = 0;
+    }
+    for (size_t i = 0; i < header.gram_delta_count && valid; ++i) {
+        if ((uint32_t)gram_delta[i] >= header.key_count) valid = 0;
+    }
+    for (size_t s = SECTION_YEARS; s <= SECTION_TYPE_CODES; ++s) {
+        if (header.sections[s].count != header.movie_count) valid = 0;
+    }
+    if (valid && (!dictionary_sections_valid(&header, SECTION_DIRECTOR_NAMES, base) ||
+                  !dictionary_sections_valid(&header, SECTION_GENRE_NAMES, base) ||
+                  !dictionary_sections_valid(&header, SECTION_PERSON_NAMES, base) ||
+                  !postings_sections_valid(&header, PERSON_ROLE_DIRECTOR, base) ||
+                  !postings_sections_valid(&header, PERSON_ROLE_CAST, base) ||
+                  !sets_sections_valid(&header, base) ||
+                  !order_section_valid(&header, SECTION_YEAR_ORDER, SECTION_YEARS, base) ||
+                  !order_section_valid(&header, SECTION_YEAR_DELTA, SECTION_YEARS, base) ||
+                  !order_section_valid(&header, SECTION_ADDED_ORDER, SECTION_ADDED, base) ||
+                  !order_section_valid(&header, SECTION_ADDED_DELTA, SECTION_ADDED, base))) {
+        valid = 0;
+    }
+    uint32_t *director_ids = (uint32_t *)(base + header.sections[SECTION_DIRECTOR_IDS].offset);
+    for (size_t i = 0; i < movie_count && valid; ++i) {
+        if (director_ids[i] >= header.sections[SECTION_DIRECTOR_NAMES].count && director_ids[i] != COLUMNS_NO_DIRECTOR) {
+            valid = 0;
+        }
+    }
+    if (!valid) {
+        free(index->entries);
+        title_index_init(index);
+        munmap(mapping, file_size);
+        set_error(error_message, "Snapshot references data outside the file", path);
+        return 0;
+    }
+    index->groups = header.slot_count > 0 ? groups : NULL;
+    index->capacity = (size_t)header.slot_count;
+    index->size = (size_t)header.key_count;
+    index->entry_capacity = (size_t)header.key_count;
+    index->borrowed = 1;
+    index->trigrams.grams = grams;
+    index->trigrams.offsets = gram_offsets;
+    index->trigrams.postings = gram_postings;
+    index->trigrams.gram_count = (size_t)header.gram_count;
+    index->trigrams.posting_count = (size_t)header.gram_posting_count;
+    index->trigrams.delta = gram_delta;
+    index->trigrams.delta_count = (size_t)header.gram_delta_count;
+    index->trigrams.built = 1;
+    index->trigrams.borrowed = 1;
+    /* The packed key text is cheap to rebuild and not worth a section of its own. */
+    for (size_t i = 0; i < index->size; ++i) {
+        text_blob_add(&index->key_text, index->entries[i].key_lower);
+    }
+
+    /* The per-row columns and the orders stay in the mapping until an append copies them. */
+    MovieColumns *columns = &db->columns;
+    columns->release_year = (int *)(base + header.sections[SECTION_YEARS].offset);
+    columns->date_added = (int *)(base + header.sections[SECTION_ADDED].offset);
+    columns->director_id = director_ids;
+    columns->genre_set = (GenreSet *)(base + header.sections[SECTION_GENRE_SETS].offset);
+    columns->type_code = (unsigned char *)(base + header.sections[SECTION_TYPE_CODES].offset);
+    load_order(&columns->year_order, &header, SECTION_YEAR_ORDER, base);
+    load_order(&columns->added_order, &header, SECTION_ADDED_ORDER, base);
+    columns->count = movie_count;
+    columns->capacity = movie_count;
+    columns->borrowed = 1;
+    columns->genre_overflow = header.genre_overflow != 0;
+    load_dictionary(&columns->directors, &header, SECTION_DIRECTOR_NAMES, base, strings);
+    load_dictionary(&columns->genres, &header, SECTION_GENRE_NAMES, base, strings);
+    for (size_t i = 0; i < movie_count; ++i) db->movies[i].genre_set = columns->genre_set[i];
+    columns->year_first = (int)header.year_first;
+    columns->year_span = (size_t)header.year_span;
+    columns->year_movies = load_sets(&header, 0, columns->year_span, base);
+    columns->genre_movies_count = (size_t)(header.sections[SECTION_SETS].count - header.year_span);
+    columns->genre_movies = load_sets(&header, columns->year_span, columns->genre_movies_count, base);
+
+    /* The person names stay in the blob, the posting lists in the mapping. */
+    PersonIndex *people = &db->people;
+    load_dictionary(&people->names, &header, SECTION_PERSON_NAMES, base, strings);
+    for (size_t r = 0; r < PERSON_ROLE_COUNT; ++r) {
+        const SnapshotSection *sections = &header.sections[SECTION_ROLE_FIRST(r)];
+        PersonPostings *role = &people->roles[r];
+        role->offsets = sections[0].count > 0 ? (size_t *)(base + sections[0].offset) : NULL;
+        role->postings = sections[0].count > 0 ? (uint32_t *)(base + sections[1].offset) : NULL;
+        role->base_people = sections[0].count > 0 ? (size_t)sections[0].count - 1 : 0;
+        role->delta = sections[2].count > 0 ? (uint64_t *)(base + sections[2].offset) : NULL;
+        role->delta_count = (size_t)sections[2].count;
+        role->borrowed = 1;
+    }
+    /* Like the title key text, the packed name text is cheap to rebuild. */
+    for (size_t id = 0; id < people->names.count; ++id) {
+        text_blob_add(&people->name_text, people->names.names[id]);
+    }
+
+    db->count = movie_count;
+    db->mapped_data = (char *)mapping;
+    db->mapped_length = file_size;
+    movie_db_new_generation(db);
+    return 1;
+}
+
+#else
+
+int snapshot_load(const char *path, const char *source_path, MovieDatabase *db, TitleIndex *index,
+                  char **error_message) {
+    (void)path;
+    (void)source_path;
+    (void)db;
+    (void)index;
+    set_error(error_message, "Snapshots are not supported on this platform", NULL);
+    return 0;
+}
+
+#endif /* SNAPSHOT_HAVE_MMAP */
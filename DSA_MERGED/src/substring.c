@@ -0,0 +1,269 @@
+#include "substring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* SSE2 is part of x86-64; AVX2 is compiled per function and only run when CPUID reports it. */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SUBSTRING_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(SUBSTRING_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SUBSTRING_AVX2 1
+#include <immintrin.h>
+#endif
+
+static void *checked_realloc(void *ptr, size_t size) {
+    void *grown = realloc(ptr, size);
+    if (!grown) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+static unsigned lowest_bit(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned i = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+/* memchr for the first byte, then memcmp; needle_len >= 1. */
+static const char *find_scalar(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) {
+    if (needle_len > haystack_len) return NULL;
+    const char *last = haystack + (haystack_len - needle_len);
+    const char *p = haystack;
+    while (p <= last) {
+        p = (const char *)memchr(p, needle[0], (size_t)(last - p) + 1);
+        if (!p) return NULL;
+        if (memcmp(p + 1, needle + 1, needle_len - 1) == 0) return p;
+        p++;
+    }
+    return NULL;
+}
+
+#ifdef SUBSTRING_SSE2
+static const char *find_sse2(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) {
+    if (needle_len > haystack_len) return NULL;
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+    size_t i = 0;
+    /* Position i + 15 still needs its last byte at i + 15 + needle_len - 1 inside the haystack. */
+    for (; i + needle_len + 15 <= haystack_len; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(haystack + i + needle_len - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            size_t at = i + lowest_bit(mask);
+            if (memcmp(haystack + at + 1, needle + 1, needle_len - 2) == 0) return haystack + at;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(haystack + i, haystack_len - i, needle, needle_len);
+}
+#endif
+
+#ifdef SUBSTRING_AVX2
+__attribute__((target("avx2")))
+static const char *find_avx2(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) {
+    if (needle_len > haystack_len) return NULL;
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+    size_t i = 0;
+    for (; i + needle_len + 31 <= haystack_len; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(haystack + i + needle_len - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            size_t at = i + lowest_bit(mask);
+            if (memcmp(haystack + at + 1, needle + 1, needle_len - 2) == 0) return haystack + at;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(haystack + i, haystack_len - i, needle, needle_len);
+}
+#endif
+
+/* The kernels take needle_len >= 2: both the first and last byte are filtered, memcmp checks the rest. */
+typedef const char *(*SubstringFn)(const char *, size_t, const char *, size_t);
+
+static SubstringKernel active_kernel = SUBSTRING_KERNEL_AUTO;
+static SubstringFn active_fn = NULL;
+
+static int kernel_supported(SubstringKernel kernel) {
+    switch (kernel) {
+    case SUBSTRING_KERNEL_SCALAR:
+        return 1;
+    case SUBSTRING_KERNEL_SSE2:
+#ifdef SUBSTRING_SSE2
+        return 1;
+#else
+        return 0;
+#endif
+    case SUBSTRING_KERNEL_AVX2:
+#ifdef SUBSTRING_AVX2
+        return __builtin_cpu_supports("avx2") != 0;
+#else
+        return 0;
+#endif
+    case SUBSTRING_KERNEL_AUTO:
+        break;
+    }
+    return 0;
+}
+
+static SubstringFn kernel_function(SubstringKernel kernel) {
+    switch (kernel) {
+#ifdef SUBSTRING_AVX2
+    case SUBSTRING_KERNEL_AVX2:
+        return find_avx2;
+#endif
+#ifdef SUBSTRING_SSE2
+    case SUBSTRING_KERNEL_SSE2:
+        return find_sse2;
+#endif
+    default:
+        return find_scalar;
+    }
+}
+
+int substring_set_kernel(SubstringKernel kernel) {
+    if (kernel == SUBSTRING_KERNEL_AUTO) {
+        kernel = SUBSTRING_KERNEL_SCALAR;
+        if (kernel_supported(SUBSTRING_KERNEL_SSE2)) kernel = SUBSTRING_KERNEL_SSE2;
+        if (kernel_supported(SUBSTRING_KERNEL_AVX2)) kernel = SUBSTRING_KERNEL_AVX2;
+    } else if (!kernel_supported(kernel)) {
+        return 0;
+    }
+    active_fn = kernel_function(kernel);
+    active_kernel = kernel;
+    return 1;
+}
+
+SubstringKernel substring_active_kernel(void) {
+    if (!active_fn) substring_set_kernel(SUBSTRING_KERNEL_AUTO);
+    return active_kernel;
+}
+
+const char *substring_kernel_name(SubstringKernel kernel) {
+    switch (kernel) {
+    case SUBSTRING_KERNEL_SCALAR:
+        return "scalar";
+    case SUBSTRING_KERNEL_SSE2:
+        return "sse2";
+    case SUBSTRING_KERNEL_AVX2:
+        return "avx2";
+    case SUBSTRING_KERNEL_AUTO:
+        break;
+    }
+    return "auto";
+}
+
+const char *substring_find(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len) {
+    if (!haystack || !needle) return NULL;
+    if (needle_len == 0) return haystack;
+    if (needle_len == 1) return (const char *)memchr(haystack, needle[0], haystack_len);
+    /* The dispatch is idempotent, so threads racing here store the same pointer. */
+    if (!active_fn) substring_set_kernel(SUBSTRING_KERNEL_AUTO);
+    return active_fn(haystack, haystack_len, needle, needle_len);
+}
+
+/* ---- text blobs ---- */
+
+void text_blob_init(TextBlob *blob) {
+    if (!blob) return;
+    blob->text = NULL;
+    blob->length = 0;
+    blob->capacity = 0;
+    blob->starts = NULL;
+    blob->count = 0;
+    blob->starts_capacity = 0;
+}
+
+void text_blob_free(TextBlob *blob) {
+    if (!blob) return;
+    free(blob->text);
+    free(blob->starts);
+    text_blob_init(blob);
+}
+
+void text_blob_add(TextBlob *blob, const char *text) {
+    if (!blob) return;
+    if (!text) text = "";
+    size_t len = strlen(text);
+    if (blob->length + len + 1 > blob->capacity) {
+        size_t capacity = blob->capacity == 0 ? 4096 : blob->capacity;
+        while (capacity < blob->length + len + 1) capacity *= 2;
+        blob->text = (char *)checked_realloc(blob->text, capacity);
+        blob->capacity = capacity;
+    }
+    if (blob->count + 2 > blob->starts_capacity) {
+        blob->starts_capacity = blob->starts_capacity == 0 ? 256 : blob->starts_capacity * 2;
+        blob->starts = (size_t *)checked_realloc(blob->starts, blob->starts_capacity * sizeof(size_t));
+    }
+    blob->starts[blob->count] = blob->length;
+    memcpy(blob->text + blob->length, text, len + 1);
+    blob->length += len + 1;
+    blob->count++;
+    blob->starts[blob->count] = blob->length;
+}
+
+/* Id of the string holding offset, searching forward from id `from`. */
+static size_t text_blob_id_at(const TextBlob *blob, size_t from, size_t offset) {
+    size_t lo = from;
+    size_t hi = blob->count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (blob->starts[mid] <= offset) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int text_blob_search(const TextBlob *blob, const char *needle, uint32_t **out_ids, size_t *out_count) {
+    if (out_ids) *out_ids = NULL;
+    if (out_count) *out_count = 0;
+    if (!blob || !needle || !out_ids || !out_count || blob->count == 0) return 0;
+
+    size_t needle_len = strlen(needle);
+    uint32_t *ids = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t pos = 0;
+    size_t id = 0;
+    /* A needle has no NUL, so a match never spans two strings; after one, skip to the next string. */
+    while (pos < blob->length) {
+        const char *hit = substring_find(blob->text + pos, blob->length - pos, needle, needle_len);
+        if (!hit) break;
+        id = text_blob_id_at(blob, id, (size_t)(hit - blob->text));
+        if (count == capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            ids = (uint32_t *)checked_realloc(ids, capacity * sizeof(uint32_t));
+        }
+        ids[count++] = (uint32_t)id;
+        pos = blob->starts[id + 1];
+    }
+    if (count == 0) return 0;
+    *out_ids = ids;
+    *out_count = count;
+    return 1;
+}
+
+size_t text_blob_next(const TextBlob *blob, const char *needle, size_t needle_len, size_t from) {
+    if (!blob) return 0;
+    if (!needle || from >= blob->count) return blob->count;
+    size_t pos = blob->starts[from];
+    const char *hit = substring_find(blob->text + pos, blob->length - pos, needle, needle_len);
+    if (!hit) return blob->count;
+    return text_blob_id_at(blob, from, (size_t)(hit - blob->text));
+}
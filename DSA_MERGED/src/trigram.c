@@ -0,0 +1,376 @@
+#include "trigram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Error: Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+void trigram_index_init(TrigramIndex *index) {
+    if (!index) return;
+    index->grams = NULL;
+    index->offsets = NULL;
+    index->postings = NULL;
+    index->gram_count = 0;
+    index->posting_count = 0;
+    index->delta = NULL;
+    index->delta_count = 0;
+    index->pending = NULL;
+    index->pending_count = 0;
+    index->pending_capacity = 0;
+    index->built = 0;
+    index->borrowed = 0;
+}
+
+void trigram_index_free(TrigramIndex *index) {
+    if (!index) return;
+    if (!index->borrowed) {
+        free(index->grams);
+        free(index->offsets);
+        free(index->postings);
+        free(index->delta);
+    }
+    free(index->pending);
+    trigram_index_init(index);
+}
+
+static uint32_t trigram_code(const unsigned char *p) {
+    return (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | (uint32_t)p[2];
+}
+
+static void *copy_array(const void *data, size_t bytes) {
+    void *copy = checked_malloc(bytes > 0 ? bytes : 1);
+    if (bytes > 0) memcpy(copy, data, bytes);
+    return copy;
+}
+
+/* Copy the arrays a snapshot lent the index, so the delta can be rewritten. */
+static void trigram_index_take_ownership(TrigramIndex *index) {
+    index->grams = (uint32_t *)copy_array(index->grams, index->gram_count * sizeof(uint32_t));
+    index->offsets = (size_t *)copy_array(index->offsets, (index->gram_count + 1) * sizeof(size_t));
+    index->postings = (uint32_t *)copy_array(index->postings, index->posting_count * sizeof(uint32_t));
+    index->delta = (uint64_t *)copy_array(index->delta, index->delta_count * sizeof(uint64_t));
+    index->borrowed = 0;
+}
+
+void trigram_index_add(TrigramIndex *index, uint32_t key_id, const char *key) {
+    if (!index || !key) return;
+    size_t len = strlen(key);
+    if (len < TRIGRAM_MIN_NEEDLE) return;
+    size_t grams = len - TRIGRAM_MIN_NEEDLE + 1;
+    if (index->pending_count + grams > index->pending_capacity) {
+        size_t new_capacity = index->pending_capacity == 0 ? 1024 : index->pending_capacity * 2;
+        while (new_capacity < index->pending_count + grams) new_capacity *= 2;
+        uint64_t *grown = (uint64_t *)realloc(index->pending, new_capacity * sizeof(uint64_t));
+        if (!grown) {
+            fprintf(stderr, "Error: Out of memory while building trigram index\n");
+            exit(EXIT_FAILURE);
+        }
+        index->pending = grown;
+        index->pending_capacity = new_capacity;
+    }
+    /* A trigram repeated within the key is recorded twice; the build drops the copy. */
+    const unsigned char *p = (const unsigned char *)key;
+    for (size_t i = 0; i < grams; ++i) {
+        index->pending[index->pending_count++] = (uint64_t)trigram_code(p + i) << 32 | key_id;
+    }
+}
+
+/* Open-addressing map from trigram code to a dense id, used while building the CSR part. */
+typedef struct {
+    uint32_t *codes; /* TRIGRAM_NO_CODE when free */
+    uint32_t *ids;
+    size_t capacity;
+    size_t count;
+} TrigramCodeMap;
+
+#define TRIGRAM_NO_CODE UINT32_MAX
+
+static void code_map_init(TrigramCodeMap *map, size_t capacity) {
+    map->codes = (uint32_t *)checked_malloc(capacity * sizeof(uint32_t));
+    map->ids = (uint32_t *)checked_malloc(capacity * sizeof(uint32_t));
+    memset(map->codes, 0xff, capacity * sizeof(uint32_t));
+    map->capacity = capacity;
+    map->count = 0;
+}
+
+static void code_map_free(TrigramCodeMap *map) {
+    free(map->codes);
+    free(map->ids);
+}
+
+static size_t code_map_slot(const TrigramCodeMap *map, uint32_t code) {
+    /* Fibonacci hashing: take the top bits, the low ones barely depend on the first byte. */
+    size_t slot = (size_t)(((uint64_t)code * 0x9e3779b97f4a7c15ull) >> 40) & (map->capacity - 1);
+    while (map->codes[slot] != TRIGRAM_NO_CODE && map->codes[slot] != code) {
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+    return slot;
+}
+
+/* Dense id of code, numbering new codes in order of appearance. */
+static uint32_t code_map_intern(TrigramCodeMap *map, uint32_t code) {
+    size_t slot = code_map_slot(map, code);
+    if (map->codes[slot] != TRIGRAM_NO_CODE) return map->ids[slot];
+    if ((map->count + 1) * 2 > map->capacity) {
+        TrigramCodeMap grown;
+        code_map_init(&grown, map->capacity * 2);
+        for (size_t i = 0; i < map->capacity; ++i) {
+            if (map->codes[i] == TRIGRAM_NO_CODE) continue;
+            size_t to = code_map_slot(&grown, map->codes[i]);
+            grown.codes[to] = map->codes[i];
+            grown.ids[to] = map->ids[i];
+        }
+        grown.count = map->count;
+        code_map_free(map);
+        *map = grown;
+        slot = code_map_slot(map, code);
+    }
+    map->codes[slot] = code;
+    map->ids[slot] = (uint32_t)map->count;
+    return (uint32_t)map->count++;
+}
+
+static int compare_gram(const void *lhs, const void *rhs) {
+    uint32_t a = *(const uint32_t *)lhs;
+    uint32_t b = *(const uint32_t *)rhs;
+    return (a > b) - (a < b);
+}
+
+/*
+ * Counting sort of the pending pairs into the CSR arrays. Catalogs only use a
+ * few thousand distinct trigrams, so codes are first mapped to dense ids in a
+ * small table; pairs arrive in key id order, so each list comes out ascending.
+ */
+static void trigram_build_base(TrigramIndex *index) {
+    uint64_t *pairs = index->pending;
+    size_t count = index->pending_count;
+    TrigramCodeMap map;
+    code_map_init(&map, 4096);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t dense = code_map_intern(&map, (uint32_t)(pairs[i] >> 32));
+        pairs[i] = (uint64_t)dense << 32 | (uint32_t)pairs[i];
+    }
+
+    /* The CSR part lists codes ascending; rank[dense id] is a code's position there. */
+    size_t grams = map.count;
+    uint32_t *codes = (uint32_t *)checked_malloc((grams > 0 ? grams : 1) * sizeof(uint32_t));
+    uint32_t *rank = (uint32_t *)checked_malloc((grams > 0 ? grams : 1) * sizeof(uint32_t));
+    size_t filled = 0;
+    for (size_t i = 0; i < map.capacity; ++i) {
+        if (map.codes[i] != TRIGRAM_NO_CODE) codes[filled++] = map.codes[i];
+    }
+    qsort(codes, grams, sizeof(uint32_t), compare_gram);
+    for (size_t r = 0; r < grams; ++r) {
+        rank[map.ids[code_map_slot(&map, codes[r])]] = (uint32_t)r;
+    }
+    code_map_free(&map);
+
+    size_t *offsets = (size_t *)calloc(grams + 1, sizeof(size_t));
+    if (!offsets) {
+        fprintf(stderr, "Error: Out of memory while building trigram index\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        offsets[rank[pairs[i] >> 32] + 1]++;
+    }
+    for (size_t r = 0; r < grams; ++r) {
+        offsets[r + 1] += offsets[r];
+    }
+    uint32_t *postings = (uint32_t *)checked_malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+    size_t *cursor = (size_t *)checked_malloc((grams > 0 ? grams : 1) * sizeof(size_t));
+    if (grams > 0) memcpy(cursor, offsets, grams * sizeof(size_t));
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t r = rank[pairs[i] >> 32];
+        uint32_t id = (uint32_t)pairs[i];
+        /* A trigram repeated within one key lands twice in a row in its list. */
+        if (cursor[r] > offsets[r] && postings[cursor[r] - 1] == id) continue;
+        postings[cursor[r]++] = id;
+    }
+    free(rank);
+
+    /* Close the gaps the dropped repeats left. */
+    size_t out = 0;
+    for (size_t r = 0; r < grams; ++r) {
+        size_t first = offsets[r];
+        offsets[r] = out;
+        memmove(postings + out, postings + first, (cursor[r] - first) * sizeof(uint32_t));
+        out += cursor[r] - first;
+    }
+    offsets[grams] = out;
+    free(cursor);
+
+    index->grams = codes;
+    index->offsets = offsets;
+    index->postings = postings;
+    index->gram_count = grams;
+    index->posting_count = out;
+}
+
+static int compare_key(const void *lhs, const void *rhs) {
+    uint64_t a = *(const uint64_t *)lhs;
+    uint64_t b = *(const uint64_t *)rhs;
+    return (a > b) - (a < b);
+}
+
+/* Sort the pending pairs and merge them into the delta, dropping duplicates. */
+static void trigram_merge_delta(TrigramIndex *index) {
+    qsort(index->pending, index->pending_count, sizeof(uint64_t), compare_key);
+    uint64_t *merged = (uint64_t *)checked_malloc((index->delta_count + index->pending_count) * sizeof(uint64_t));
+    size_t i = 0;
+    size_t j = 0;
+    size_t out = 0;
+    while (i < index->delta_count || j < index->pending_count) {
+        uint64_t key;
+        if (j == index->pending_count || (i < index->delta_count && index->delta[i] <= index->pending[j])) {
+            key = index->delta[i++];
+        } else {
+            key = index->pending[j++];
+        }
+        if (out == 0 || merged[out - 1] != key) merged[out++] = key;
+    }
+    free(index->delta);
+    index->delta = merged;
+    index->delta_count = out;
+}
+
+void trigram_index_finish(TrigramIndex *index) {
+    if (!index) return;
+    if (index->borrowed && index->pending_count > 0) trigram_index_take_ownership(index);
+    if (!index->built) {
+        trigram_build_base(index);
+        index->built = 1;
+    } else if (index->pending_count > 0) {
+        trigram_merge_delta(index);
+    }
+    free(index->pending);
+    index->pending = NULL;
+    index->pending_count = 0;
+    index->pending_capacity = 0;
+}
+
+/* The key ids of one trigram: its CSR slice, then its delta pairs (all newer keys). */
+typedef struct {
+    const uint32_t *base;
+    size_t base_count;
+    const uint64_t *delta;
+    size_t count; /* base_count + delta pairs */
+} TrigramList;
+
+static uint32_t trigram_list_at(const TrigramList *list, size_t i) {
+    return i < list->base_count ? list->base[i] : (uint32_t)list->delta[i - list->base_count];
+}
+
+static void trigram_index_list(const TrigramIndex *index, uint32_t gram, TrigramList *list) {
+    list->base = NULL;
+    list->base_count = 0;
+    size_t lo = 0;
+    size_t hi = index->gram_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->grams[mid] < gram) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < index->gram_count && index->grams[lo] == gram) {
+        list->base = index->postings + index->offsets[lo];
+        list->base_count = index->offsets[lo + 1] - index->offsets[lo];
+    }
+
+    lo = 0;
+    hi = index->delta_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((index->delta[mid] >> 32) < gram) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t end = lo;
+    while (end < index->delta_count && (index->delta[end] >> 32) == gram) end++;
+    list->delta = index->delta + lo;
+    list->count = list->base_count + (end - lo);
+}
+
+/* First position at or after from whose id is >= id, galloping ahead before bisecting. */
+static size_t trigram_list_seek(const TrigramList *list, size_t from, uint32_t id) {
+    size_t step = 1;
+    size_t lo = from;
+    size_t hi = from;
+    while (hi < list->count && trigram_list_at(list, hi) < id) {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    if (hi > list->count) hi = list->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (trigram_list_at(list, mid) < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int compare_list_size(const void *lhs, const void *rhs) {
+    size_t a = ((const TrigramList *)lhs)->count;
+    size_t b = ((const TrigramList *)rhs)->count;
+    return (a > b) - (a < b);
+}
+
+int trigram_index_candidates(const TrigramIndex *index, const char *needle, uint32_t **out_ids, size_t *out_count) {
+    if (out_ids) *out_ids = NULL;
+    if (out_count) *out_count = 0;
+    if (!index || !needle || !out_ids || !out_count) return 0;
+    size_t len = strlen(needle);
+    if (len < TRIGRAM_MIN_NEEDLE) return 0;
+
+    size_t gram_count = len - TRIGRAM_MIN_NEEDLE + 1;
+    uint32_t *grams = (uint32_t *)checked_malloc(gram_count * sizeof(uint32_t));
+    for (size_t i = 0; i < gram_count; ++i) {
+        grams[i] = trigram_code((const unsigned char *)needle + i);
+    }
+    qsort(grams, gram_count, sizeof(uint32_t), compare_gram);
+    size_t distinct = 0;
+    for (size_t i = 0; i < gram_count; ++i) {
+        if (distinct == 0 || grams[distinct - 1] != grams[i]) grams[distinct++] = grams[i];
+    }
+
+    TrigramList *lists = (TrigramList *)checked_malloc(distinct * sizeof(TrigramList));
+    for (size_t i = 0; i < distinct; ++i) {
+        trigram_index_list(index, grams[i], &lists[i]);
+        if (lists[i].count == 0) {
+            free(lists);
+            free(grams);
+            return 1;
+        }
+    }
+    free(grams);
+
+    /* Start from the rarest trigram and filter it through the others, rarest first. */
+    qsort(lists, distinct, sizeof(TrigramList), compare_list_size);
+    size_t count = lists[0].count;
+    uint32_t *ids = (uint32_t *)checked_malloc(count * sizeof(uint32_t));
+    for (size_t i = 0; i < count; ++i) ids[i] = trigram_list_at(&lists[0], i);
+    for (size_t l = 1; l < distinct && count > 0; ++l) {
+        size_t kept = 0;
+        size_t pos = 0;
+        for (size_t i = 0; i < count && pos < lists[l].count; ++i) {
+            pos = trigram_list_seek(&lists[l], pos, ids[i]);
+            if (pos < lists[l].count && trigram_list_at(&lists[l], pos) == ids[i]) ids[kept++] = ids[i];
+        }
+        count = kept;
+    }
+    free(lists);
+
+    if (count == 0) {
+        free(ids);
+        ids = NULL;
+    }
+    *out_ids = ids;
+    *out_count = count;
+    return 1;
+}
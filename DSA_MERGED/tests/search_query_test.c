@@ -0,0 +1,83 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "movie.h"
+#include "resultset.h"
+#include "search.h"
+
+/*
+ * Checks that combined searches answer year ranges reaching past the
+ * catalog's years (up to INT_MAX) like the same range cut to those years,
+ * and promptly: the run is aborted by SIGALRM after TEST_TIMEOUT_SECONDS.
+ */
+
+#define TEST_TIMEOUT_SECONDS 10
+
+static int failures;
+
+static void run_query(const MovieDatabase *db, const char *genre, int from, int to, size_t **indices, size_t *count) {
+    SearchQuery query;
+    search_query_init(&query);
+    query.genre_substr_lower = genre;
+    query.year_from = from;
+    query.year_to = to;
+    ResultSet results;
+    result_set_init(&results);
+    *indices = NULL;
+    *count = 0;
+    if (search_query_run(db, NULL, &query, &results)) result_set_to_indices(&results, indices, count);
+    result_set_free(&results);
+}
+
+/* The query over [from, to] must give the same movies as over [expect_from, expect_to]. */
+static void expect_same(const MovieDatabase *db, const char *name, const char *genre, int from, int to,
+                        int expect_from, int expect_to) {
+    size_t *got = NULL;
+    size_t got_count = 0;
+    size_t *expected = NULL;
+    size_t expected_count = 0;
+    run_query(db, genre, from, to, &got, &got_count);
+    if (expect_from <= expect_to) run_query(db, genre, expect_from, expect_to, &expected, &expected_count);
+    int same = got_count == expected_count &&
+               (got_count == 0 || memcmp(got, expected, got_count * sizeof(size_t)) == 0);
+    printf("%s %s (%zu movies)\n", same ? "ok  " : "FAIL", name, got_count);
+    if (!same) failures++;
+    free(got);
+    free(expected);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s CATALOG.csv\n", argv[0]);
+        return 1;
+    }
+    MovieDatabase db;
+    movie_db_init(&db);
+    char *error = NULL;
+    if (!movie_db_load_from_csv_mapped(&db, argv[1], &error) || db.columns.year_span == 0) {
+        fprintf(stderr, "Failed to load %s: %s\n", argv[1], error ? error : "no release years");
+        free(error);
+        movie_db_free(&db);
+        return 1;
+    }
+    int first = db.columns.year_first;
+    int last = first + (int)db.columns.year_span - 1;
+    alarm(TEST_TIMEOUT_SECONDS);
+
+    expect_same(&db, "genre with years up to INT_MAX", "drama", last - 1, INT_MAX, last - 1, last);
+    expect_same(&db, "years 1 to INT_MAX", "", 1, INT_MAX, first, last);
+    expect_same(&db, "years past the catalog", "drama", INT_MAX - 1, INT_MAX, 1, 0);
+    expect_same(&db, "open upper year", "drama", last - 1, 0, last - 1, last);
+
+    movie_db_free(&db);
+    if (failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}